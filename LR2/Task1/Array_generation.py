@@ -1,4 +1,35 @@
 import random
+import struct
+import sys
+from array import array
+
+# Параметры бинарного формата (должны совпадать с ArrayFileHeader в программах на C)
+ARRAY_FILE_MAGIC = b"PCSARR01"
+ARRAY_FILE_INT32 = 1
+ARRAY_FILE_ALIGNMENT = 64
+
+
+def write_binary_array(filename, values):
+    """Сохраняет массив int32: заголовок, дополненный до ARRAY_FILE_ALIGNMENT, затем данные"""
+    header = struct.pack("<8sIIQQ", ARRAY_FILE_MAGIC, ARRAY_FILE_INT32,
+                         ARRAY_FILE_ALIGNMENT, len(values), ARRAY_FILE_ALIGNMENT)
+    data = array("i", values)
+    if sys.byteorder != "little":
+        data.byteswap()
+    with open(filename, "wb") as f:
+        f.write(header.ljust(ARRAY_FILE_ALIGNMENT, b"\0"))
+        f.write(data.tobytes())
+
+
+# Преобразование существующего текстового файла: python3 Array_generation.py --convert array.txt
+if len(sys.argv) == 3 and sys.argv[1] == "--convert":
+    txt_name = sys.argv[2]
+    bin_name = txt_name.rsplit(".", 1)[0] + ".bin"
+    with open(txt_name) as f:
+        values = list(map(int, f.read().split()))
+    write_binary_array(bin_name, values)
+    print(f"Массив из {txt_name} ({len(values)} элементов) сохранён в файл {bin_name}")
+    sys.exit(0)
 
 # Генерируем массив из 100001 случайного числа от 1 до 100
 arr = [random.randint(1, 100) for _ in range(100001)]
@@ -7,4 +38,7 @@ arr = [random.randint(1, 100) for _ in range(100001)]
 with open("array.txt", "w") as f:
     f.write(" ".join(map(str, arr)))
 
-print("Массив сохранён в файл array.txt")
+# Сохраняем тот же массив в бинарном формате для отображения в память
+write_binary_array("array.bin", arr)
+
+print("Массив сохранён в файлы array.txt и array.bin")
@@ -2,68 +2,805 @@
 #include <stdlib.h>
 #include <time.h>
 #include <omp.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
-// Функция для чтения массива из файла
-int* read_array_from_file(const char* filename, int* size) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
+// Функция для проверки, является ли символ разделителем чисел
+static inline int is_separator(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Функция для разбиения текста на диапазоны байтов по числу потоков.
+// Границы сдвигаются вперед до ближайшего разделителя, чтобы не разрезать числа
+void split_text_ranges(const char* text, size_t length, int parts, size_t* bounds) {
+    bounds[0] = 0;
+    for (int i = 1; i < parts; i++) {
+        size_t b = length / parts * i;
+        if (b < bounds[i - 1]) {
+            b = bounds[i - 1];
+        }
+        while (b < length && !is_separator(text[b])) {
+            b++;
+        }
+        bounds[i] = b;
+    }
+    bounds[parts] = length;
+}
+
+// Функция для отображения текстового файла в память только для чтения
+const char* map_text_file(const char* filename, size_t* length) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
         perror("Ошибка при открытии файла");
         exit(EXIT_FAILURE);
     }
 
-    // Подсчет количества чисел в файле
-    int count = 0;
-    int temp;
-    while (fscanf(file, "%d", &temp) == 1) {
-        count++;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror("Ошибка при получении размера файла");
+        close(fd);
+        exit(EXIT_FAILURE);
     }
-    
-    // Возврат к началу файла
-    rewind(file);
-    
-    // Выделение памяти под массив
-    int* arr = (int*)malloc(count * sizeof(int));
-    if (!arr) {
+
+    *length = (size_t)st.st_size;
+    if (*length == 0) {
+        close(fd);
+        return "";
+    }
+
+    void* text = mmap(NULL, *length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (text == MAP_FAILED) {
+        perror("Ошибка отображения файла в память");
+        exit(EXIT_FAILURE);
+    }
+    madvise(text, *length, MADV_SEQUENTIAL);
+    return (const char*)text;
+}
+
+// Функция для освобождения отображения текстового файла
+void unmap_text_file(const char* text, size_t length) {
+    if (length > 0) {
+        munmap((void*)text, length);
+    }
+}
+
+// Функция для разбора целых чисел из диапазона [p, end) в out.
+// Возвращает количество прочитанных чисел или -1 при ошибке формата
+long parse_int_range(const char* p, const char* end, int* out) {
+    long count = 0;
+    while (1) {
+        while (p < end && is_separator(*p)) {
+            p++;
+        }
+        if (p == end) {
+            break;
+        }
+
+        int negative = (*p == '-');
+        if (*p == '-' || *p == '+') {
+            p++;
+        }
+        if (p == end || *p < '0' || *p > '9') {
+            return -1;
+        }
+
+        long long value = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            value = value * 10 + (*p - '0');
+            if (value > (long long)INT_MAX + 1) {
+                return -1;
+            }
+            p++;
+        }
+        if (p < end && !is_separator(*p)) {
+            return -1;
+        }
+
+        value = negative ? -value : value;
+        if (value > INT_MAX) {
+            return -1;
+        }
+        out[count++] = (int)value;
+    }
+    return count;
+}
+
+// Функция для параллельного разбора текста с целыми числами за один проход:
+// каждый поток разбирает свой диапазон во временный буфер, затем куски
+// склеиваются в общий массив по префиксной сумме количеств.
+// Возвращает NULL при ошибке формата
+int* parse_int_text_parallel(const char* text, size_t length, int* size) {
+#ifdef _OPENMP
+    int num_chunks = omp_get_max_threads();
+#else
+    int num_chunks = 1;
+#endif
+    size_t* bounds = (size_t*)malloc((num_chunks + 1) * sizeof(size_t));
+    long* counts = (long*)malloc(num_chunks * sizeof(long));
+    size_t* offsets = (size_t*)malloc(num_chunks * sizeof(size_t));
+    int** chunks = (int**)calloc(num_chunks, sizeof(int*));
+    if (!bounds || !counts || !offsets || !chunks) {
         perror("Ошибка выделения памяти");
-        fclose(file);
         exit(EXIT_FAILURE);
     }
-    
-    // Чтение чисел в массив
-    for (int i = 0; i < count; i++) {
-        if (fscanf(file, "%d", &arr[i]) != 1) {
-            fprintf(stderr, "Ошибка при чтении элемента %d\n", i);
-            free(arr);
-            fclose(file);
+
+    split_text_ranges(text, length, num_chunks, bounds);
+
+    // Разбор диапазонов: в диапазоне из L байт не больше L / 2 + 1 чисел
+    int failed = 0;
+    #pragma omp parallel for num_threads(num_chunks) schedule(static, 1) reduction(|:failed)
+    for (int c = 0; c < num_chunks; c++) {
+        size_t chunk_length = bounds[c + 1] - bounds[c];
+        chunks[c] = (int*)malloc((chunk_length / 2 + 1) * sizeof(int));
+        counts[c] = chunks[c] ? parse_int_range(text + bounds[c], text + bounds[c + 1], chunks[c]) : -1;
+        if (counts[c] < 0) {
+            failed = 1;
+        }
+    }
+
+    // Префиксная сумма количеств дает смещение каждого куска в итоговом массиве
+    size_t total = 0;
+    for (int c = 0; c < num_chunks && !failed; c++) {
+        offsets[c] = total;
+        total += (size_t)counts[c];
+    }
+
+    int* arr = NULL;
+    if (!failed && total <= INT_MAX) {
+        arr = (int*)malloc((total > 0 ? total : 1) * sizeof(int));
+        if (!arr) {
+            perror("Ошибка выделения памяти");
             exit(EXIT_FAILURE);
         }
+
+        // Склейка кусков в общий массив
+        #pragma omp parallel for num_threads(num_chunks) schedule(static, 1)
+        for (int c = 0; c < num_chunks; c++) {
+            memcpy(arr + offsets[c], chunks[c], (size_t)counts[c] * sizeof(int));
+        }
+        *size = (int)total;
     }
-    
-    fclose(file);
-    *size = count;
+
+    for (int c = 0; c < num_chunks; c++) {
+        free(chunks[c]);
+    }
+    free(chunks);
+    free(offsets);
+    free(counts);
+    free(bounds);
     return arr;
 }
 
-// Функция для вычисления суммы элементов массива с использованием OpenMP
+// Функция для чтения массива из текстового файла (параллельный разбор за один проход)
+int* read_array_from_file(const char* filename, int* size) {
+    size_t length;
+    const char* text = map_text_file(filename, &length);
+
+    int* arr = parse_int_text_parallel(text, length, size);
+    unmap_text_file(text, length);
+    if (!arr) {
+        fprintf(stderr, "Ошибка при чтении чисел из файла %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    return arr;
+}
+
+// Бинарный формат массива: заголовок ArrayFileHeader, затем сырые данные,
+// начинающиеся со смещения data_offset (кратного alignment)
+#define ARRAY_FILE_MAGIC "PCSARR01"
+#define ARRAY_FILE_INT32 1
+#define ARRAY_FILE_FLOAT64 2
+
+typedef struct {
+    char magic[8];          // Сигнатура ARRAY_FILE_MAGIC
+    uint32_t elem_type;     // Тип элементов (ARRAY_FILE_INT32 / ARRAY_FILE_FLOAT64)
+    uint32_t alignment;     // Выравнивание начала данных в байтах
+    uint64_t count;         // Количество элементов
+    uint64_t data_offset;   // Смещение данных от начала файла
+} ArrayFileHeader;
+
+// Отображение бинарного файла в память
+typedef struct {
+    void* base;             // Начало отображения (NULL, если массив прочитан из текста)
+    size_t length;          // Длина отображения в байтах
+} MappedArray;
+
+// Функция для отображения бинарного массива в память (без разбора и копирования).
+// Возвращает указатель на данные или NULL, если файла нет
+void* map_array_file(const char* filename, uint32_t elem_type, int* size, MappedArray* mapped) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ArrayFileHeader)) {
+        fprintf(stderr, "Ошибка: файл %s не является бинарным массивом\n", filename);
+        exit(EXIT_FAILURE);
+    }
+
+    // Закрытое отображение с правом записи: страницы копируются только при изменении
+    void* base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("Ошибка отображения файла в память");
+        exit(EXIT_FAILURE);
+    }
+
+    // Проверка заголовка
+    const ArrayFileHeader* header = (const ArrayFileHeader*)base;
+    size_t elem_size = (elem_type == ARRAY_FILE_INT32) ? sizeof(int32_t) : sizeof(double);
+    if (memcmp(header->magic, ARRAY_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->elem_type != elem_type ||
+        header->alignment == 0 || header->data_offset % header->alignment != 0 ||
+        header->count > INT_MAX ||
+        header->data_offset + header->count * elem_size > (uint64_t)st.st_size) {
+        fprintf(stderr, "Ошибка: некорректный заголовок бинарного массива %s\n", filename);
+        munmap(base, (size_t)st.st_size);
+        exit(EXIT_FAILURE);
+    }
+
+    // Данные читаются последовательно - подсказываем ядру упреждающее чтение
+    madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    mapped->base = base;
+    mapped->length = (size_t)st.st_size;
+    *size = (int)header->count;
+    return (char*)base + header->data_offset;
+}
+
+// Функция для загрузки массива: бинарный файл отображается в память,
+// при его отсутствии читается текстовый
+int* load_array(const char* bin_filename, const char* txt_filename, int* size, MappedArray* mapped) {
+    mapped->base = NULL;
+    mapped->length = 0;
+
+    int* arr = (int*)map_array_file(bin_filename, ARRAY_FILE_INT32, size, mapped);
+    if (!arr) {
+        arr = read_array_from_file(txt_filename, size);
+    }
+    return arr;
+}
+
+// Функция для освобождения массива, полученного через load_array
+void release_array(int* arr, MappedArray* mapped) {
+    if (mapped->base) {
+        munmap(mapped->base, mapped->length);
+    } else {
+        free(arr);
+    }
+}
+
+// Ядро суммирования: сумма count элементов int32 в long long
+typedef long long (*sum_kernel_fn)(const int* arr, long count);
+
+// Скалярное ядро (используется, если векторные расширения недоступны)
+long long sum_kernel_scalar(const int* arr, long count) {
+    long long sum = 0;
+    for (long i = 0; i < count; i++) {
+        sum += arr[i];
+    }
+    return sum;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// SSE2: знаковое расширение int32 -> int64 через распаковку со знаковой маской,
+// два независимых аккумулятора
+__attribute__((target("sse2")))
+long long sum_kernel_sse2(const int* arr, long count) {
+    __m128i acc0 = _mm_setzero_si128();
+    __m128i acc1 = _mm_setzero_si128();
+    long i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(arr + i));
+        __m128i sign = _mm_srai_epi32(v, 31);
+        acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(v, sign));
+        acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(v, sign));
+    }
+    long long lanes[2];
+    _mm_storeu_si128((__m128i*)lanes, _mm_add_epi64(acc0, acc1));
+    long long sum = lanes[0] + lanes[1];
+    for (; i < count; i++) {
+        sum += arr[i];
+    }
+    return sum;
+}
+
+// AVX2: 16 элементов за итерацию, четыре независимых аккумулятора по 4 x int64
+__attribute__((target("avx2")))
+long long sum_kernel_avx2(const int* arr, long count) {
+    __m256i acc0 = _mm256_setzero_si256();
+    __m256i acc1 = _mm256_setzero_si256();
+    __m256i acc2 = _mm256_setzero_si256();
+    __m256i acc3 = _mm256_setzero_si256();
+    long i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i v0 = _mm256_loadu_si256((const __m256i*)(arr + i));
+        __m256i v1 = _mm256_loadu_si256((const __m256i*)(arr + i + 8));
+        acc0 = _mm256_add_epi64(acc0, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v0)));
+        acc1 = _mm256_add_epi64(acc1, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v0, 1)));
+        acc2 = _mm256_add_epi64(acc2, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v1)));
+        acc3 = _mm256_add_epi64(acc3, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v1, 1)));
+    }
+    __m256i acc = _mm256_add_epi64(_mm256_add_epi64(acc0, acc1), _mm256_add_epi64(acc2, acc3));
+    long long lanes[4];
+    _mm256_storeu_si256((__m256i*)lanes, acc);
+    long long sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for (; i < count; i++) {
+        sum += arr[i];
+    }
+    return sum;
+}
+
+// AVX-512: 32 элемента за итерацию, четыре независимых аккумулятора по 8 x int64
+__attribute__((target("avx512f")))
+long long sum_kernel_avx512(const int* arr, long count) {
+    __m512i acc0 = _mm512_setzero_si512();
+    __m512i acc1 = _mm512_setzero_si512();
+    __m512i acc2 = _mm512_setzero_si512();
+    __m512i acc3 = _mm512_setzero_si512();
+    long i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m512i v0 = _mm512_loadu_si512((const void*)(arr + i));
+        __m512i v1 = _mm512_loadu_si512((const void*)(arr + i + 16));
+        acc0 = _mm512_add_epi64(acc0, _mm512_cvtepi32_epi64(_mm512_castsi512_si256(v0)));
+        acc1 = _mm512_add_epi64(acc1, _mm512_cvtepi32_epi64(_mm512_extracti64x4_epi64(v0, 1)));
+        acc2 = _mm512_add_epi64(acc2, _mm512_cvtepi32_epi64(_mm512_castsi512_si256(v1)));
+        acc3 = _mm512_add_epi64(acc3, _mm512_cvtepi32_epi64(_mm512_extracti64x4_epi64(v1, 1)));
+    }
+    __m512i acc = _mm512_add_epi64(_mm512_add_epi64(acc0, acc1), _mm512_add_epi64(acc2, acc3));
+    long long sum = _mm512_reduce_add_epi64(acc);
+    for (; i < count; i++) {
+        sum += arr[i];
+    }
+    return sum;
+}
+#endif
+
+// Функция для выбора лучшего ядра суммирования по данным CPUID
+sum_kernel_fn select_sum_kernel(const char** name) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        *name = "AVX-512";
+        return sum_kernel_avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        *name = "AVX2";
+        return sum_kernel_avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        *name = "SSE2";
+        return sum_kernel_sse2;
+    }
+#endif
+    *name = "скалярное";
+    return sum_kernel_scalar;
+}
+
+// Ядро суммирования, выбранное при запуске
+sum_kernel_fn sum_kernel = sum_kernel_scalar;
+
+// Диапазон гистограммы по умолчанию соответствует Array_generation.py
+#define HIST_DEFAULT_LOW 1
+#define HIST_DEFAULT_HIGH 100
+#define HIST_DEFAULT_BINS 10
+
+// Параметры гистограммы: максимальное число интервалов и размер блока,
+// который после чтения из памяти обрабатывается повторно уже из кэша L1
+#define HIST_MAX_BINS 64
+#define STATS_BLOCK 2048
+
+// Наибольшая ширина диапазона гистограммы, для которой номер интервала
+// берется из таблицы (по байту на значение)
+#define HIST_LUT_MAX 65536
+
+// Частичная статистика части массива. Дисперсия хранится как сумма квадратов
+// отклонений от среднего (m2) и объединяется по формуле Чана
+typedef struct {
+    long long count;
+    long long sum;
+    int min;
+    int max;
+    double mean;
+    double m2;
+    long long below;                // Элементов ниже диапазона гистограммы
+    long long above;                // Элементов выше диапазона гистограммы
+    long long hist[HIST_MAX_BINS];
+} ArrayStats;
+
+// Диапазон гистограммы [low, high], разбитый на bins равных интервалов.
+// Значение v попадает в интервал (v - low) * bins / span; отображение
+// заполняется один раз функцией hist_range_prepare
+typedef struct {
+    int low;
+    int high;
+    int bins;
+    unsigned long long span;                        // high - low + 1
+    unsigned char* lut;                             // Интервал каждого значения (span <= HIST_LUT_MAX)
+    unsigned long long recip;                       // floor(bins * 2^32 / span) для широкого диапазона
+    unsigned long long starts[HIST_MAX_BINS + 1];   // Смещение начала интервала от low
+} HistRange;
+
+// Функция для подготовки отображения значений в интервалы: для узкого диапазона
+// строится таблица, для широкого - обратная величина в фиксированной точке.
+// Возвращает 0 при нехватке памяти
+int hist_range_prepare(HistRange* range) {
+    range->span = (unsigned long long)((long long)range->high - range->low + 1);
+    for (int i = 0; i <= range->bins; i++) {
+        range->starts[i] = (range->span * i + range->bins - 1) / range->bins;
+    }
+    range->lut = NULL;
+    range->recip = ((unsigned long long)range->bins << 32) / range->span;
+    if (range->span <= HIST_LUT_MAX) {
+        range->lut = (unsigned char*)malloc(range->span);
+        if (!range->lut) {
+            return 0;
+        }
+        for (int i = 0; i < range->bins; i++) {
+            for (unsigned long long off = range->starts[i]; off < range->starts[i + 1]; off++) {
+                range->lut[off] = (unsigned char)i;
+            }
+        }
+    }
+    return 1;
+}
+
+// Функция для освобождения таблицы интервалов
+void hist_range_free(HistRange* range) {
+    free(range->lut);
+    range->lut = NULL;
+}
+
+// Функция для вычисления интервала по смещению off = v - low из [0, span) без деления:
+// off * recip / 2^32 меньше точного значения не более чем на единицу (off < 2^32),
+// поэтому достаточно одной поправки по границе следующего интервала
+static inline int hist_bin_wide(const HistRange* range, unsigned long long off) {
+    int bin = (int)((off * range->recip) >> 32);
+    return bin + (off >= range->starts[bin + 1]);
+}
+
+// Функция для определения ячейки счетчиков значения без ветвлений по данным:
+// интервалы 0..bins - 1, bins - ниже диапазона, bins + 1 - выше. Значение
+// ограничивается диапазоном, а ячейка вне диапазона выбирается по маске
+static inline int hist_slot(const HistRange* range, int value) {
+    int below = value < range->low;
+    int above = value > range->high;
+    int clamped = below ? range->low : value;
+    clamped = above ? range->high : clamped;
+    unsigned int off = (unsigned int)clamped - (unsigned int)range->low;
+    int bin = range->lut ? range->lut[off] : hist_bin_wide(range, off);
+    int outside = -(below | above);
+    return (bin & ~outside) | ((range->bins + above) & outside);
+}
+
+// Функция для инициализации пустой статистики
+void stats_init(ArrayStats* s) {
+    memset(s, 0, sizeof(*s));
+    s->min = INT_MAX;
+    s->max = INT_MIN;
+}
+
+// Функция для объединения статистики b с a (формула Чана для среднего и m2)
+void stats_merge(ArrayStats* a, const ArrayStats* b) {
+    if (b->count == 0) {
+        return;
+    }
+    if (a->count == 0) {
+        *a = *b;
+        return;
+    }
+    
+    long long n = a->count + b->count;
+    double delta = b->mean - a->mean;
+    a->mean += delta * b->count / n;
+    a->m2 += b->m2 + delta * delta * ((double)a->count * b->count / n);
+    a->count = n;
+    a->sum += b->sum;
+    if (b->min < a->min) a->min = b->min;
+    if (b->max > a->max) a->max = b->max;
+    a->below += b->below;
+    a->above += b->above;
+    for (int i = 0; i < HIST_MAX_BINS; i++) {
+        a->hist[i] += b->hist[i];
+    }
+}
+
+// Функция для добавления блока к статистике: сумма считается векторным ядром,
+// затем тот же блок (уже в кэше) проходится векторизуемым циклом для минимума,
+// максимума и отклонений от среднего блока и отдельным циклом для гистограммы
+void stats_add_block(ArrayStats* s, const int* arr, long count, const HistRange* range) {
+    ArrayStats block;
+    stats_init(&block);
+    block.count = count;
+    block.sum = sum_kernel(arr, count);
+    block.mean = (double)block.sum / count;
+    
+    double mean = block.mean;
+    int min = INT_MAX, max = INT_MIN;
+    double m2 = 0.0;
+    #pragma omp simd reduction(min:min) reduction(max:max) reduction(+:m2)
+    for (long i = 0; i < count; i++) {
+        int value = arr[i];
+        min = (value < min) ? value : min;
+        max = (value > max) ? value : max;
+        double d = value - mean;
+        m2 += d * d;
+    }
+    block.min = min;
+    block.max = max;
+    block.m2 = m2;
+    
+    // Четыре копии счетчиков, чтобы соседние увеличения одной ячейки не ждали друг друга
+    unsigned int counts[4][HIST_MAX_BINS + 2];
+    memset(counts, 0, sizeof(counts));
+    long i = 0;
+    if (range->lut && min >= range->low && max <= range->high) {
+        // Весь блок внутри узкого диапазона: интервал берется из таблицы без проверок
+        const unsigned char* lut = range->lut;
+        unsigned int low = (unsigned int)range->low;
+        for (; i + 4 <= count; i += 4) {
+            counts[0][lut[(unsigned int)arr[i] - low]]++;
+            counts[1][lut[(unsigned int)arr[i + 1] - low]]++;
+            counts[2][lut[(unsigned int)arr[i + 2] - low]]++;
+            counts[3][lut[(unsigned int)arr[i + 3] - low]]++;
+        }
+        for (; i < count; i++) {
+            counts[0][lut[(unsigned int)arr[i] - low]]++;
+        }
+    } else {
+        for (; i + 4 <= count; i += 4) {
+            counts[0][hist_slot(range, arr[i])]++;
+            counts[1][hist_slot(range, arr[i + 1])]++;
+            counts[2][hist_slot(range, arr[i + 2])]++;
+            counts[3][hist_slot(range, arr[i + 3])]++;
+        }
+        for (; i < count; i++) {
+            counts[0][hist_slot(range, arr[i])]++;
+        }
+    }
+    for (int b = 0; b < range->bins + 2; b++) {
+        long long c = (long long)counts[0][b] + counts[1][b] + counts[2][b] + counts[3][b];
+        if (b < range->bins) {
+            block.hist[b] = c;
+        } else if (b == range->bins) {
+            block.below = c;
+        } else {
+            block.above = c;
+        }
+    }
+    stats_merge(s, &block);
+}
+
+// Функция для вычисления статистики диапазона массива за один проход блоками STATS_BLOCK
+void calculate_partial_stats(const int* arr, long count, const HistRange* range, ArrayStats* s) {
+    stats_init(s);
+    for (long begin = 0; begin < count; begin += STATS_BLOCK) {
+        long n = (count - begin < STATS_BLOCK) ? count - begin : STATS_BLOCK;
+        stats_add_block(s, arr + begin, n, range);
+    }
+}
+
+// Функция для разбора диапазона гистограммы из аргументов <нижняя> <верхняя> [<интервалов>].
+// Возвращает 0 при некорректных значениях
+int parse_hist_range(char** args, int count, HistRange* range) {
+    if (count >= 2) {
+        range->low = atoi(args[0]);
+        range->high = atoi(args[1]);
+    }
+    if (count >= 3) {
+        range->bins = atoi(args[2]);
+    }
+    return range->low <= range->high && range->bins > 0 && range->bins <= HIST_MAX_BINS;
+}
+
+// Функция для вывода сводной статистики и гистограммы
+void print_stats(const ArrayStats* s, const HistRange* range) {
+    if (s->count == 0) {
+        printf("Массив пуст\n");
+        return;
+    }
+    printf("Минимум: %d\n", s->min);
+    printf("Максимум: %d\n", s->max);
+    printf("Среднее: %.6f\n", s->mean);
+    printf("Дисперсия: %.6f\n", s->m2 / s->count);
+    
+    printf("Гистограмма [%d, %d], %d интервалов:\n", range->low, range->high, range->bins);
+    long long span = (long long)range->high - range->low + 1;
+    for (int i = 0; i < range->bins; i++) {
+        // Значение v попадает в интервал (v - low) * bins / span, отсюда границы интервала i
+        long long from = range->low + (span * i + range->bins - 1) / range->bins;
+        long long to = range->low + (span * (i + 1) + range->bins - 1) / range->bins - 1;
+        if (to < from) {
+            continue;  // Интервалов больше, чем значений в диапазоне
+        }
+        printf("  [%lld, %lld]: %lld\n", from, to, s->hist[i]);
+    }
+    if (s->below > 0) {
+        printf("  ниже %d: %lld\n", range->low, s->below);
+    }
+    if (s->above > 0) {
+        printf("  выше %d: %lld\n", range->high, s->above);
+    }
+}
+
+// Функция для вычисления только суммы элементов массива с использованием OpenMP:
+// каждый поток суммирует свой непрерывный диапазон векторным ядром
 long long calculate_sum_parallel(const int* arr, int size, int num_threads) {
     long long sum = 0;
     
     // Установка количества потоков
     omp_set_num_threads(num_threads);
     
-    // Параллельное вычисление суммы с использованием reduction
-    #pragma omp parallel for reduction(+:sum)
-    for (int i = 0; i < size; i++) {
-        sum += arr[i];
+    #pragma omp parallel reduction(+:sum)
+    {
+        int thread = omp_get_thread_num();
+        int threads = omp_get_num_threads();
+        long begin = (long)size * thread / threads;
+        long end = (long)size * (thread + 1) / threads;
+        sum += sum_kernel(arr + begin, end - begin);
     }
     
     return sum;
 }
 
+// Функция для вычисления суммы и статистики массива с использованием OpenMP за один проход:
+// каждый поток обрабатывает свой непрерывный диапазон в локальную статистику,
+// затем статистики потоков объединяются по порядку
+void calculate_stats_parallel(const int* arr, int size, int num_threads, const HistRange* range,
+                              ArrayStats* result) {
+    ArrayStats* partial = (ArrayStats*)malloc(num_threads * sizeof(ArrayStats));
+    if (!partial) {
+        perror("Ошибка выделения памяти для статистики");
+        exit(EXIT_FAILURE);
+    }
+    
+    // Установка количества потоков
+    omp_set_num_threads(num_threads);
+    
+    int threads_used = 1;
+    #pragma omp parallel
+    {
+        int thread = omp_get_thread_num();
+        int threads = omp_get_num_threads();
+        long begin = (long)size * thread / threads;
+        long end = (long)size * (thread + 1) / threads;
+        calculate_partial_stats(arr + begin, end - begin, range, &partial[thread]);
+        #pragma omp single
+        threads_used = threads;
+    }
+    
+    stats_init(result);
+    for (int i = 0; i < threads_used; i++) {
+        stats_merge(result, &partial[i]);
+    }
+    free(partial);
+}
+
+// Число повторов при замере времени сканирования (берется лучшее время)
+#define SCAN_REPEATS 5
+
+// Функция для последовательного префиксного суммирования: out[i] - сумма arr[0..i]
+// (inclusive) или arr[0..i-1] (exclusive). Результат в long long, чтобы не переполниться
+void scan_sequential(const int* arr, long long* out, long count, long long offset, int inclusive) {
+    long long running = offset;
+    if (inclusive) {
+        for (long i = 0; i < count; i++) {
+            running += arr[i];
+            out[i] = running;
+        }
+    } else {
+        for (long i = 0; i < count; i++) {
+            out[i] = running;
+            running += arr[i];
+        }
+    }
+}
+
+// Функция для параллельного префиксного суммирования в два прохода:
+// 1) каждый поток суммирует свой диапазон векторным ядром (только чтение);
+// 2) после сканирования сумм диапазонов каждый поток сканирует свой диапазон со своим смещением.
+// Вход читается дважды, результат пишется один раз - меньше трафика, чем при
+// сканировании с последующей досуммовкой смещений (два прохода записи)
+void scan_parallel(const int* arr, long long* out, int size, int num_threads, int inclusive) {
+    long long* offsets = (long long*)malloc((num_threads + 1) * sizeof(long long));
+    if (!offsets) {
+        perror("Ошибка выделения памяти для сканирования");
+        exit(EXIT_FAILURE);
+    }
+    
+    #pragma omp parallel num_threads(num_threads)
+    {
+        int thread = omp_get_thread_num();
+        int threads = omp_get_num_threads();
+        long begin = (long)size * thread / threads;
+        long end = (long)size * (thread + 1) / threads;
+        
+        // Проход 1: сумма своего диапазона
+        offsets[thread + 1] = sum_kernel(arr + begin, end - begin);
+        #pragma omp barrier
+        
+        // Исключающее сканирование сумм диапазонов (потоков немного)
+        #pragma omp single
+        {
+            offsets[0] = 0;
+            for (int t = 1; t <= threads; t++) {
+                offsets[t] += offsets[t - 1];
+            }
+        }
+        
+        // Проход 2: сканирование своего диапазона со смещением
+        scan_sequential(arr + begin, out + begin, end - begin, offsets[thread], inclusive);
+    }
+    
+    free(offsets);
+}
+
+// Функция для сравнения параллельного и последовательного сканирования:
+// лучшее из SCAN_REPEATS время каждого, ускорение и эффективная пропускная способность
+int run_scan_benchmark(const int* arr, int size, int num_threads, int inclusive) {
+    long long* seq = (long long*)malloc((size > 0 ? size : 1) * sizeof(long long));
+    long long* par = (long long*)malloc((size > 0 ? size : 1) * sizeof(long long));
+    if (!seq || !par) {
+        perror("Ошибка выделения памяти для сканирования");
+        free(seq);
+        free(par);
+        return 1;
+    }
+    
+    double seq_time = -1.0, par_time = -1.0;
+    for (int rep = 0; rep < SCAN_REPEATS; rep++) {
+        double start = omp_get_wtime();
+        scan_sequential(arr, seq, size, 0, inclusive);
+        double elapsed = omp_get_wtime() - start;
+        if (seq_time < 0.0 || elapsed < seq_time) seq_time = elapsed;
+        
+        start = omp_get_wtime();
+        scan_parallel(arr, par, size, num_threads, inclusive);
+        elapsed = omp_get_wtime() - start;
+        if (par_time < 0.0 || elapsed < par_time) par_time = elapsed;
+    }
+    
+    int correct = memcmp(seq, par, size * sizeof(long long)) == 0;
+    // Трафик: чтение входа (int) и запись результата (long long)
+    double bytes = (double)size * (sizeof(int) + sizeof(long long));
+    
+    printf("Префиксная сумма (%s)\n", inclusive ? "inclusive" : "exclusive");
+    printf("Количество потоков: %d\n", num_threads);
+    printf("Размер массива: %d элементов\n", size);
+    if (size > 0) {
+        printf("Последний элемент: %lld\n", par[size - 1]);
+    }
+    printf("Последовательное сканирование: %.6f секунд (%.2f ГБ/с)\n", seq_time, bytes / seq_time / 1e9);
+    printf("Параллельное сканирование: %.6f секунд (%.2f ГБ/с)\n", par_time, bytes / par_time / 1e9);
+    printf("Ускорение: %.2f\n", seq_time / par_time);
+    printf(correct ? "Проверка: результаты совпадают\n" : "Ошибка: результаты сканирования различаются!\n");
+    
+    free(seq);
+    free(par);
+    return correct ? 0 : 1;
+}
+
 int main(int argc, char* argv[]) {
     // Проверка аргументов командной строки
-    if (argc != 2) {
-        printf("Использование: %s <количество_потоков>\n", argv[0]);
+    int scan_mode = (argc == 3 && (strcmp(argv[2], "scan") == 0 || strcmp(argv[2], "exscan") == 0));
+    int sum_only = (argc == 3 && strcmp(argv[2], "sum") == 0);
+    if (argc != 2 && argc != 4 && argc != 5 && !scan_mode && !sum_only) {
+        printf("Использование: %s <количество_потоков> [<нижняя_граница> <верхняя_граница> [<интервалов>]]\n", argv[0]);
+        printf("       %s <количество_потоков> sum|scan|exscan\n", argv[0]);
+        printf("  границы и число интервалов задают гистограмму (по умолчанию [%d, %d], %d интервалов)\n",
+               HIST_DEFAULT_LOW, HIST_DEFAULT_HIGH, HIST_DEFAULT_BINS);
+        printf("  sum - только сумма элементов (без статистики)\n");
+        printf("  scan, exscan - включающая или исключающая префиксная сумма вместо статистики\n");
         return 1;
     }
     
@@ -73,29 +810,67 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
+    HistRange range = {.low = HIST_DEFAULT_LOW, .high = HIST_DEFAULT_HIGH, .bins = HIST_DEFAULT_BINS};
+    if (!scan_mode && !sum_only && !parse_hist_range(argv + 2, argc - 2, &range)) {
+        printf("Некорректный диапазон гистограммы (нужно нижняя <= верхняя, интервалов от 1 до %d)\n",
+               HIST_MAX_BINS);
+        return 1;
+    }
+    
+    // Количество потоков задается до чтения файла, чтобы разбор шел тем же числом потоков
+    omp_set_num_threads(num_threads);
+    
     int size;
     double start_time, end_time;
     
+    // Выбор ядра суммирования по возможностям процессора
+    const char* kernel_name;
+    sum_kernel = select_sum_kernel(&kernel_name);
+    
     // Замер времени начала выполнения
     start_time = omp_get_wtime();
     
-    // Чтение массива из файла
-    int* array = read_array_from_file("array.txt", &size);
+    // Загрузка массива (array.bin отображается в память, иначе читается array.txt)
+    MappedArray mapped;
+    int* array = load_array("array.bin", "array.txt", &size, &mapped);
+    
+    // Префиксная сумма со сравнением с последовательной версией
+    if (scan_mode) {
+        printf("Ядро суммирования: %s\n", kernel_name);
+        int rc = run_scan_benchmark(array, size, num_threads, strcmp(argv[2], "scan") == 0);
+        release_array(array, &mapped);
+        return rc;
+    }
     
-    // Вычисление суммы с использованием OpenMP
-    long long sum = calculate_sum_parallel(array, size, num_threads);
+    // Вычисление только суммы или суммы и статистики с использованием OpenMP за один проход
+    ArrayStats stats;
+    if (sum_only) {
+        stats.sum = calculate_sum_parallel(array, size, num_threads);
+    } else {
+        if (!hist_range_prepare(&range)) {
+            perror("Ошибка выделения памяти для гистограммы");
+            release_array(array, &mapped);
+            return 1;
+        }
+        calculate_stats_parallel(array, size, num_threads, &range, &stats);
+    }
     
     // Замер времени окончания выполнения
     end_time = omp_get_wtime();
     
     // Вывод результатов
     printf("Количество потоков: %d\n", num_threads);
+    printf("Ядро суммирования: %s\n", kernel_name);
     printf("Размер массива: %d элементов\n", size);
-    printf("Сумма элементов: %lld\n", sum);
+    printf("Сумма элементов: %lld\n", stats.sum);
+    if (!sum_only) {
+        print_stats(&stats, &range);
+    }
     printf("Время выполнения: %.6f секунд\n", end_time - start_time);
     
     // Освобождение памяти
-    free(array);
+    hist_range_free(&range);
+    release_array(array, &mapped);
     
     return 0;
 }
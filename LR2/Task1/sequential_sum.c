@@ -1,6 +1,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 // Функция для чтения массива из файла
 int* read_array_from_file(const char* filename, int* size) {
@@ -43,6 +50,92 @@ int* read_array_from_file(const char* filename, int* size) {
     return arr;
 }
 
+// Бинарный формат массива: заголовок ArrayFileHeader, затем сырые данные,
+// начинающиеся со смещения data_offset (кратного alignment)
+#define ARRAY_FILE_MAGIC "PCSARR01"
+#define ARRAY_FILE_INT32 1
+#define ARRAY_FILE_FLOAT64 2
+
+typedef struct {
+    char magic[8];          // Сигнатура ARRAY_FILE_MAGIC
+    uint32_t elem_type;     // Тип элементов (ARRAY_FILE_INT32 / ARRAY_FILE_FLOAT64)
+    uint32_t alignment;     // Выравнивание начала данных в байтах
+    uint64_t count;         // Количество элементов
+    uint64_t data_offset;   // Смещение данных от начала файла
+} ArrayFileHeader;
+
+// Отображение бинарного файла в память
+typedef struct {
+    void* base;             // Начало отображения (NULL, если массив прочитан из текста)
+    size_t length;          // Длина отображения в байтах
+} MappedArray;
+
+// Функция для отображения бинарного массива в память (без разбора и копирования).
+// Возвращает указатель на данные или NULL, если файла нет
+void* map_array_file(const char* filename, uint32_t elem_type, int* size, MappedArray* mapped) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ArrayFileHeader)) {
+        fprintf(stderr, "Ошибка: файл %s не является бинарным массивом\n", filename);
+        exit(EXIT_FAILURE);
+    }
+
+    // Закрытое отображение с правом записи: страницы копируются только при изменении
+    void* base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("Ошибка отображения файла в память");
+        exit(EXIT_FAILURE);
+    }
+
+    // Проверка заголовка
+    const ArrayFileHeader* header = (const ArrayFileHeader*)base;
+    size_t elem_size = (elem_type == ARRAY_FILE_INT32) ? sizeof(int32_t) : sizeof(double);
+    if (memcmp(header->magic, ARRAY_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->elem_type != elem_type ||
+        header->alignment == 0 || header->data_offset % header->alignment != 0 ||
+        header->count > INT_MAX ||
+        header->data_offset + header->count * elem_size > (uint64_t)st.st_size) {
+        fprintf(stderr, "Ошибка: некорректный заголовок бинарного массива %s\n", filename);
+        munmap(base, (size_t)st.st_size);
+        exit(EXIT_FAILURE);
+    }
+
+    // Данные читаются последовательно - подсказываем ядру упреждающее чтение
+    madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    mapped->base = base;
+    mapped->length = (size_t)st.st_size;
+    *size = (int)header->count;
+    return (char*)base + header->data_offset;
+}
+
+// Функция для загрузки массива: бинарный файл отображается в память,
+// при его отсутствии читается текстовый
+int* load_array(const char* bin_filename, const char* txt_filename, int* size, MappedArray* mapped) {
+    mapped->base = NULL;
+    mapped->length = 0;
+
+    int* arr = (int*)map_array_file(bin_filename, ARRAY_FILE_INT32, size, mapped);
+    if (!arr) {
+        arr = read_array_from_file(txt_filename, size);
+    }
+    return arr;
+}
+
+// Функция для освобождения массива, полученного через load_array
+void release_array(int* arr, MappedArray* mapped) {
+    if (mapped->base) {
+        munmap(mapped->base, mapped->length);
+    } else {
+        free(arr);
+    }
+}
+
 // Функция для вычисления суммы элементов массива
 long long calculate_sum(const int* arr, int size) {
     long long sum = 0;
@@ -59,8 +152,9 @@ int main() {
     // Замер времени начала выполнения
     start_time = (double)clock() / CLOCKS_PER_SEC;
     
-    // Чтение массива из файла
-    int* array = read_array_from_file("array.txt", &size);
+    // Загрузка массива (array.bin отображается в память, иначе читается array.txt)
+    MappedArray mapped;
+    int* array = load_array("array.bin", "array.txt", &size, &mapped);
     
     // Вычисление суммы
     long long sum = calculate_sum(array, size);
@@ -74,7 +168,7 @@ int main() {
     printf("Время выполнения: %.6f секунд\n", end_time - start_time);
     
     // Освобождение памяти
-    free(array);
+    release_array(array, &mapped);
     
     return 0;
 }
@@ -2,48 +2,283 @@
 #include <stdlib.h>
 #include <time.h>
 #include <omp.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <aio.h>
 
-// Функция для чтения массива из файла
-int* read_array_from_file(const char* filename, int* size) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
+// Функция для проверки, является ли символ разделителем чисел
+static inline int is_separator(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Функция для разбиения текста на диапазоны байтов по числу потоков.
+// Границы сдвигаются вперед до ближайшего разделителя, чтобы не разрезать числа
+void split_text_ranges(const char* text, size_t length, int parts, size_t* bounds) {
+    bounds[0] = 0;
+    for (int i = 1; i < parts; i++) {
+        size_t b = length / parts * i;
+        if (b < bounds[i - 1]) {
+            b = bounds[i - 1];
+        }
+        while (b < length && !is_separator(text[b])) {
+            b++;
+        }
+        bounds[i] = b;
+    }
+    bounds[parts] = length;
+}
+
+// Функция для отображения текстового файла в память только для чтения
+const char* map_text_file(const char* filename, size_t* length) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
         perror("Ошибка при открытии файла");
         exit(EXIT_FAILURE);
     }
 
-    // Подсчет количества чисел в файле
-    int count = 0;
-    int temp;
-    while (fscanf(file, "%d", &temp) == 1) {
-        count++;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror("Ошибка при получении размера файла");
+        close(fd);
+        exit(EXIT_FAILURE);
     }
-    
-    // Возврат к началу файла
-    rewind(file);
-    
-    // Выделение памяти под массив
-    int* arr = (int*)malloc(count * sizeof(int));
-    if (!arr) {
+
+    *length = (size_t)st.st_size;
+    if (*length == 0) {
+        close(fd);
+        return "";
+    }
+
+    void* text = mmap(NULL, *length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (text == MAP_FAILED) {
+        perror("Ошибка отображения файла в память");
+        exit(EXIT_FAILURE);
+    }
+    madvise(text, *length, MADV_SEQUENTIAL);
+    return (const char*)text;
+}
+
+// Функция для освобождения отображения текстового файла
+void unmap_text_file(const char* text, size_t length) {
+    if (length > 0) {
+        munmap((void*)text, length);
+    }
+}
+
+// Функция для разбора целых чисел из диапазона [p, end) в out.
+// Возвращает количество прочитанных чисел или -1 при ошибке формата
+long parse_int_range(const char* p, const char* end, int* out) {
+    long count = 0;
+    while (1) {
+        while (p < end && is_separator(*p)) {
+            p++;
+        }
+        if (p == end) {
+            break;
+        }
+
+        int negative = (*p == '-');
+        if (*p == '-' || *p == '+') {
+            p++;
+        }
+        if (p == end || *p < '0' || *p > '9') {
+            return -1;
+        }
+
+        long long value = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            value = value * 10 + (*p - '0');
+            if (value > (long long)INT_MAX + 1) {
+                return -1;
+            }
+            p++;
+        }
+        if (p < end && !is_separator(*p)) {
+            return -1;
+        }
+
+        value = negative ? -value : value;
+        if (value > INT_MAX) {
+            return -1;
+        }
+        out[count++] = (int)value;
+    }
+    return count;
+}
+
+// Функция для параллельного разбора текста с целыми числами за один проход:
+// каждый поток разбирает свой диапазон во временный буфер, затем куски
+// склеиваются в общий массив по префиксной сумме количеств.
+// Возвращает NULL при ошибке формата
+int* parse_int_text_parallel(const char* text, size_t length, int* size) {
+#ifdef _OPENMP
+    int num_chunks = omp_get_max_threads();
+#else
+    int num_chunks = 1;
+#endif
+    size_t* bounds = (size_t*)malloc((num_chunks + 1) * sizeof(size_t));
+    long* counts = (long*)malloc(num_chunks * sizeof(long));
+    size_t* offsets = (size_t*)malloc(num_chunks * sizeof(size_t));
+    int** chunks = (int**)calloc(num_chunks, sizeof(int*));
+    if (!bounds || !counts || !offsets || !chunks) {
         perror("Ошибка выделения памяти");
-        fclose(file);
         exit(EXIT_FAILURE);
     }
-    
-    // Чтение чисел в массив
-    for (int i = 0; i < count; i++) {
-        if (fscanf(file, "%d", &arr[i]) != 1) {
-            fprintf(stderr, "Ошибка при чтении элемента %d\n", i);
-            free(arr);
-            fclose(file);
+
+    split_text_ranges(text, length, num_chunks, bounds);
+
+    // Разбор диапазонов: в диапазоне из L байт не больше L / 2 + 1 чисел
+    int failed = 0;
+    #pragma omp parallel for num_threads(num_chunks) schedule(static, 1) reduction(|:failed)
+    for (int c = 0; c < num_chunks; c++) {
+        size_t chunk_length = bounds[c + 1] - bounds[c];
+        chunks[c] = (int*)malloc((chunk_length / 2 + 1) * sizeof(int));
+        counts[c] = chunks[c] ? parse_int_range(text + bounds[c], text + bounds[c + 1], chunks[c]) : -1;
+        if (counts[c] < 0) {
+            failed = 1;
+        }
+    }
+
+    // Префиксная сумма количеств дает смещение каждого куска в итоговом массиве
+    size_t total = 0;
+    for (int c = 0; c < num_chunks && !failed; c++) {
+        offsets[c] = total;
+        total += (size_t)counts[c];
+    }
+
+    int* arr = NULL;
+    if (!failed && total <= INT_MAX) {
+        arr = (int*)malloc((total > 0 ? total : 1) * sizeof(int));
+        if (!arr) {
+            perror("Ошибка выделения памяти");
             exit(EXIT_FAILURE);
         }
+
+        // Склейка кусков в общий массив
+        #pragma omp parallel for num_threads(num_chunks) schedule(static, 1)
+        for (int c = 0; c < num_chunks; c++) {
+            memcpy(arr + offsets[c], chunks[c], (size_t)counts[c] * sizeof(int));
+        }
+        *size = (int)total;
     }
-    
-    fclose(file);
-    *size = count;
+
+    for (int c = 0; c < num_chunks; c++) {
+        free(chunks[c]);
+    }
+    free(chunks);
+    free(offsets);
+    free(counts);
+    free(bounds);
     return arr;
 }
 
+// Функция для чтения массива из текстового файла (параллельный разбор за один проход)
+int* read_array_from_file(const char* filename, int* size) {
+    size_t length;
+    const char* text = map_text_file(filename, &length);
+
+    int* arr = parse_int_text_parallel(text, length, size);
+    unmap_text_file(text, length);
+    if (!arr) {
+        fprintf(stderr, "Ошибка при чтении чисел из файла %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    return arr;
+}
+
+// Бинарный формат массива: заголовок ArrayFileHeader, затем сырые данные,
+// начинающиеся со смещения data_offset (кратного alignment)
+#define ARRAY_FILE_MAGIC "PCSARR01"
+#define ARRAY_FILE_INT32 1
+#define ARRAY_FILE_FLOAT64 2
+
+typedef struct {
+    char magic[8];          // Сигнатура ARRAY_FILE_MAGIC
+    uint32_t elem_type;     // Тип элементов (ARRAY_FILE_INT32 / ARRAY_FILE_FLOAT64)
+    uint32_t alignment;     // Выравнивание начала данных в байтах
+    uint64_t count;         // Количество элементов
+    uint64_t data_offset;   // Смещение данных от начала файла
+} ArrayFileHeader;
+
+// Отображение бинарного файла в память
+typedef struct {
+    void* base;             // Начало отображения (NULL, если массив прочитан из текста)
+    size_t length;          // Длина отображения в байтах
+} MappedArray;
+
+// Функция для отображения бинарного массива в память (без разбора и копирования).
+// Возвращает указатель на данные или NULL, если файла нет
+void* map_array_file(const char* filename, uint32_t elem_type, int* size, MappedArray* mapped) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ArrayFileHeader)) {
+        fprintf(stderr, "Ошибка: файл %s не является бинарным массивом\n", filename);
+        exit(EXIT_FAILURE);
+    }
+
+    // Закрытое отображение с правом записи: страницы копируются только при изменении
+    void* base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("Ошибка отображения файла в память");
+        exit(EXIT_FAILURE);
+    }
+
+    // Проверка заголовка
+    const ArrayFileHeader* header = (const ArrayFileHeader*)base;
+    size_t elem_size = (elem_type == ARRAY_FILE_INT32) ? sizeof(int32_t) : sizeof(double);
+    if (memcmp(header->magic, ARRAY_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->elem_type != elem_type ||
+        header->alignment == 0 || header->data_offset % header->alignment != 0 ||
+        header->count > INT_MAX ||
+        header->data_offset + header->count * elem_size > (uint64_t)st.st_size) {
+        fprintf(stderr, "Ошибка: некорректный заголовок бинарного массива %s\n", filename);
+        munmap(base, (size_t)st.st_size);
+        exit(EXIT_FAILURE);
+    }
+
+    // Данные читаются последовательно - подсказываем ядру упреждающее чтение
+    madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    mapped->base = base;
+    mapped->length = (size_t)st.st_size;
+    *size = (int)header->count;
+    return (char*)base + header->data_offset;
+}
+
+// Функция для загрузки массива: бинарный файл отображается в память,
+// при его отсутствии читается текстовый
+int* load_array(const char* bin_filename, const char* txt_filename, int* size, MappedArray* mapped) {
+    mapped->base = NULL;
+    mapped->length = 0;
+
+    int* arr = (int*)map_array_file(bin_filename, ARRAY_FILE_INT32, size, mapped);
+    if (!arr) {
+        arr = read_array_from_file(txt_filename, size);
+    }
+    return arr;
+}
+
+// Функция для освобождения массива, полученного через load_array
+void release_array(int* arr, MappedArray* mapped) {
+    if (mapped->base) {
+        munmap(mapped->base, mapped->length);
+    } else {
+        free(arr);
+    }
+}
+
 // Функция для обмена элементов массива
 void swap(int* a, int* b) {
     int temp = *a;
@@ -51,49 +286,227 @@ void swap(int* a, int* b) {
     *b = temp;
 }
 
-// Функция разделения массива для быстрой сортировки
-int partition(int arr[], int low, int high) {
-    int pivot = arr[high];  // Выбираем последний элемент как опорный
-    int i = (low - 1);     // Индекс меньшего элемента
+// Начиная с этого размера подмассива опорный элемент выбирается как "ninther"
+// (медиана трех медиан из трех), для меньших - как медиана трех
+#define NINTHER_THRESHOLD 40
 
-    for (int j = low; j <= high - 1; j++) {
-        // Если текущий элемент меньше или равен опорному
-        if (arr[j] <= pivot) {
+// Функция для выбора индекса медианы из трех элементов
+int median_of_three(const int arr[], int i, int j, int k) {
+    if (arr[i] < arr[j]) {
+        if (arr[j] < arr[k]) return j;
+        return (arr[i] < arr[k]) ? k : i;
+    }
+    if (arr[i] < arr[k]) return i;
+    return (arr[j] < arr[k]) ? k : j;
+}
+
+// Функция для выбора опорного элемента: медиана трех или ninther по Тьюки.
+// На уже отсортированных и обратно отсортированных данных дает хорошее разбиение
+int choose_pivot(const int arr[], int low, int high) {
+    int mid = low + (high - low) / 2;
+    int n = high - low + 1;
+    if (n < NINTHER_THRESHOLD) {
+        return median_of_three(arr, low, mid, high);
+    }
+    int step = n / 8;
+    int m1 = median_of_three(arr, low, low + step, low + 2 * step);
+    int m2 = median_of_three(arr, mid - step, mid, mid + step);
+    int m3 = median_of_three(arr, high - 2 * step, high - step, high);
+    return median_of_three(arr, m1, m2, m3);
+}
+
+// Функция трехпутевого разделения (задача о голландском флаге) относительно значения pivot.
+// После разделения arr[low..*lt-1] < pivot, arr[*lt..*gt] == pivot, arr[*gt+1..high] > pivot,
+// поэтому элементы, равные опорному, больше не участвуют в рекурсии
+void partition3_value(int arr[], int low, int high, int pivot, int* lt, int* gt) {
+    int l = low, i = low, g = high;
+    
+    while (i <= g) {
+        if (arr[i] < pivot) {
+            swap(&arr[l++], &arr[i++]);
+        } else if (arr[i] > pivot) {
+            swap(&arr[i], &arr[g--]);
+        } else {
             i++;
-            swap(&arr[i], &arr[j]);
         }
     }
-    swap(&arr[i + 1], &arr[high]);
-    return (i + 1);
+    *lt = l;
+    *gt = g;
 }
 
-// Параллельная быстрая сортировка
-void quick_sort_parallel(int arr[], int low, int high, int threshold) {
-    if (low < high) {
-        // Если размер подмассива меньше порога, сортируем последовательно
+// Функция трехпутевого разделения подмассива с выбором опорного элемента
+void partition3(int arr[], int low, int high, int* lt, int* gt) {
+    partition3_value(arr, low, high, arr[choose_pivot(arr, low, high)], lt, gt);
+}
+
+// Начиная с этого размера подмассив разделяется параллельно
+#define PARALLEL_PARTITION_CUTOFF (1 << 16)
+
+// Размер блока при параллельном разделении (в элементах, блок помещается в кэш L2)
+#define PARTITION_BLOCK 16384
+
+// Функция параллельного трехпутевого разделения большого подмассива.
+// Потоки разделяют блоки размера PARTITION_BLOCK локально, затем префиксные суммы
+// по числу меньших, равных и больших элементов в блоках дают место каждой части
+// в итоговом порядке; части переносятся через буфер scratch[low..high] и копируются обратно.
+// Должна вызываться внутри параллельной области (блоки обрабатываются задачами taskloop)
+void partition3_parallel(int arr[], int low, int high, int* scratch, int* lt, int* gt) {
+    int n = high - low + 1;
+    int pivot = arr[choose_pivot(arr, low, high)];
+    int num_blocks = (n + PARTITION_BLOCK - 1) / PARTITION_BLOCK;
+    
+    // Для каждого блока: число меньших и равных опорному, затем смещения частей
+    int* counts = (int*)malloc(2 * num_blocks * sizeof(int));
+    int* offsets = (int*)malloc(3 * num_blocks * sizeof(int));
+    if (!counts || !offsets) {
+        free(counts);
+        free(offsets);
+        partition3_value(arr, low, high, pivot, lt, gt);
+        return;
+    }
+    
+    // Шаг 1: локальное разделение блоков
+    #pragma omp taskloop grainsize(1)
+    for (int blk = 0; blk < num_blocks; blk++) {
+        int b_low = low + blk * PARTITION_BLOCK;
+        int b_high = (b_low + PARTITION_BLOCK - 1 < high) ? b_low + PARTITION_BLOCK - 1 : high;
+        int l, g;
+        partition3_value(arr, b_low, b_high, pivot, &l, &g);
+        counts[2 * blk] = l - b_low;
+        counts[2 * blk + 1] = g - l + 1;
+    }
+    
+    // Шаг 2: префиксные суммы по блокам
+    int total_less = 0, total_equal = 0;
+    for (int blk = 0; blk < num_blocks; blk++) {
+        total_less += counts[2 * blk];
+        total_equal += counts[2 * blk + 1];
+    }
+    int less_pos = 0, equal_pos = total_less, greater_pos = total_less + total_equal;
+    for (int blk = 0; blk < num_blocks; blk++) {
+        int b_len = (blk == num_blocks - 1) ? n - blk * PARTITION_BLOCK : PARTITION_BLOCK;
+        offsets[3 * blk] = less_pos;
+        offsets[3 * blk + 1] = equal_pos;
+        offsets[3 * blk + 2] = greater_pos;
+        less_pos += counts[2 * blk];
+        equal_pos += counts[2 * blk + 1];
+        greater_pos += b_len - counts[2 * blk] - counts[2 * blk + 1];
+    }
+    
+    // Шаг 3: перенос частей каждого блока на свои места в буфере
+    int* dst = scratch + low;
+    #pragma omp taskloop grainsize(1)
+    for (int blk = 0; blk < num_blocks; blk++) {
+        int b_low = low + blk * PARTITION_BLOCK;
+        int b_len = (blk == num_blocks - 1) ? n - blk * PARTITION_BLOCK : PARTITION_BLOCK;
+        int less = counts[2 * blk];
+        int equal = counts[2 * blk + 1];
+        memcpy(dst + offsets[3 * blk], arr + b_low, less * sizeof(int));
+        memcpy(dst + offsets[3 * blk + 1], arr + b_low + less, equal * sizeof(int));
+        memcpy(dst + offsets[3 * blk + 2], arr + b_low + less + equal,
+               (b_len - less - equal) * sizeof(int));
+    }
+    
+    // Шаг 4: параллельное копирование результата обратно
+    #pragma omp taskloop grainsize(1)
+    for (int blk = 0; blk < num_blocks; blk++) {
+        int b_low = low + blk * PARTITION_BLOCK;
+        int b_len = (blk == num_blocks - 1) ? n - blk * PARTITION_BLOCK : PARTITION_BLOCK;
+        memcpy(arr + b_low, scratch + b_low, b_len * sizeof(int));
+    }
+    
+    *lt = low + total_less;
+    *gt = low + total_less + total_equal - 1;
+    free(counts);
+    free(offsets);
+}
+
+// Функция просеивания вниз для пирамидальной сортировки подмассива base[0..n-1]
+void sift_down(int* base, int root, int n) {
+    int value = base[root];
+    while (2 * root + 1 < n) {
+        int child = 2 * root + 1;
+        if (child + 1 < n && base[child + 1] > base[child]) {
+            child++;
+        }
+        if (base[child] <= value) {
+            break;
+        }
+        base[root] = base[child];
+        root = child;
+    }
+    base[root] = value;
+}
+
+// Пирамидальная сортировка подмассива arr[low..high] (O(n log n) в худшем случае)
+void heap_sort(int arr[], int low, int high) {
+    int* base = arr + low;
+    int n = high - low + 1;
+    for (int i = n / 2 - 1; i >= 0; i--) {
+        sift_down(base, i, n);
+    }
+    for (int end = n - 1; end > 0; end--) {
+        swap(&base[0], &base[end]);
+        sift_down(base, 0, end);
+    }
+}
+
+// Функция для вычисления допустимой глубины рекурсии быстрой сортировки (2 * log2(n)),
+// после которой подмассив досортировывается пирамидальной сортировкой
+int introsort_depth_limit(int size) {
+    int depth = 0;
+    while (size > 1) {
+        size >>= 1;
+        depth++;
+    }
+    return 2 * depth;
+}
+
+// Параллельная быстрая сортировка с трехпутевым разделением.
+// Если глубина рекурсии превышает depth_limit, подмассив сортируется
+// пирамидальной сортировкой (поведение интроспективной сортировки).
+// Подмассивы больше PARALLEL_PARTITION_CUTOFF разделяются всеми потоками через
+// буфер scratch того же размера, что и arr (если scratch == NULL - последовательно)
+void quick_sort_parallel(int arr[], int low, int high, int threshold, int depth_limit, int* scratch) {
+    while (low < high) {
+        if (depth_limit == 0) {
+            heap_sort(arr, low, high);
+            return;
+        }
+        depth_limit--;
+        
+        int lt, gt;
+        if (scratch && high - low + 1 >= PARALLEL_PARTITION_CUTOFF && omp_get_num_threads() > 1) {
+            partition3_parallel(arr, low, high, scratch, &lt, &gt);
+        } else {
+            partition3(arr, low, high, &lt, &gt);
+        }
+        
         if (high - low < threshold) {
-            // Используем последовательную версию для маленьких подмассивов
-            if (low < high) {
-                int pi = partition(arr, low, high);
-                quick_sort_parallel(arr, low, pi - 1, threshold);
-                quick_sort_parallel(arr, pi + 1, high, threshold);
+            // Маленький подмассив сортируем последовательно: рекурсия в меньшую часть,
+            // цикл по большей, чтобы глубина стека оставалась O(log n)
+            if (lt - low < high - gt) {
+                quick_sort_parallel(arr, low, lt - 1, threshold, depth_limit, scratch);
+                low = gt + 1;
+            } else {
+                quick_sort_parallel(arr, gt + 1, high, threshold, depth_limit, scratch);
+                high = lt - 1;
             }
         } else {
             // Параллельная сортировка для больших подмассивов
-            int pi = partition(arr, low, high);
-            
-            #pragma omp task firstprivate(arr, low, pi, threshold)
+            #pragma omp task firstprivate(arr, low, lt, threshold, depth_limit, scratch)
             {
-                quick_sort_parallel(arr, low, pi - 1, threshold);
+                quick_sort_parallel(arr, low, lt - 1, threshold, depth_limit, scratch);
             }
             
-            #pragma omp task firstprivate(arr, high, pi, threshold)
+            #pragma omp task firstprivate(arr, high, gt, threshold, depth_limit, scratch)
             {
-                quick_sort_parallel(arr, pi + 1, high, threshold);
+                quick_sort_parallel(arr, gt + 1, high, threshold, depth_limit, scratch);
             }
             
             // Ожидаем завершения всех задач
             #pragma omp taskwait
+            return;
         }
     }
 }
@@ -103,16 +516,996 @@ void parallel_quicksort(int arr[], int size, int num_threads, int threshold) {
     // Устанавливаем количество потоков
     omp_set_num_threads(num_threads);
     
+    // Буфер для параллельного разделения больших подмассивов (нужен только при нескольких потоках)
+    int* scratch = NULL;
+    if (num_threads > 1 && size >= PARALLEL_PARTITION_CUTOFF) {
+        scratch = (int*)malloc(size * sizeof(int));
+    }
+    
     // Запускаем параллельный регион с одной задачей
     #pragma omp parallel
     {
         #pragma omp single nowait
         {
-            quick_sort_parallel(arr, 0, size - 1, threshold);
+            quick_sort_parallel(arr, 0, size - 1, threshold, introsort_depth_limit(size), scratch);
+        }
+    }
+    
+    free(scratch);
+}
+
+// Параметры автонастройки: файл кэша в текущем каталоге, размер выборки и число повторов
+#define TUNE_CACHE_FILE "quicksort_tune.cache"
+#define TUNE_SAMPLE_SIZE (1 << 20)
+#define TUNE_REPEATS 3
+#define TUNE_MIN_THRESHOLD 512
+#define TUNE_MAX_THRESHOLD (1 << 18)
+
+// Настройка параллельной сортировки: число потоков и порог создания задач
+typedef struct {
+    int num_threads;
+    int threshold;
+} TuneConfig;
+
+// Функция для определения класса размера массива (floor(log2(size)))
+int size_class(int size) {
+    int cls = 0;
+    while (size > 1) {
+        size >>= 1;
+        cls++;
+    }
+    return cls;
+}
+
+// Функция для получения имени узла (ключ кэша настроек)
+void get_host_name(char* host, size_t length) {
+    if (gethostname(host, length) != 0 || host[0] == '\0') {
+        strncpy(host, "unknown", length);
+    }
+    host[length - 1] = '\0';
+    // Пробелы в имени сломали бы формат строки кэша
+    for (char* p = host; *p; p++) {
+        if (*p == ' ' || *p == '\t') *p = '_';
+    }
+}
+
+// Функция для поиска сохраненной настройки. Строка кэша:
+// <узел> <запрошено_потоков (0 - авто)> <класс_размера> <потоки> <порог>
+// Более поздние строки переопределяют более ранние.
+int load_tune_config(const char* host, int requested_threads, int cls, TuneConfig* config) {
+    FILE* file = fopen(TUNE_CACHE_FILE, "r");
+    if (!file) {
+        return 0;
+    }
+    
+    char line_host[256];
+    int line_requested, line_cls, line_threads, line_threshold;
+    int found = 0;
+    while (fscanf(file, "%255s %d %d %d %d", line_host, &line_requested, &line_cls,
+                  &line_threads, &line_threshold) == 5) {
+        if (strcmp(line_host, host) == 0 && line_requested == requested_threads &&
+            line_cls == cls && line_threads > 0 && line_threshold > 0) {
+            config->num_threads = line_threads;
+            config->threshold = line_threshold;
+            found = 1;
+        }
+    }
+    fclose(file);
+    return found;
+}
+
+// Функция для сохранения настройки (дописывается в конец кэша)
+void save_tune_config(const char* host, int requested_threads, int cls, const TuneConfig* config) {
+    FILE* file = fopen(TUNE_CACHE_FILE, "a");
+    if (!file) {
+        perror("Не удалось сохранить настройку в " TUNE_CACHE_FILE);
+        return;
+    }
+    fprintf(file, "%s %d %d %d %d\n", host, requested_threads, cls,
+            config->num_threads, config->threshold);
+    fclose(file);
+}
+
+// Функция для автонастройки: перебирает пороги (и число потоков, если оно не задано)
+// на равномерной выборке из массива и выбирает вариант с наименьшим временем
+int autotune_quicksort(const int arr[], int size, int requested_threads, TuneConfig* best) {
+    int sample_size = size < TUNE_SAMPLE_SIZE ? size : TUNE_SAMPLE_SIZE;
+    int* sample = (int*)malloc(sample_size * sizeof(int));
+    int* work = (int*)malloc(sample_size * sizeof(int));
+    if (!sample || !work) {
+        free(sample);
+        free(work);
+        return 0;
+    }
+    
+    // Выборка с постоянным шагом сохраняет распределение значений исходного массива
+    for (int i = 0; i < sample_size; i++) {
+        sample[i] = arr[(long long)i * size / sample_size];
+    }
+    
+    // Кандидаты по числу потоков: степени двойки до числа ядер и само число ядер
+    int max_threads = requested_threads > 0 ? requested_threads : omp_get_num_procs();
+    int min_threads = requested_threads > 0 ? requested_threads : 1;
+    
+    double best_time = -1.0;
+    for (int threads = min_threads; threads <= max_threads;
+         threads = (threads < max_threads && threads * 2 > max_threads) ? max_threads : threads * 2) {
+        for (int threshold = TUNE_MIN_THRESHOLD; threshold <= TUNE_MAX_THRESHOLD; threshold *= 4) {
+            double config_time = -1.0;
+            for (int rep = 0; rep < TUNE_REPEATS; rep++) {
+                memcpy(work, sample, sample_size * sizeof(int));
+                double start = omp_get_wtime();
+                parallel_quicksort(work, sample_size, threads, threshold);
+                double elapsed = omp_get_wtime() - start;
+                if (config_time < 0.0 || elapsed < config_time) {
+                    config_time = elapsed;
+                }
+            }
+            
+            if (best_time < 0.0 || config_time < best_time) {
+                best_time = config_time;
+                best->num_threads = threads;
+                best->threshold = threshold;
+            }
+            
+            // Больший порог на выборке уже означает последовательную сортировку
+            if (threshold >= sample_size) {
+                break;
+            }
+        }
+        if (threads == max_threads) {
+            break;
+        }
+    }
+    
+    free(sample);
+    free(work);
+    return 1;
+}
+
+// Функция для получения настройки: из кэша, а при его отсутствии (или force_tune) -
+// автонастройкой с последующим сохранением. Возвращает 1, если выполнялась настройка.
+int resolve_tune_config(const int arr[], int size, int requested_threads, int force_tune,
+                        TuneConfig* config) {
+    char host[256];
+    get_host_name(host, sizeof(host));
+    int cls = size_class(size);
+    
+    if (!force_tune && load_tune_config(host, requested_threads, cls, config)) {
+        return 0;
+    }
+    
+    if (!autotune_quicksort(arr, size, requested_threads, config)) {
+        // Без памяти под выборку используем значения по умолчанию
+        config->num_threads = requested_threads > 0 ? requested_threads : omp_get_num_procs();
+        config->threshold = TUNE_MIN_THRESHOLD * 16;
+        return 0;
+    }
+    save_tune_config(host, requested_threads, cls, config);
+    return 1;
+}
+
+// Параметры поразрядной сортировки: разряд 8 бит, 4 прохода для int32
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_PASSES (32 / RADIX_BITS)
+
+// Размер буфера записи на корзину в элементах (одна строка кэша в 64 байта)
+#define RADIX_WC_SIZE 16
+
+// Функция для получения разряда ключа: знаковый бит инвертируется,
+// чтобы отрицательные числа оказались перед положительными
+static inline unsigned radix_digit(int value, int shift) {
+    return (((unsigned)value ^ 0x80000000u) >> shift) & (RADIX_BUCKETS - 1);
+}
+
+// Параллельная поразрядная сортировка LSD для массива int32.
+// На каждом проходе потоки строят гистограммы своих диапазонов, префиксная сумма
+// по (разряд, поток) дает каждому потоку места для записи, а запись идет через
+// буферы размером в строку кэша на каждую корзину. Проходы, в которых все ключи
+// попадают в одну корзину, пропускаются. Возвращает 0 при ошибке выделения памяти
+int radix_sort_parallel(int arr[], int size, int num_threads) {
+    int* buffer = (int*)malloc((size > 0 ? size : 1) * sizeof(int));
+    int* counts = (int*)malloc((size_t)num_threads * RADIX_BUCKETS * sizeof(int));
+    if (!buffer || !counts) {
+        free(buffer);
+        free(counts);
+        return 0;
+    }
+    
+    int* src = arr;
+    int* dst = buffer;
+    int failed = 0;
+    
+    #pragma omp parallel num_threads(num_threads)
+    {
+        int tid = omp_get_thread_num();
+        int nthreads = omp_get_num_threads();
+        int begin = (int)((long)size * tid / nthreads);
+        int end = (int)((long)size * (tid + 1) / nthreads);
+        int* my_counts = counts + (size_t)tid * RADIX_BUCKETS;
+        
+        // Буферы записи потока: RADIX_WC_SIZE элементов на корзину
+        int* wc = NULL;
+        if (posix_memalign((void**)&wc, 64, RADIX_BUCKETS * RADIX_WC_SIZE * sizeof(int)) != 0) {
+            wc = NULL;
+            #pragma omp atomic write
+            failed = 1;
+        }
+        int fill[RADIX_BUCKETS];
+        int pos[RADIX_BUCKETS];
+        #pragma omp barrier
+        
+        for (int pass = 0; pass < RADIX_PASSES && !failed; pass++) {
+            int shift = pass * RADIX_BITS;
+            
+            // Гистограмма разрядов своего диапазона
+            memset(my_counts, 0, RADIX_BUCKETS * sizeof(int));
+            for (int i = begin; i < end; i++) {
+                my_counts[radix_digit(src[i], shift)]++;
+            }
+            #pragma omp barrier
+            
+            // Проход не нужен, если все ключи имеют одинаковый разряд
+            int skip = 0;
+            for (int d = 0; d < RADIX_BUCKETS && !skip; d++) {
+                int total = 0;
+                for (int t = 0; t < nthreads; t++) {
+                    total += counts[t * RADIX_BUCKETS + d];
+                }
+                skip = (total == size);
+            }
+            
+            if (!skip) {
+                // Префиксная сумма в порядке (разряд, поток) - позиции записи потока
+                int offset = 0;
+                for (int d = 0; d < RADIX_BUCKETS; d++) {
+                    for (int t = 0; t < nthreads; t++) {
+                        if (t == tid) {
+                            pos[d] = offset;
+                        }
+                        offset += counts[t * RADIX_BUCKETS + d];
+                    }
+                    fill[d] = 0;
+                }
+                
+                // Распределение по корзинам через буферы записи
+                for (int i = begin; i < end; i++) {
+                    int value = src[i];
+                    unsigned d = radix_digit(value, shift);
+                    int* slot = wc + d * RADIX_WC_SIZE;
+                    slot[fill[d]++] = value;
+                    if (fill[d] == RADIX_WC_SIZE) {
+                        memcpy(dst + pos[d], slot, RADIX_WC_SIZE * sizeof(int));
+                        pos[d] += RADIX_WC_SIZE;
+                        fill[d] = 0;
+                    }
+                }
+                for (int d = 0; d < RADIX_BUCKETS; d++) {
+                    memcpy(dst + pos[d], wc + d * RADIX_WC_SIZE, fill[d] * sizeof(int));
+                }
+            }
+            
+            // Все потоки дочитали гистограммы и дописали свои части
+            #pragma omp barrier
+            if (!skip) {
+                #pragma omp single
+                {
+                    int* tmp = src;
+                    src = dst;
+                    dst = tmp;
+                }
+            }
+        }
+        
+        free(wc);
+    }
+    
+    // После нечетного числа выполненных проходов результат находится в буфере
+    if (!failed && src != arr) {
+        memcpy(arr, src, size * sizeof(int));
+    }
+    
+    free(buffer);
+    free(counts);
+    return !failed;
+}
+
+// Сортировка подсчетом используется, если диапазон значений (max - min + 1), умноженный
+// на число потоков, не превышает размер массива: счетчики тогда занимают не больше
+// памяти, чем сам массив, а сортировка выполняется за O(n + k)
+
+// Функция для параллельной сортировки подсчетом. Сначала параллельно ищутся минимум
+// и максимум; если диапазон мал, потоки считают значения своих частей, счетчики
+// сливаются, а выходной массив заполняется параллельно равными по длине участками.
+// Возвращает 1, если массив отсортирован, и 0, если диапазон для нее слишком велик
+int counting_sort_parallel(int arr[], int size, int num_threads) {
+    if (size < 2) {
+        return 1;
+    }
+    
+    int min_value = arr[0], max_value = arr[0];
+    #pragma omp parallel for num_threads(num_threads) reduction(min:min_value) reduction(max:max_value)
+    for (int i = 0; i < size; i++) {
+        if (arr[i] < min_value) min_value = arr[i];
+        if (arr[i] > max_value) max_value = arr[i];
+    }
+    
+    long range = (long)max_value - min_value + 1;
+    if (range * num_threads > size) {
+        return 0;
+    }
+    
+    int k = (int)range;
+    int* counts = (int*)calloc((size_t)num_threads * k, sizeof(int));
+    int* starts = (int*)malloc((k + 1) * sizeof(int));
+    if (!counts || !starts) {
+        free(counts);
+        free(starts);
+        return 0;
+    }
+    
+    #pragma omp parallel num_threads(num_threads)
+    {
+        int tid = omp_get_thread_num();
+        int nthreads = omp_get_num_threads();
+        // Подсчет значений своей части массива
+        int* my_counts = counts + (size_t)tid * k;
+        int begin = (int)((long)size * tid / nthreads);
+        int end = (int)((long)size * (tid + 1) / nthreads);
+        for (int i = begin; i < end; i++) {
+            my_counts[arr[i] - min_value]++;
+        }
+        #pragma omp barrier
+        
+        // Слияние счетчиков потоков (по диапазонам значений)
+        #pragma omp for schedule(static)
+        for (int v = 0; v < k; v++) {
+            int total = 0;
+            for (int t = 0; t < nthreads; t++) {
+                total += counts[(size_t)t * k + v];
+            }
+            counts[v] = total;
+        }
+        
+        // Префиксная сумма: starts[v] - позиция первого элемента со значением min + v
+        #pragma omp single
+        {
+            starts[0] = 0;
+            for (int v = 0; v < k; v++) {
+                starts[v + 1] = starts[v] + counts[v];
+            }
+        }
+        
+        // Заполнение своего участка выходного массива: начальное значение
+        // находится двоичным поиском по префиксным суммам
+        int lo = 0, hi = k - 1;
+        while (lo < hi) {
+            int mid = (lo + hi + 1) / 2;
+            if (starts[mid] <= begin) {
+                lo = mid;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        for (int i = begin, v = lo; i < end; v++) {
+            int stop = (starts[v + 1] < end) ? starts[v + 1] : end;
+            for (; i < stop; i++) {
+                arr[i] = min_value + v;
+            }
+        }
+    }
+    
+    free(counts);
+    free(starts);
+    return 1;
+}
+
+// Параметры сортировки слиянием: размер подмассива для сортировки вставками,
+// порог параллельного слияния и размер части, сливаемой одной задачей
+#define MERGE_INSERTION_CUTOFF 32
+#define MERGE_PARALLEL_CUTOFF (1 << 16)
+#define MERGE_PIECE (1 << 15)
+
+// Порог создания задач по умолчанию, если он не задан в командной строке
+#define MERGE_DEFAULT_TASK_CUTOFF (1 << 14)
+
+// Функция для устойчивой сортировки вставками небольшого подмассива
+void insertion_sort(int arr[], int n) {
+    for (int i = 1; i < n; i++) {
+        int value = arr[i];
+        int j = i - 1;
+        while (j >= 0 && arr[j] > value) {
+            arr[j + 1] = arr[j];
+            j--;
+        }
+        arr[j + 1] = value;
+    }
+}
+
+// Функция для последовательного устойчивого слияния (при равенстве берется элемент из a)
+void merge_sequential(const int* a, int na, const int* b, int nb, int* out) {
+    int i = 0, j = 0, k = 0;
+    while (i < na && j < nb) {
+        out[k++] = (b[j] < a[i]) ? b[j++] : a[i++];
+    }
+    while (i < na) out[k++] = a[i++];
+    while (j < nb) out[k++] = b[j++];
+}
+
+// Функция для вычисления ко-ранга (точки на пути слияния): возвращает i такое, что
+// первые k элементов результата - это a[0..i) и b[0..k-i) с тем же правилом
+// равенства, что и в merge_sequential
+int merge_co_rank(int k, const int* a, int na, const int* b, int nb) {
+    int lo = k > nb ? k - nb : 0;
+    int hi = k < na ? k : na;
+    while (lo < hi) {
+        int i = lo + (hi - lo) / 2;
+        int j = k - i;
+        // a[i] должен войти в первые k элементов, если он не больше b[j - 1]
+        if (j > 0 && i < na && a[i] <= b[j - 1]) {
+            lo = i + 1;
+        } else {
+            hi = i;
+        }
+    }
+    return lo;
+}
+
+// Функция для параллельного слияния: результат режется на части по MERGE_PIECE элементов,
+// границы частей во входных массивах находятся через ко-ранг, части сливаются задачами
+void merge_parallel(const int* a, int na, const int* b, int nb, int* out) {
+    int total = na + nb;
+    if (total < MERGE_PARALLEL_CUTOFF || omp_get_num_threads() == 1) {
+        merge_sequential(a, na, b, nb, out);
+        return;
+    }
+    
+    int pieces = (total + MERGE_PIECE - 1) / MERGE_PIECE;
+    #pragma omp taskloop grainsize(1)
+    for (int p = 0; p < pieces; p++) {
+        int k_begin = (int)((long long)p * total / pieces);
+        int k_end = (int)((long long)(p + 1) * total / pieces);
+        int i_begin = merge_co_rank(k_begin, a, na, b, nb);
+        int i_end = merge_co_rank(k_end, a, na, b, nb);
+        merge_sequential(a + i_begin, i_end - i_begin,
+                         b + (k_begin - i_begin), (k_end - i_end) - (k_begin - i_begin),
+                         out + k_begin);
+    }
+}
+
+// Рекурсивная сортировка слиянием с чередованием буферов: данные лежат в src,
+// результат оказывается в tmp при to_tmp, иначе в src. Половины сортируются
+// в противоположный буфер, поэтому копирование нужно только в листьях рекурсии.
+void merge_sort_rec(int* src, int* tmp, int n, int to_tmp, int task_cutoff) {
+    if (n <= MERGE_INSERTION_CUTOFF) {
+        insertion_sort(src, n);
+        if (to_tmp) {
+            memcpy(tmp, src, n * sizeof(int));
+        }
+        return;
+    }
+    
+    int half = n / 2;
+    if (n > task_cutoff) {
+        #pragma omp task
+        merge_sort_rec(src, tmp, half, !to_tmp, task_cutoff);
+        merge_sort_rec(src + half, tmp + half, n - half, !to_tmp, task_cutoff);
+        #pragma omp taskwait
+    } else {
+        merge_sort_rec(src, tmp, half, !to_tmp, task_cutoff);
+        merge_sort_rec(src + half, tmp + half, n - half, !to_tmp, task_cutoff);
+    }
+    
+    const int* from = to_tmp ? src : tmp;
+    int* to = to_tmp ? tmp : src;
+    if (n > task_cutoff) {
+        merge_parallel(from, half, from + half, n - half, to);
+    } else {
+        merge_sequential(from, half, from + half, n - half, to);
+    }
+}
+
+// Функция для параллельной устойчивой сортировки слиянием: O(n log n) в худшем случае
+// при любых входных данных. Возвращает 0 при ошибке выделения памяти.
+int merge_sort_parallel(int arr[], int size, int num_threads, int task_cutoff) {
+    if (size < 2) {
+        return 1;
+    }
+    
+    int* tmp = (int*)malloc(size * sizeof(int));
+    if (!tmp) {
+        return 0;
+    }
+    
+    if (task_cutoff <= 0) {
+        task_cutoff = MERGE_DEFAULT_TASK_CUTOFF;
+    }
+    
+    #pragma omp parallel num_threads(num_threads)
+    {
+        #pragma omp single nowait
+        {
+            merge_sort_rec(arr, tmp, size, 0, task_cutoff);
+        }
+    }
+    
+    free(tmp);
+    return 1;
+}
+
+// Параметры внешней сортировки: бюджет памяти по умолчанию и минимальный (в МБ),
+// размер блока чтения текста и минимальный блок слияния (в элементах)
+#define EXTERNAL_DEFAULT_BUDGET_MB 256
+#define EXTERNAL_MIN_BUDGET_MB 16
+#define EXTERNAL_TEXT_BLOCK (1 << 20)
+#define EXTERNAL_MIN_MERGE_BLOCK (1 << 14)
+#define EXTERNAL_OUTPUT_FILE "sorted.bin"
+#define ARRAY_FILE_ALIGNMENT 64
+
+// Потоковое чтение входного массива порциями (без загрузки целиком)
+typedef struct {
+    int fd;
+    int binary;             // 1 - бинарный файл, 0 - текстовый
+    uint64_t remaining;     // Непрочитанных элементов бинарного файла
+    char* text;             // Буфер текста размера EXTERNAL_TEXT_BLOCK
+    size_t text_len;        // Необработанный хвост текста в буфере
+    int eof;                // Текстовый файл прочитан до конца
+} ArrayStream;
+
+// Функция для чтения ровно length байт (или до конца файла). Возвращает прочитанное число байт
+ssize_t read_full(int fd, void* buf, size_t length) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t got = read(fd, (char*)buf + done, length - done);
+        if (got < 0) {
+            return -1;
         }
+        if (got == 0) {
+            break;
+        }
+        done += (size_t)got;
+    }
+    return (ssize_t)done;
+}
+
+// Функция для записи length байт целиком (при ошибке программа завершается)
+void write_full(int fd, const void* buf, size_t length) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t put = write(fd, (const char*)buf + done, length - done);
+        if (put < 0) {
+            perror("Ошибка записи во временный файл");
+            exit(EXIT_FAILURE);
+        }
+        done += (size_t)put;
     }
 }
 
+// Функция для открытия входного массива на потоковое чтение:
+// сначала бинарный файл, при его отсутствии - текстовый
+void open_array_stream(const char* bin_filename, const char* txt_filename, ArrayStream* s) {
+    memset(s, 0, sizeof(*s));
+    s->fd = open(bin_filename, O_RDONLY);
+    if (s->fd >= 0) {
+        ArrayFileHeader header;
+        if (read_full(s->fd, &header, sizeof(header)) != (ssize_t)sizeof(header) ||
+            memcmp(header.magic, ARRAY_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+            header.elem_type != ARRAY_FILE_INT32 ||
+            lseek(s->fd, (off_t)header.data_offset, SEEK_SET) < 0) {
+            fprintf(stderr, "Ошибка: некорректный заголовок бинарного массива %s\n", bin_filename);
+            exit(EXIT_FAILURE);
+        }
+        s->binary = 1;
+        s->remaining = header.count;
+        posix_fadvise(s->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        return;
+    }
+    
+    s->fd = open(txt_filename, O_RDONLY);
+    s->text = (char*)malloc(EXTERNAL_TEXT_BLOCK);
+    if (s->fd < 0 || !s->text) {
+        perror("Ошибка при открытии файла");
+        exit(EXIT_FAILURE);
+    }
+    posix_fadvise(s->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+}
+
+// Функция для чтения очередной порции элементов (не более capacity) в out.
+// Возвращает число прочитанных элементов (0 - конец данных)
+long read_array_stream(ArrayStream* s, int* out, long capacity) {
+    if (s->binary) {
+        long n = (s->remaining < (uint64_t)capacity) ? (long)s->remaining : capacity;
+        if (read_full(s->fd, out, n * sizeof(int)) != (ssize_t)(n * sizeof(int))) {
+            fprintf(stderr, "Ошибка: бинарный массив короче заявленного в заголовке\n");
+            exit(EXIT_FAILURE);
+        }
+        s->remaining -= n;
+        return n;
+    }
+    
+    // Текст читается блоками; блок из L байт содержит не больше (L + 1) / 2 чисел,
+    // поэтому очередной блок читается, только пока для них есть место в out
+    long count = 0;
+    while (capacity - count > EXTERNAL_TEXT_BLOCK / 2 && !(s->eof && s->text_len == 0)) {
+        if (!s->eof) {
+            ssize_t got = read_full(s->fd, s->text + s->text_len, EXTERNAL_TEXT_BLOCK - s->text_len);
+            if (got < 0) {
+                perror("Ошибка чтения файла");
+                exit(EXIT_FAILURE);
+            }
+            s->text_len += (size_t)got;
+            s->eof = (s->text_len < EXTERNAL_TEXT_BLOCK);
+        }
+        
+        // Разбирается текст до последнего разделителя, незаконченное число переносится
+        size_t cut = s->text_len;
+        if (!s->eof) {
+            while (cut > 0 && !is_separator(s->text[cut - 1])) {
+                cut--;
+            }
+        }
+        if (cut == 0 && !s->eof) {
+            fprintf(stderr, "Ошибка: число в текстовом файле длиннее блока чтения\n");
+            exit(EXIT_FAILURE);
+        }
+        long parsed = parse_int_range(s->text, s->text + cut, out + count);
+        if (parsed < 0) {
+            fprintf(stderr, "Ошибка при чтении чисел из текстового файла\n");
+            exit(EXIT_FAILURE);
+        }
+        count += parsed;
+        memmove(s->text, s->text + cut, s->text_len - cut);
+        s->text_len -= cut;
+    }
+    return count;
+}
+
+// Функция для закрытия потокового чтения
+void close_array_stream(ArrayStream* s) {
+    close(s->fd);
+    free(s->text);
+}
+
+// Функция для создания временного файла серии. Файл сразу удаляется из каталога
+// и исчезает при закрытии дескриптора (каталог - TMPDIR или текущий)
+int create_run_file(void) {
+    const char* dir = getenv("TMPDIR");
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/quicksort_runXXXXXX", dir ? dir : ".");
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("Ошибка создания временного файла");
+        exit(EXIT_FAILURE);
+    }
+    unlink(path);
+    return fd;
+}
+
+// Чтение серии при слиянии: пока сливается текущий блок, следующий читается асинхронно
+typedef struct {
+    int fd;
+    off_t offset;           // Смещение следующего блока в файле
+    long remaining;         // Элементов, еще не запрошенных чтением
+    int* buf[2];            // Текущий блок и блок упреждающего чтения
+    long len, pos;          // Элементов в текущем блоке и позиция в нем
+    long block;             // Размер блока в элементах
+    struct aiocb cb;        // Запрос упреждающего чтения
+    int pending;
+} RunReader;
+
+// Функция для ожидания завершения асинхронной операции, возвращает число байт
+ssize_t wait_aio(struct aiocb* cb) {
+    const struct aiocb* list[1] = {cb};
+    while (aio_error(cb) == EINPROGRESS) {
+        aio_suspend(list, 1, NULL);
+    }
+    return aio_return(cb);
+}
+
+// Функция для запуска упреждающего чтения следующего блока серии в buf[1]
+void run_reader_prefetch(RunReader* r) {
+    if (r->remaining == 0) {
+        return;
+    }
+    long n = r->remaining < r->block ? r->remaining : r->block;
+    memset(&r->cb, 0, sizeof(r->cb));
+    r->cb.aio_fildes = r->fd;
+    r->cb.aio_buf = r->buf[1];
+    r->cb.aio_nbytes = n * sizeof(int);
+    r->cb.aio_offset = r->offset;
+    if (aio_read(&r->cb) != 0) {
+        perror("Ошибка асинхронного чтения");
+        exit(EXIT_FAILURE);
+    }
+    r->offset += n * sizeof(int);
+    r->remaining -= n;
+    r->pending = 1;
+}
+
+// Функция для перехода к следующему блоку серии. Возвращает 0, если серия закончилась
+int run_reader_next(RunReader* r) {
+    if (!r->pending) {
+        return 0;
+    }
+    ssize_t got = wait_aio(&r->cb);
+    if (got != (ssize_t)r->cb.aio_nbytes) {
+        fprintf(stderr, "Ошибка чтения временного файла\n");
+        exit(EXIT_FAILURE);
+    }
+    r->pending = 0;
+    
+    int* tmp = r->buf[0];
+    r->buf[0] = r->buf[1];
+    r->buf[1] = tmp;
+    r->len = got / sizeof(int);
+    r->pos = 0;
+    run_reader_prefetch(r);
+    return 1;
+}
+
+// Запись результата: заполненный блок пишется асинхронно, пока заполняется второй
+typedef struct {
+    int fd;
+    off_t offset;
+    int* buf[2];
+    long len, block;
+    struct aiocb cb;
+    int pending;
+} RunWriter;
+
+// Функция для асинхронной записи заполненного блока результата
+void run_writer_flush(RunWriter* w) {
+    if (w->pending) {
+        if (wait_aio(&w->cb) != (ssize_t)w->cb.aio_nbytes) {
+            fprintf(stderr, "Ошибка записи файла результата\n");
+            exit(EXIT_FAILURE);
+        }
+        w->pending = 0;
+    }
+    if (w->len == 0) {
+        return;
+    }
+    
+    memset(&w->cb, 0, sizeof(w->cb));
+    w->cb.aio_fildes = w->fd;
+    w->cb.aio_buf = w->buf[0];
+    w->cb.aio_nbytes = w->len * sizeof(int);
+    w->cb.aio_offset = w->offset;
+    if (aio_write(&w->cb) != 0) {
+        perror("Ошибка асинхронной записи");
+        exit(EXIT_FAILURE);
+    }
+    w->offset += w->len * sizeof(int);
+    w->pending = 1;
+    
+    int* tmp = w->buf[0];
+    w->buf[0] = w->buf[1];
+    w->buf[1] = tmp;
+    w->len = 0;
+}
+
+// Функция просеивания вниз для пирамиды номеров серий по текущему элементу серии
+void sift_down_runs(int* heap, int root, int n, const RunReader* runs) {
+    int run = heap[root];
+    int value = runs[run].buf[0][runs[run].pos];
+    while (2 * root + 1 < n) {
+        int child = 2 * root + 1;
+        if (child + 1 < n &&
+            runs[heap[child + 1]].buf[0][runs[heap[child + 1]].pos] <
+            runs[heap[child]].buf[0][runs[heap[child]].pos]) {
+            child++;
+        }
+        if (runs[heap[child]].buf[0][runs[heap[child]].pos] >= value) {
+            break;
+        }
+        heap[root] = heap[child];
+        root = child;
+    }
+    heap[root] = run;
+}
+
+// Функция для k-путевого слияния отсортированных серий из временных файлов
+// в файл результата (после заголовка). Блок каждой серии и вывода - block элементов
+void merge_run_files(const int* run_fds, const long* run_sizes, int k, long block, int out_fd) {
+    RunReader* runs = (RunReader*)calloc(k, sizeof(RunReader));
+    int* heap = (int*)malloc(k * sizeof(int));
+    RunWriter w;
+    memset(&w, 0, sizeof(w));
+    w.fd = out_fd;
+    w.offset = ARRAY_FILE_ALIGNMENT;
+    w.block = block;
+    w.buf[0] = (int*)malloc(block * sizeof(int));
+    w.buf[1] = (int*)malloc(block * sizeof(int));
+    if (!runs || !heap || !w.buf[0] || !w.buf[1]) {
+        perror("Ошибка выделения памяти для слияния");
+        exit(EXIT_FAILURE);
+    }
+    
+    int heap_size = 0;
+    for (int i = 0; i < k; i++) {
+        RunReader* r = &runs[i];
+        r->fd = run_fds[i];
+        r->remaining = run_sizes[i];
+        r->block = block;
+        r->buf[0] = (int*)malloc(block * sizeof(int));
+        r->buf[1] = (int*)malloc(block * sizeof(int));
+        if (!r->buf[0] || !r->buf[1]) {
+            perror("Ошибка выделения памяти для слияния");
+            exit(EXIT_FAILURE);
+        }
+        run_reader_prefetch(r);
+        if (run_reader_next(r)) {
+            heap[heap_size++] = i;
+        }
+    }
+    for (int i = heap_size / 2 - 1; i >= 0; i--) {
+        sift_down_runs(heap, i, heap_size, runs);
+    }
+    
+    while (heap_size > 0) {
+        RunReader* r = &runs[heap[0]];
+        w.buf[0][w.len++] = r->buf[0][r->pos++];
+        if (w.len == w.block) {
+            run_writer_flush(&w);
+        }
+        
+        // Серия исчерпана - она уходит из пирамиды
+        if (r->pos == r->len && !run_reader_next(r)) {
+            heap[0] = heap[--heap_size];
+        }
+        if (heap_size > 0) {
+            sift_down_runs(heap, 0, heap_size, runs);
+        }
+    }
+    run_writer_flush(&w);
+    run_writer_flush(&w);
+    
+    for (int i = 0; i < k; i++) {
+        free(runs[i].buf[0]);
+        free(runs[i].buf[1]);
+    }
+    free(runs);
+    free(heap);
+    free(w.buf[0]);
+    free(w.buf[1]);
+}
+
+// Функция для потоковой проверки отсортированности файла результата
+int is_sorted_file(int fd, long long count, long block) {
+    int* buf = (int*)malloc(block * sizeof(int));
+    if (!buf) {
+        return 0;
+    }
+    lseek(fd, ARRAY_FILE_ALIGNMENT, SEEK_SET);
+    long long seen = 0;
+    int prev = INT_MIN, ok = 1;
+    while (ok && seen < count) {
+        long n = (count - seen < block) ? (long)(count - seen) : block;
+        if (read_full(fd, buf, n * sizeof(int)) != (ssize_t)(n * sizeof(int))) {
+            ok = 0;
+            break;
+        }
+        for (long i = 0; i < n; i++) {
+            ok &= (buf[i] >= prev);
+            prev = buf[i];
+        }
+        seen += n;
+    }
+    free(buf);
+    return ok;
+}
+
+// Функция для внешней сортировки массива, не помещающегося в память:
+// 1) вход читается сериями по размеру бюджета, каждая серия сортируется
+//    параллельной быстрой сортировкой и сбрасывается во временный файл;
+// 2) серии сливаются k-путевым слиянием большими последовательными блоками
+//    с асинхронным упреждающим чтением и записью в EXTERNAL_OUTPUT_FILE.
+// Память ограничена budget_mb мегабайтами (без учета служебных структур)
+int external_sort(int num_threads, int threshold, int requested_threads, long budget_mb) {
+    size_t budget = (size_t)budget_mb << 20;
+    
+    // Серия сортируется на месте, но параллельному разделению нужен буфер того же размера
+    // (число потоков может выбрать автонастройка, поэтому буфер учитывается всегда)
+    long run_capacity = (long)(budget / (2 * sizeof(int)));
+    if (run_capacity > INT_MAX) {
+        run_capacity = INT_MAX;
+    }
+    int* run = (int*)malloc(run_capacity * sizeof(int));
+    if (!run) {
+        perror("Ошибка выделения памяти для серии");
+        return 1;
+    }
+    
+    ArrayStream stream;
+    open_array_stream("array.bin", "array.txt", &stream);
+    
+    // Фаза 1: формирование отсортированных серий
+    double runs_start = omp_get_wtime();
+    int run_count = 0, run_alloc = 16;
+    int* run_fds = (int*)malloc(run_alloc * sizeof(int));
+    long* run_sizes = (long*)malloc(run_alloc * sizeof(long));
+    long long total = 0;
+    long n;
+    while (run_fds && run_sizes && (n = read_array_stream(&stream, run, run_capacity)) > 0) {
+        if (threshold == 0) {
+            TuneConfig config;
+            resolve_tune_config(run, (int)n, requested_threads, 0, &config);
+            num_threads = config.num_threads;
+            threshold = config.threshold;
+        }
+        parallel_quicksort(run, (int)n, num_threads, threshold);
+        
+        if (run_count == run_alloc) {
+            run_alloc *= 2;
+            run_fds = (int*)realloc(run_fds, run_alloc * sizeof(int));
+            run_sizes = (long*)realloc(run_sizes, run_alloc * sizeof(long));
+            if (!run_fds || !run_sizes) {
+                break;
+            }
+        }
+        run_fds[run_count] = create_run_file();
+        write_full(run_fds[run_count], run, n * sizeof(int));
+        run_sizes[run_count] = n;
+        run_count++;
+        total += n;
+    }
+    close_array_stream(&stream);
+    free(run);
+    if (!run_fds || !run_sizes) {
+        perror("Ошибка выделения памяти для списка серий");
+        return 1;
+    }
+    double runs_time = omp_get_wtime() - runs_start;
+    
+    // Фаза 2: слияние. На каждую серию и на вывод - по два блока (текущий и асинхронный)
+    long block = (long)(budget / (2 * sizeof(int) * (size_t)(run_count + 1)));
+    if (block < EXTERNAL_MIN_MERGE_BLOCK) {
+        printf("Предупреждение: серий слишком много для бюджета, блок слияния увеличен до %d элементов\n",
+               EXTERNAL_MIN_MERGE_BLOCK);
+        block = EXTERNAL_MIN_MERGE_BLOCK;
+    }
+    
+    int out_fd = open(EXTERNAL_OUTPUT_FILE, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (out_fd < 0) {
+        perror("Ошибка создания файла результата");
+        return 1;
+    }
+    unsigned char header_block[ARRAY_FILE_ALIGNMENT] = {0};
+    ArrayFileHeader header;
+    memcpy(header.magic, ARRAY_FILE_MAGIC, sizeof(header.magic));
+    header.elem_type = ARRAY_FILE_INT32;
+    header.alignment = ARRAY_FILE_ALIGNMENT;
+    header.count = (uint64_t)total;
+    header.data_offset = ARRAY_FILE_ALIGNMENT;
+    memcpy(header_block, &header, sizeof(header));
+    write_full(out_fd, header_block, sizeof(header_block));
+    
+    double merge_start = omp_get_wtime();
+    merge_run_files(run_fds, run_sizes, run_count, block, out_fd);
+    double merge_time = omp_get_wtime() - merge_start;
+    
+    int sorted = is_sorted_file(out_fd, total, block);
+    close(out_fd);
+    for (int i = 0; i < run_count; i++) {
+        close(run_fds[i]);
+    }
+    free(run_fds);
+    free(run_sizes);
+    
+    printf("Внешняя сортировка (бюджет памяти %ld МБ)\n", budget_mb);
+    printf("Количество потоков: %d\n", num_threads);
+    printf("Порог параллелизма: %d\n", threshold);
+    printf("Размер массива: %lld элементов\n", total);
+    printf("Серий: %d по %ld элементов, блок слияния: %ld элементов\n", run_count, run_capacity, block);
+    printf("Время формирования серий: %.6f секунд\n", runs_time);
+    printf("Время слияния: %.6f секунд\n", merge_time);
+    printf("Пропускная способность: %.2f ключей/сек\n", total / (runs_time + merge_time));
+    printf(sorted ? "Результат записан в " EXTERNAL_OUTPUT_FILE ", массив отсортирован корректно\n"
+                  : "Ошибка: массив в " EXTERNAL_OUTPUT_FILE " не отсортирован корректно!\n");
+    return sorted ? 0 : 1;
+}
+
 // Функция для проверки отсортированности массива
 int is_sorted(const int arr[], int size) {
     for (int i = 0; i < size - 1; i++) {
@@ -123,36 +1516,402 @@ int is_sorted(const int arr[], int size) {
     return 1;  // Отсортирован
 }
 
+// Функция для выбора k-го по порядку элемента подмассива arr[low..high] (аналог nth_element).
+// После вызова arr[k] стоит на своем месте, слева от него элементы не больше, справа - не меньше.
+// Большие подмассивы разделяются параллельно (нужна параллельная область и scratch),
+// при слишком глубоком спуске оставшийся подмассив сортируется пирамидальной сортировкой
+int quickselect_range(int arr[], int low, int high, int k, int* scratch) {
+    int depth_limit = introsort_depth_limit(high - low + 1);
+    while (low < high) {
+        if (depth_limit-- == 0) {
+            heap_sort(arr, low, high);
+            break;
+        }
+        
+        int lt, gt;
+        if (scratch && high - low + 1 >= PARALLEL_PARTITION_CUTOFF) {
+            partition3_parallel(arr, low, high, scratch, &lt, &gt);
+        } else {
+            partition3(arr, low, high, &lt, &gt);
+        }
+        
+        if (k < lt) {
+            high = lt - 1;
+        } else if (k > gt) {
+            low = gt + 1;
+        } else {
+            break;  // k попал в часть, равную опорному элементу
+        }
+    }
+    return arr[k];
+}
+
+// Функция для параллельного выбора нескольких порядковых статистик без полной сортировки.
+// ranks должны идти по возрастанию: каждый следующий выбор ищется только правее предыдущего
+void select_ranks_parallel(int arr[], int size, const int ranks[], int count, int num_threads, int values[]) {
+    int* scratch = NULL;
+    if (num_threads > 1 && size >= PARALLEL_PARTITION_CUTOFF) {
+        scratch = (int*)malloc(size * sizeof(int));
+    }
+    
+    #pragma omp parallel num_threads(num_threads)
+    {
+        #pragma omp single
+        {
+            int low = 0;
+            for (int i = 0; i < count; i++) {
+                values[i] = quickselect_range(arr, low, size - 1, ranks[i], scratch);
+                low = ranks[i];
+            }
+        }
+    }
+    
+    free(scratch);
+}
+
+// Функция просеивания вниз для неубывающей (min) пирамиды heap[0..n-1]
+void sift_down_min(int* heap, int root, int n) {
+    int value = heap[root];
+    while (2 * root + 1 < n) {
+        int child = 2 * root + 1;
+        if (child + 1 < n && heap[child + 1] < heap[child]) {
+            child++;
+        }
+        if (heap[child] >= value) {
+            break;
+        }
+        heap[root] = heap[child];
+        root = child;
+    }
+    heap[root] = value;
+}
+
+// Функция для добавления значения в min-пирамиду k наибольших элементов:
+// пока пирамида не заполнена, значения просто дописываются (пирамида строится при заполнении)
+static inline void push_top_k(int* heap, int* count, int k, int value) {
+    if (*count < k) {
+        heap[(*count)++] = value;
+        if (*count == k) {
+            for (int i = k / 2 - 1; i >= 0; i--) {
+                sift_down_min(heap, i, k);
+            }
+        }
+    } else if (value > heap[0]) {
+        heap[0] = value;
+        sift_down_min(heap, 0, k);
+    }
+}
+
+// Функция для поиска k наибольших элементов: каждый поток ведет свою min-пирамиду
+// размера k по своей части массива, затем пирамиды сливаются в одну.
+// Результат записывается в out по убыванию; возвращает число найденных элементов
+// (min(k, size)) или -1 при ошибке выделения памяти
+int top_k_parallel(const int arr[], int size, int k, int num_threads, int out[]) {
+    if (k > size) {
+        k = size;
+    }
+    if (k <= 0) {
+        return 0;
+    }
+    
+    int* heaps = (int*)malloc((size_t)num_threads * k * sizeof(int));
+    int* counts = (int*)calloc(num_threads, sizeof(int));
+    if (!heaps || !counts) {
+        free(heaps);
+        free(counts);
+        return -1;
+    }
+    
+    #pragma omp parallel num_threads(num_threads)
+    {
+        int tid = omp_get_thread_num();
+        int* heap = heaps + (size_t)tid * k;
+        int count = 0;
+        
+        #pragma omp for schedule(static)
+        for (int i = 0; i < size; i++) {
+            push_top_k(heap, &count, k, arr[i]);
+        }
+        counts[tid] = count;
+    }
+    
+    // Слияние пирамид потоков: кандидатов не больше num_threads * k
+    int count = 0;
+    for (int t = 0; t < num_threads; t++) {
+        const int* heap = heaps + (size_t)t * k;
+        for (int i = 0; i < counts[t]; i++) {
+            push_top_k(out, &count, k, heap[i]);
+        }
+    }
+    
+    // Извлечение минимумов с конца дает порядок по убыванию
+    for (int end = k - 1; end > 0; end--) {
+        int min_value = out[0];
+        out[0] = out[end];
+        out[end] = min_value;
+        sift_down_min(out, 0, end);
+    }
+    
+    free(heaps);
+    free(counts);
+    return k;
+}
+
+// Функция для подсчета элементов меньше value и не больше value (проверка ранга)
+void count_rank(const int arr[], int size, int value, long long* less, long long* less_equal) {
+    long long l = 0, le = 0;
+    #pragma omp parallel for reduction(+:l, le)
+    for (int i = 0; i < size; i++) {
+        l += arr[i] < value;
+        le += arr[i] <= value;
+    }
+    *less = l;
+    *less_equal = le;
+}
+
+// Максимальное число квантилей в одном запуске
+#define MAX_SELECT_QUERIES 16
+
+// Запрос квантиля: доля p (0..1), подпись из командной строки и найденное значение
+typedef struct {
+    double p;
+    const char* label;
+    int rank;
+    int value;
+} SelectQuery;
+
+// Функция для разбора запроса выбора: median, p<процент> (например p99 или p99.9)
+// или top<k>. Возвращает 1, если аргумент оказался запросом выбора
+int parse_select_arg(const char* arg, SelectQuery* queries, int* query_count, int* top_k) {
+    double p;
+    if (strcmp(arg, "median") == 0) {
+        p = 0.5;
+    } else if (arg[0] == 'p' && arg[1] != '\0') {
+        char* end;
+        p = strtod(arg + 1, &end) / 100.0;
+        if (*end != '\0' || p < 0.0 || p > 1.0) {
+            return 0;
+        }
+    } else if (strncmp(arg, "top", 3) == 0 && arg[3] != '\0') {
+        char* end;
+        long k = strtol(arg + 3, &end, 10);
+        if (*end != '\0' || k <= 0 || k > INT_MAX) {
+            return 0;
+        }
+        *top_k = (int)k;
+        return 1;
+    } else {
+        return 0;
+    }
+    
+    if (*query_count >= MAX_SELECT_QUERIES) {
+        printf("Слишком много квантилей (не более %d), %s пропущен\n", MAX_SELECT_QUERIES, arg);
+        return 1;
+    }
+    queries[*query_count].p = p;
+    queries[*query_count].label = arg;
+    (*query_count)++;
+    return 1;
+}
+
+// Функция для выполнения запросов выбора над копией массива work и вывода результатов.
+// Исходный массив array используется для проверки рангов найденных значений
+int run_selection(const int array[], int work[], int size, int num_threads,
+                  SelectQuery* queries, int query_count, int top_k) {
+    if (size == 0) {
+        printf("Массив пуст\n");
+        return 1;
+    }
+    
+    // Ранг квантиля по ближайшему рангу: ceil(p * n) - 1; запросы упорядочиваются по рангу
+    for (int i = 0; i < query_count; i++) {
+        double position = queries[i].p * size;
+        long long rank = (long long)position;
+        if (rank < position) {
+            rank++;
+        }
+        rank--;
+        queries[i].rank = rank < 0 ? 0 : (rank >= size ? size - 1 : (int)rank);
+    }
+    for (int i = 1; i < query_count; i++) {
+        SelectQuery q = queries[i];
+        int j = i - 1;
+        while (j >= 0 && queries[j].rank > q.rank) {
+            queries[j + 1] = queries[j];
+            j--;
+        }
+        queries[j + 1] = q;
+    }
+    
+    int ranks[MAX_SELECT_QUERIES], values[MAX_SELECT_QUERIES];
+    for (int i = 0; i < query_count; i++) {
+        ranks[i] = queries[i].rank;
+    }
+    
+    double select_start = omp_get_wtime();
+    select_ranks_parallel(work, size, ranks, query_count, num_threads, values);
+    double select_time = omp_get_wtime() - select_start;
+    
+    int* top = NULL;
+    int top_count = 0;
+    double top_time = 0.0;
+    if (top_k > 0) {
+        top = (int*)malloc((top_k < size ? top_k : size) * sizeof(int));
+        double top_start = omp_get_wtime();
+        top_count = top ? top_k_parallel(array, size, top_k, num_threads, top) : -1;
+        top_time = omp_get_wtime() - top_start;
+        if (top_count < 0) {
+            perror("Ошибка выделения памяти для поиска наибольших элементов");
+            free(top);
+            return 1;
+        }
+    }
+    
+    printf("Параллельный выбор без полной сортировки\n");
+    printf("Количество потоков: %d\n", num_threads);
+    printf("Размер массива: %d элементов\n", size);
+    
+    int correct = 1;
+    for (int i = 0; i < query_count; i++) {
+        queries[i].value = values[i];
+        long long less, less_equal;
+        count_rank(array, size, values[i], &less, &less_equal);
+        correct &= (less <= ranks[i] && ranks[i] < less_equal);
+        printf("Квантиль %s (ранг %d): %d\n", queries[i].label, ranks[i], values[i]);
+    }
+    if (query_count > 0) {
+        printf("Время выбора квантилей: %.6f секунд\n", select_time);
+    }
+    
+    if (top_count > 0) {
+        printf("Наибольшие %d значений:", top_count);
+        for (int i = 0; i < top_count && i < 10; i++) {
+            printf(" %d", top[i]);
+        }
+        printf(top_count > 10 ? " ...\n" : "\n");
+        printf("Время поиска наибольших значений: %.6f секунд\n", top_time);
+        
+        // Ровно top_count элементов не меньше последнего найденного (с учетом повторов)
+        long long less, less_equal;
+        count_rank(array, size, top[top_count - 1], &less, &less_equal);
+        correct &= (size - less_equal < top_count && size - less >= top_count);
+        for (int i = 1; i < top_count; i++) {
+            correct &= (top[i - 1] >= top[i]);
+        }
+    }
+    
+    printf(correct ? "Проверка рангов: значения выбраны корректно\n"
+                   : "Ошибка: ранги выбранных значений не совпадают\n");
+    free(top);
+    return correct ? 0 : 1;
+}
+
+// Алгоритм сортировки, выбираемый в командной строке
+typedef enum {
+    SORT_QUICK,
+    SORT_RADIX,
+    SORT_MERGE
+} SortAlgorithm;
+
 int main(int argc, char* argv[]) {
     // Проверка аргументов командной строки
-    if (argc != 3) {
-        printf("Использование: %s <количество_потоков> <порог>\n", argv[0]);
-        printf("  порог - минимальный размер подмассива для параллельной обработки\n");
+    if (argc < 2) {
+        printf("Использование: %s <количество_потоков|auto> [<порог>|tune] [quick|radix|merge] [median|p<процент>|top<k> ...] [external[<МБ>]]\n", argv[0]);
+        printf("  auto  - число потоков выбирается автонастройкой (для quick)\n");
+        printf("  порог - минимальный размер подмассива для параллельной обработки;\n");
+        printf("          если не задан, берется из " TUNE_CACHE_FILE " или подбирается автоматически\n");
+        printf("  tune  - заново подобрать порог (и число потоков) и обновить кэш\n");
+        printf("  quick - быстрая сортировка (по умолчанию), radix - поразрядная сортировка,\n");
+        printf("  merge - устойчивая сортировка слиянием (порог задает размер задачи);\n");
+        printf("          если алгоритм не указан и диапазон значений мал, массив сортируется подсчетом\n");
+        printf("  median, p<процент>, top<k> - выбор медианы, квантиля (например p99)\n");
+        printf("          или k наибольших значений вместо полной сортировки\n");
+        printf("  external[<МБ>] - внешняя сортировка сериями в пределах бюджета памяти\n");
+        printf("          (по умолчанию %d МБ), результат записывается в " EXTERNAL_OUTPUT_FILE "\n",
+               EXTERNAL_DEFAULT_BUDGET_MB);
         return 1;
     }
     
-    int num_threads = atoi(argv[1]);
-    int threshold = atoi(argv[2]);
+    // 0 означает, что значение выбирается автонастройкой
+    int num_threads = strcmp(argv[1], "auto") == 0 ? 0 : atoi(argv[1]);
+    int threshold = 0;
+    int force_tune = 0;
+    SortAlgorithm algorithm = SORT_QUICK;
+    SelectQuery queries[MAX_SELECT_QUERIES];
+    int query_count = 0;
+    int top_k = 0;
+    long external_budget_mb = 0;
+    int algorithm_chosen = 0;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "radix") == 0) {
+            algorithm = SORT_RADIX;
+            algorithm_chosen = 1;
+        } else if (strcmp(argv[i], "merge") == 0) {
+            algorithm = SORT_MERGE;
+            algorithm_chosen = 1;
+        } else if (strcmp(argv[i], "quick") == 0) {
+            algorithm = SORT_QUICK;
+            algorithm_chosen = 1;
+        } else if (strcmp(argv[i], "tune") == 0) {
+            force_tune = 1;
+        } else if (strncmp(argv[i], "external", 8) == 0) {
+            char* end;
+            external_budget_mb = argv[i][8] ? strtol(argv[i] + 8, &end, 10) : EXTERNAL_DEFAULT_BUDGET_MB;
+            if ((argv[i][8] && *end != '\0') || external_budget_mb < EXTERNAL_MIN_BUDGET_MB) {
+                printf("Бюджет внешней сортировки должен быть не меньше %d МБ\n", EXTERNAL_MIN_BUDGET_MB);
+                return 1;
+            }
+        } else if (parse_select_arg(argv[i], queries, &query_count, &top_k)) {
+            // Запрос квантиля или наибольших значений
+        } else {
+            threshold = atoi(argv[i]);
+            if (threshold <= 0) {
+                printf("Неизвестный аргумент: %s (ожидается порог, tune, quick, radix, merge, median, p<процент>, top<k> или external)\n", argv[i]);
+                return 1;
+            }
+        }
+    }
     
-    if (num_threads <= 0 || threshold <= 0) {
-        printf("Количество потоков и порог должны быть положительными числами\n");
+    if (num_threads < 0 || (num_threads == 0 && strcmp(argv[1], "auto") != 0)) {
+        printf("Количество потоков должно быть положительным числом или auto\n");
+        return 1;
+    }
+    if (num_threads == 0 && threshold > 0) {
+        printf("При заданном пороге количество потоков тоже должно быть задано\n");
         return 1;
     }
     
+    // Для загрузки и сортировок без автонастройки используются все ядра
+    int requested_threads = num_threads;
+    if (num_threads == 0) {
+        num_threads = omp_get_num_procs();
+    }
+    
+    // Количество потоков задается до чтения файла, чтобы разбор шел тем же числом потоков
+    omp_set_num_threads(num_threads);
+    
     int size;
     double start_time, end_time;
     
     // Замер времени начала выполнения
     start_time = omp_get_wtime();
     
-    // Чтение массива из файла
-    int* array = read_array_from_file("array.txt", &size);
+    // Внешняя сортировка читает вход порциями и не загружает его целиком
+    if (external_budget_mb > 0) {
+        int rc = external_sort(num_threads, threshold, requested_threads, external_budget_mb);
+        printf("Время выполнения: %.6f секунд\n", omp_get_wtime() - start_time);
+        return rc;
+    }
+    
+    // Загрузка массива (array.bin отображается в память, иначе читается array.txt)
+    MappedArray mapped;
+    int* array = load_array("array.bin", "array.txt", &size, &mapped);
     
     // Создаем копию массива для сортировки
     int* array_to_sort = (int*)malloc(size * sizeof(int));
     if (!array_to_sort) {
         perror("Ошибка выделения памяти");
-        free(array);
+        release_array(array, &mapped);
         return 1;
     }
     
@@ -161,8 +1920,53 @@ int main(int argc, char* argv[]) {
         array_to_sort[i] = array[i];
     }
     
+    // Если запрошены только квантили или наибольшие значения, полная сортировка не нужна
+    if (query_count > 0 || top_k > 0) {
+        int rc = run_selection(array, array_to_sort, size, num_threads, queries, query_count, top_k);
+        printf("Время выполнения: %.6f секунд\n", omp_get_wtime() - start_time);
+        release_array(array, &mapped);
+        free(array_to_sort);
+        return rc;
+    }
+    
     // Параллельная сортировка
-    parallel_quicksort(array_to_sort, size, num_threads, threshold);
+    // Если алгоритм не указан явно и диапазон значений мал, вместо быстрой сортировки
+    // массив сортируется подсчетом за O(n + k); явно выбранный алгоритм выполняется как есть
+    double sort_start = omp_get_wtime();
+    double tune_time = 0.0;
+    int tuned = 0;
+    int resolved = 0;
+    int counted = !algorithm_chosen && counting_sort_parallel(array_to_sort, size, num_threads);
+    if (counted) {
+        // Массив уже отсортирован
+    } else if (algorithm == SORT_MERGE) {
+        if (!merge_sort_parallel(array_to_sort, size, num_threads, threshold)) {
+            perror("Ошибка выделения памяти для сортировки слиянием");
+            release_array(array, &mapped);
+            free(array_to_sort);
+            return 1;
+        }
+    } else if (algorithm == SORT_RADIX) {
+        if (!radix_sort_parallel(array_to_sort, size, num_threads)) {
+            perror("Ошибка выделения памяти для поразрядной сортировки");
+            release_array(array, &mapped);
+            free(array_to_sort);
+            return 1;
+        }
+    } else {
+        // Порог не задан: берем настройку из кэша или подбираем ее на выборке
+        if (threshold == 0 || force_tune) {
+            double tune_start = omp_get_wtime();
+            TuneConfig config;
+            tuned = resolve_tune_config(array_to_sort, size, requested_threads, force_tune, &config);
+            tune_time = omp_get_wtime() - tune_start;
+            num_threads = config.num_threads;
+            threshold = config.threshold;
+            resolved = 1;
+        }
+        parallel_quicksort(array_to_sort, size, num_threads, threshold);
+    }
+    double sort_time = omp_get_wtime() - sort_start - tune_time;
     
     // Проверка корректности сортировки
     if (!is_sorted(array_to_sort, size)) {
@@ -173,14 +1977,29 @@ int main(int argc, char* argv[]) {
     end_time = omp_get_wtime();
     
     // Вывод результатов
-    printf("Параллельная быстрая сортировка\n");
+    const char* algorithm_names[] = {"быстрая сортировка", "поразрядная сортировка", "сортировка слиянием"};
+    printf("Параллельная %s\n", algorithm_names[algorithm]);
     printf("Количество потоков: %d\n", num_threads);
-    printf("Порог параллелизма: %d\n", threshold);
+    if (algorithm == SORT_MERGE && !counted) {
+        printf("Порог создания задач: %d\n", threshold > 0 ? threshold : MERGE_DEFAULT_TASK_CUTOFF);
+    } else if (algorithm == SORT_QUICK && !counted) {
+        printf("Порог параллелизма: %d\n", threshold);
+        if (tuned) {
+            printf("Автонастройка: %.6f секунд (сохранено в " TUNE_CACHE_FILE ")\n", tune_time);
+        } else if (resolved) {
+            printf("Настройка взята из " TUNE_CACHE_FILE "\n");
+        }
+    }
     printf("Размер массива: %d элементов\n", size);
     printf("Время выполнения: %.6f секунд\n", end_time - start_time);
+    if (counted) {
+        printf("Использована сортировка подсчетом (малый диапазон значений)\n");
+    }
+    printf("Время сортировки: %.6f секунд\n", sort_time);
+    printf("Пропускная способность: %.2f ключей/сек\n", size / sort_time);
     
     // Освобождение памяти
-    free(array);
+    release_array(array, &mapped);
     free(array_to_sort);
     
     return 0;
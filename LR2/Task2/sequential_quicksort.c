@@ -1,6 +1,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 // Функция для чтения массива из файла
 int* read_array_from_file(const char* filename, int* size) {
@@ -43,6 +50,92 @@ int* read_array_from_file(const char* filename, int* size) {
     return arr;
 }
 
+// Бинарный формат массива: заголовок ArrayFileHeader, затем сырые данные,
+// начинающиеся со смещения data_offset (кратного alignment)
+#define ARRAY_FILE_MAGIC "PCSARR01"
+#define ARRAY_FILE_INT32 1
+#define ARRAY_FILE_FLOAT64 2
+
+typedef struct {
+    char magic[8];          // Сигнатура ARRAY_FILE_MAGIC
+    uint32_t elem_type;     // Тип элементов (ARRAY_FILE_INT32 / ARRAY_FILE_FLOAT64)
+    uint32_t alignment;     // Выравнивание начала данных в байтах
+    uint64_t count;         // Количество элементов
+    uint64_t data_offset;   // Смещение данных от начала файла
+} ArrayFileHeader;
+
+// Отображение бинарного файла в память
+typedef struct {
+    void* base;             // Начало отображения (NULL, если массив прочитан из текста)
+    size_t length;          // Длина отображения в байтах
+} MappedArray;
+
+// Функция для отображения бинарного массива в память (без разбора и копирования).
+// Возвращает указатель на данные или NULL, если файла нет
+void* map_array_file(const char* filename, uint32_t elem_type, int* size, MappedArray* mapped) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ArrayFileHeader)) {
+        fprintf(stderr, "Ошибка: файл %s не является бинарным массивом\n", filename);
+        exit(EXIT_FAILURE);
+    }
+
+    // Закрытое отображение с правом записи: страницы копируются только при изменении
+    void* base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("Ошибка отображения файла в память");
+        exit(EXIT_FAILURE);
+    }
+
+    // Проверка заголовка
+    const ArrayFileHeader* header = (const ArrayFileHeader*)base;
+    size_t elem_size = (elem_type == ARRAY_FILE_INT32) ? sizeof(int32_t) : sizeof(double);
+    if (memcmp(header->magic, ARRAY_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->elem_type != elem_type ||
+        header->alignment == 0 || header->data_offset % header->alignment != 0 ||
+        header->count > INT_MAX ||
+        header->data_offset + header->count * elem_size > (uint64_t)st.st_size) {
+        fprintf(stderr, "Ошибка: некорректный заголовок бинарного массива %s\n", filename);
+        munmap(base, (size_t)st.st_size);
+        exit(EXIT_FAILURE);
+    }
+
+    // Данные читаются последовательно - подсказываем ядру упреждающее чтение
+    madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    mapped->base = base;
+    mapped->length = (size_t)st.st_size;
+    *size = (int)header->count;
+    return (char*)base + header->data_offset;
+}
+
+// Функция для загрузки массива: бинарный файл отображается в память,
+// при его отсутствии читается текстовый
+int* load_array(const char* bin_filename, const char* txt_filename, int* size, MappedArray* mapped) {
+    mapped->base = NULL;
+    mapped->length = 0;
+
+    int* arr = (int*)map_array_file(bin_filename, ARRAY_FILE_INT32, size, mapped);
+    if (!arr) {
+        arr = read_array_from_file(txt_filename, size);
+    }
+    return arr;
+}
+
+// Функция для освобождения массива, полученного через load_array
+void release_array(int* arr, MappedArray* mapped) {
+    if (mapped->base) {
+        munmap(mapped->base, mapped->length);
+    } else {
+        free(arr);
+    }
+}
+
 // Функция для обмена элементов массива
 void swap(int* a, int* b) {
     int temp = *a;
@@ -50,32 +143,110 @@ void swap(int* a, int* b) {
     *b = temp;
 }
 
-// Функция разделения массива для быстрой сортировки
-int partition(int arr[], int low, int high) {
-    int pivot = arr[high];  // Выбираем последний элемент как опорный
-    int i = (low - 1);     // Индекс меньшего элемента
+// Начиная с этого размера подмассива опорный элемент выбирается как "ninther"
+// (медиана трех медиан из трех), для меньших - как медиана трех
+#define NINTHER_THRESHOLD 40
 
-    for (int j = low; j <= high - 1; j++) {
-        // Если текущий элемент меньше или равен опорному
-        if (arr[j] <= pivot) {
+// Функция для выбора индекса медианы из трех элементов
+int median_of_three(const int arr[], int i, int j, int k) {
+    if (arr[i] < arr[j]) {
+        if (arr[j] < arr[k]) return j;
+        return (arr[i] < arr[k]) ? k : i;
+    }
+    if (arr[i] < arr[k]) return i;
+    return (arr[j] < arr[k]) ? k : j;
+}
+
+// Функция для выбора опорного элемента: медиана трех или ninther по Тьюки.
+// На уже отсортированных и обратно отсортированных данных дает хорошее разбиение
+int choose_pivot(const int arr[], int low, int high) {
+    int mid = low + (high - low) / 2;
+    int n = high - low + 1;
+    if (n < NINTHER_THRESHOLD) {
+        return median_of_three(arr, low, mid, high);
+    }
+    int step = n / 8;
+    int m1 = median_of_three(arr, low, low + step, low + 2 * step);
+    int m2 = median_of_three(arr, mid - step, mid, mid + step);
+    int m3 = median_of_three(arr, high - 2 * step, high - step, high);
+    return median_of_three(arr, m1, m2, m3);
+}
+
+// Функция трехпутевого разделения (задача о голландском флаге).
+// После разделения arr[low..*lt-1] < pivot, arr[*lt..*gt] == pivot, arr[*gt+1..high] > pivot,
+// поэтому элементы, равные опорному, больше не участвуют в рекурсии
+void partition3(int arr[], int low, int high, int* lt, int* gt) {
+    int pivot = arr[choose_pivot(arr, low, high)];
+    int l = low, i = low, g = high;
+    
+    while (i <= g) {
+        if (arr[i] < pivot) {
+            swap(&arr[l++], &arr[i++]);
+        } else if (arr[i] > pivot) {
+            swap(&arr[i], &arr[g--]);
+        } else {
             i++;
-            swap(&arr[i], &arr[j]);
         }
     }
-    swap(&arr[i + 1], &arr[high]);
-    return (i + 1);
+    *lt = l;
+    *gt = g;
 }
 
-// Последовательная быстрая сортировка
+// Последовательная быстрая сортировка с трехпутевым разделением
 void quick_sort_sequential(int arr[], int low, int high) {
-    if (low < high) {
-        // pi - индекс разделения
-        int pi = partition(arr, low, high);
+    while (low < high) {
+        // [lt, gt] - элементы, равные опорному, они уже на своих местах
+        int lt, gt;
+        partition3(arr, low, high, &lt, &gt);
 
-        // Рекурсивно сортируем элементы до и после раздела
-        quick_sort_sequential(arr, low, pi - 1);
-        quick_sort_sequential(arr, pi + 1, high);
+        // Рекурсивно сортируем меньшую часть, а большую - в цикле,
+        // чтобы глубина рекурсии оставалась O(log n)
+        if (lt - low < high - gt) {
+            quick_sort_sequential(arr, low, lt - 1);
+            low = gt + 1;
+        } else {
+            quick_sort_sequential(arr, gt + 1, high);
+            high = lt - 1;
+        }
+    }
+}
+
+// Функция для сортировки подсчетом. Используется, если диапазон значений
+// (max - min + 1) не превышает размер массива: тогда сортировка выполняется за O(n + k).
+// Возвращает 1, если массив отсортирован, и 0, если диапазон для нее слишком велик
+int counting_sort_sequential(int arr[], int size) {
+    if (size < 2) {
+        return 1;
+    }
+    
+    int min_value = arr[0], max_value = arr[0];
+    for (int i = 1; i < size; i++) {
+        if (arr[i] < min_value) min_value = arr[i];
+        if (arr[i] > max_value) max_value = arr[i];
+    }
+    
+    long range = (long)max_value - min_value + 1;
+    if (range > size) {
+        return 0;
+    }
+    
+    int* counts = (int*)calloc(range, sizeof(int));
+    if (!counts) {
+        return 0;
+    }
+    for (int i = 0; i < size; i++) {
+        counts[arr[i] - min_value]++;
     }
+    
+    int pos = 0;
+    for (long v = 0; v < range; v++) {
+        for (int c = 0; c < counts[v]; c++) {
+            arr[pos++] = (int)(min_value + v);
+        }
+    }
+    
+    free(counts);
+    return 1;
 }
 
 // Функция для проверки отсортированности массива
@@ -95,14 +266,15 @@ int main() {
     // Замер времени начала выполнения
     start_time = (double)clock() / CLOCKS_PER_SEC;
     
-    // Чтение массива из файла
-    int* array = read_array_from_file("array.txt", &size);
+    // Загрузка массива (array.bin отображается в память, иначе читается array.txt)
+    MappedArray mapped;
+    int* array = load_array("array.bin", "array.txt", &size, &mapped);
     
     // Создаем копию массива для сортировки
     int* array_to_sort = (int*)malloc(size * sizeof(int));
     if (!array_to_sort) {
         perror("Ошибка выделения памяти");
-        free(array);
+        release_array(array, &mapped);
         return 1;
     }
     
@@ -111,8 +283,11 @@ int main() {
         array_to_sort[i] = array[i];
     }
     
-    // Сортировка
-    quick_sort_sequential(array_to_sort, 0, size - 1);
+    // Сортировка (если диапазон значений мал - подсчетом за O(n + k))
+    int counted = counting_sort_sequential(array_to_sort, size);
+    if (!counted) {
+        quick_sort_sequential(array_to_sort, 0, size - 1);
+    }
     
     // Проверка корректности сортировки
     if (!is_sorted(array_to_sort, size)) {
@@ -125,10 +300,13 @@ int main() {
     // Вывод результатов
     printf("Последовательная быстрая сортировка\n");
     printf("Размер массива: %d элементов\n", size);
+    if (counted) {
+        printf("Использована сортировка подсчетом (малый диапазон значений)\n");
+    }
     printf("Время выполнения: %.6f секунд\n", end_time - start_time);
     
     // Освобождение памяти
-    free(array);
+    release_array(array, &mapped);
     free(array_to_sort);
     
     return 0;
@@ -3,73 +3,735 @@
 #include <time.h>
 #include <math.h>
 #include <omp.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
-// Функция для чтения массива из файла
-int* read_array_from_file(const char* filename, int* size) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
+// Выравнивание массивов результатов в байтах (строка кэша)
+#define RESULT_ALIGNMENT 64
+
+// Функция для проверки, является ли символ разделителем чисел
+static inline int is_separator(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Функция для разбиения текста на диапазоны байтов по числу потоков.
+// Границы сдвигаются вперед до ближайшего разделителя, чтобы не разрезать числа
+void split_text_ranges(const char* text, size_t length, int parts, size_t* bounds) {
+    bounds[0] = 0;
+    for (int i = 1; i < parts; i++) {
+        size_t b = length / parts * i;
+        if (b < bounds[i - 1]) {
+            b = bounds[i - 1];
+        }
+        while (b < length && !is_separator(text[b])) {
+            b++;
+        }
+        bounds[i] = b;
+    }
+    bounds[parts] = length;
+}
+
+// Функция для отображения текстового файла в память только для чтения
+const char* map_text_file(const char* filename, size_t* length) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
         perror("Ошибка при открытии файла");
         exit(EXIT_FAILURE);
     }
 
-    // Подсчет количества чисел в файле
-    int count = 0;
-    int temp;
-    while (fscanf(file, "%d", &temp) == 1) {
-        count++;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror("Ошибка при получении размера файла");
+        close(fd);
+        exit(EXIT_FAILURE);
     }
-    
-    // Возврат к началу файла
-    rewind(file);
-    
-    // Выделение памяти под массив
-    int* arr = (int*)malloc(count * sizeof(int));
-    if (!arr) {
+
+    *length = (size_t)st.st_size;
+    if (*length == 0) {
+        close(fd);
+        return "";
+    }
+
+    void* text = mmap(NULL, *length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (text == MAP_FAILED) {
+        perror("Ошибка отображения файла в память");
+        exit(EXIT_FAILURE);
+    }
+    madvise(text, *length, MADV_SEQUENTIAL);
+    return (const char*)text;
+}
+
+// Функция для освобождения отображения текстового файла
+void unmap_text_file(const char* text, size_t length) {
+    if (length > 0) {
+        munmap((void*)text, length);
+    }
+}
+
+// Функция для разбора целых чисел из диапазона [p, end) в out.
+// Возвращает количество прочитанных чисел или -1 при ошибке формата
+long parse_int_range(const char* p, const char* end, int* out) {
+    long count = 0;
+    while (1) {
+        while (p < end && is_separator(*p)) {
+            p++;
+        }
+        if (p == end) {
+            break;
+        }
+
+        int negative = (*p == '-');
+        if (*p == '-' || *p == '+') {
+            p++;
+        }
+        if (p == end || *p < '0' || *p > '9') {
+            return -1;
+        }
+
+        long long value = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            value = value * 10 + (*p - '0');
+            if (value > (long long)INT_MAX + 1) {
+                return -1;
+            }
+            p++;
+        }
+        if (p < end && !is_separator(*p)) {
+            return -1;
+        }
+
+        value = negative ? -value : value;
+        if (value > INT_MAX) {
+            return -1;
+        }
+        out[count++] = (int)value;
+    }
+    return count;
+}
+
+// Функция для параллельного разбора текста с целыми числами за один проход:
+// каждый поток разбирает свой диапазон во временный буфер, затем куски
+// склеиваются в общий массив по префиксной сумме количеств.
+// Возвращает NULL при ошибке формата
+int* parse_int_text_parallel(const char* text, size_t length, int* size) {
+#ifdef _OPENMP
+    int num_chunks = omp_get_max_threads();
+#else
+    int num_chunks = 1;
+#endif
+    size_t* bounds = (size_t*)malloc((num_chunks + 1) * sizeof(size_t));
+    long* counts = (long*)malloc(num_chunks * sizeof(long));
+    size_t* offsets = (size_t*)malloc(num_chunks * sizeof(size_t));
+    int** chunks = (int**)calloc(num_chunks, sizeof(int*));
+    if (!bounds || !counts || !offsets || !chunks) {
         perror("Ошибка выделения памяти");
-        fclose(file);
         exit(EXIT_FAILURE);
     }
-    
-    // Чтение чисел в массив
-    for (int i = 0; i < count; i++) {
-        if (fscanf(file, "%d", &arr[i]) != 1) {
-            fprintf(stderr, "Ошибка при чтении элемента %d\n", i);
-            free(arr);
-            fclose(file);
+
+    split_text_ranges(text, length, num_chunks, bounds);
+
+    // Разбор диапазонов: в диапазоне из L байт не больше L / 2 + 1 чисел
+    int failed = 0;
+    #pragma omp parallel for num_threads(num_chunks) schedule(static, 1) reduction(|:failed)
+    for (int c = 0; c < num_chunks; c++) {
+        size_t chunk_length = bounds[c + 1] - bounds[c];
+        chunks[c] = (int*)malloc((chunk_length / 2 + 1) * sizeof(int));
+        counts[c] = chunks[c] ? parse_int_range(text + bounds[c], text + bounds[c + 1], chunks[c]) : -1;
+        if (counts[c] < 0) {
+            failed = 1;
+        }
+    }
+
+    // Префиксная сумма количеств дает смещение каждого куска в итоговом массиве
+    size_t total = 0;
+    for (int c = 0; c < num_chunks && !failed; c++) {
+        offsets[c] = total;
+        total += (size_t)counts[c];
+    }
+
+    int* arr = NULL;
+    if (!failed && total <= INT_MAX) {
+        arr = (int*)malloc((total > 0 ? total : 1) * sizeof(int));
+        if (!arr) {
+            perror("Ошибка выделения памяти");
             exit(EXIT_FAILURE);
         }
+
+        // Склейка кусков в общий массив
+        #pragma omp parallel for num_threads(num_chunks) schedule(static, 1)
+        for (int c = 0; c < num_chunks; c++) {
+            memcpy(arr + offsets[c], chunks[c], (size_t)counts[c] * sizeof(int));
+        }
+        *size = (int)total;
+    }
+
+    for (int c = 0; c < num_chunks; c++) {
+        free(chunks[c]);
+    }
+    free(chunks);
+    free(offsets);
+    free(counts);
+    free(bounds);
+    return arr;
+}
+
+// Функция для чтения массива из текстового файла (параллельный разбор за один проход)
+int* read_array_from_file(const char* filename, int* size) {
+    size_t length;
+    const char* text = map_text_file(filename, &length);
+
+    int* arr = parse_int_text_parallel(text, length, size);
+    unmap_text_file(text, length);
+    if (!arr) {
+        fprintf(stderr, "Ошибка при чтении чисел из файла %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    return arr;
+}
+
+// Бинарный формат массива: заголовок ArrayFileHeader, затем сырые данные,
+// начинающиеся со смещения data_offset (кратного alignment)
+#define ARRAY_FILE_MAGIC "PCSARR01"
+#define ARRAY_FILE_INT32 1
+#define ARRAY_FILE_FLOAT64 2
+
+typedef struct {
+    char magic[8];          // Сигнатура ARRAY_FILE_MAGIC
+    uint32_t elem_type;     // Тип элементов (ARRAY_FILE_INT32 / ARRAY_FILE_FLOAT64)
+    uint32_t alignment;     // Выравнивание начала данных в байтах
+    uint64_t count;         // Количество элементов
+    uint64_t data_offset;   // Смещение данных от начала файла
+} ArrayFileHeader;
+
+// Отображение бинарного файла в память
+typedef struct {
+    void* base;             // Начало отображения (NULL, если массив прочитан из текста)
+    size_t length;          // Длина отображения в байтах
+} MappedArray;
+
+// Функция для отображения бинарного массива в память (без разбора и копирования).
+// Возвращает указатель на данные или NULL, если файла нет
+void* map_array_file(const char* filename, uint32_t elem_type, int* size, MappedArray* mapped) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ArrayFileHeader)) {
+        fprintf(stderr, "Ошибка: файл %s не является бинарным массивом\n", filename);
+        exit(EXIT_FAILURE);
+    }
+
+    // Закрытое отображение с правом записи: страницы копируются только при изменении
+    void* base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("Ошибка отображения файла в память");
+        exit(EXIT_FAILURE);
+    }
+
+    // Проверка заголовка
+    const ArrayFileHeader* header = (const ArrayFileHeader*)base;
+    size_t elem_size = (elem_type == ARRAY_FILE_INT32) ? sizeof(int32_t) : sizeof(double);
+    if (memcmp(header->magic, ARRAY_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->elem_type != elem_type ||
+        header->alignment == 0 || header->data_offset % header->alignment != 0 ||
+        header->count > INT_MAX ||
+        header->data_offset + header->count * elem_size > (uint64_t)st.st_size) {
+        fprintf(stderr, "Ошибка: некорректный заголовок бинарного массива %s\n", filename);
+        munmap(base, (size_t)st.st_size);
+        exit(EXIT_FAILURE);
+    }
+
+    // Данные читаются последовательно - подсказываем ядру упреждающее чтение
+    madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    mapped->base = base;
+    mapped->length = (size_t)st.st_size;
+    *size = (int)header->count;
+    return (char*)base + header->data_offset;
+}
+
+// Функция для загрузки массива: бинарный файл отображается в память,
+// при его отсутствии читается текстовый
+int* load_array(const char* bin_filename, const char* txt_filename, int* size, MappedArray* mapped) {
+    mapped->base = NULL;
+    mapped->length = 0;
+
+    int* arr = (int*)map_array_file(bin_filename, ARRAY_FILE_INT32, size, mapped);
+    if (!arr) {
+        arr = read_array_from_file(txt_filename, size);
+    }
+    return arr;
+}
+
+// Функция для освобождения массива, полученного через load_array
+void release_array(int* arr, MappedArray* mapped) {
+    if (mapped->base) {
+        munmap(mapped->base, mapped->length);
+    } else {
+        free(arr);
+    }
+}
+
+// Размер кэша последнего уровня по умолчанию, если система его не сообщает
+#define DEFAULT_LLC_SIZE (8L * 1024 * 1024)
+
+// Режимы записи результатов: обычные записи через кэш или потоковые (non-temporal),
+// минуя кэш и без чтения строк перед записью (read-for-ownership)
+typedef enum {
+    STORE_AUTO,
+    STORE_CACHED,
+    STORE_STREAMING
+} StoreMode;
+
+// Функция для определения размера кэша последнего уровня в байтах
+long last_level_cache_size(void) {
+    long size = -1;
+#ifdef _SC_LEVEL3_CACHE_SIZE
+    size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (size <= 0) {
+        size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    }
+#endif
+    return size > 0 ? size : DEFAULT_LLC_SIZE;
+}
+
+// Функция для выделения выровненного массива результатов (нужно для потоковых записей)
+double* alloc_result_array(int size) {
+    double* arr = NULL;
+    size_t bytes = (size_t)size * sizeof(double);
+    if (posix_memalign((void**)&arr, RESULT_ALIGNMENT, bytes > 0 ? bytes : RESULT_ALIGNMENT) != 0) {
+        return NULL;
     }
-    
-    fclose(file);
-    *size = count;
     return arr;
 }
 
-// Функция для выполнения операций над массивами с использованием OpenMP
+// Функция для вычисления числа элементов до выровненного адреса.
+// Возвращает -1, если выходные массивы смещены относительно выравнивания по-разному
+long streaming_head(const double* result_add, const double* result_sub,
+                    const double* result_mul, const double* result_div,
+                    long count, size_t alignment) {
+    uintptr_t offset = (uintptr_t)result_add & (alignment - 1);
+    if (((uintptr_t)result_sub & (alignment - 1)) != offset ||
+        ((uintptr_t)result_mul & (alignment - 1)) != offset ||
+        ((uintptr_t)result_div & (alignment - 1)) != offset ||
+        offset % sizeof(double) != 0) {
+        return -1;
+    }
+    long head = (long)(((alignment - offset) & (alignment - 1)) / sizeof(double));
+    return head < count ? head : count;
+}
+
+// Ядро поэлементных операций: за один проход по входам вычисляет сумму, разность,
+// произведение и частное; при нулевом делителе в частное записывается zero_div_value.
+// При streaming != 0 результаты пишутся потоковыми записями
+typedef void (*elementwise_kernel_fn)(const int* arr1, const int* arr2,
+                                      double* result_add, double* result_sub,
+                                      double* result_mul, double* result_div,
+                                      long count, double zero_div_value, int streaming);
+
+// Скалярное ядро (используется, если векторные расширения недоступны, и для хвостов);
+// потоковые записи в нем не применяются
+void elementwise_kernel_scalar(const int* arr1, const int* arr2,
+                               double* result_add, double* result_sub,
+                               double* result_mul, double* result_div,
+                               long count, double zero_div_value, int streaming) {
+    (void)streaming;
+    for (long i = 0; i < count; i++) {
+        double a = arr1[i];
+        double b = arr2[i];
+        result_add[i] = a + b;
+        result_sub[i] = a - b;
+        result_mul[i] = a * b;
+        result_div[i] = (b != 0.0) ? a / b : zero_div_value;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// AVX2: по 4 элемента, нулевые делители заменяются через маску сравнения и blend
+__attribute__((target("avx2")))
+void elementwise_kernel_avx2(const int* arr1, const int* arr2,
+                             double* result_add, double* result_sub,
+                             double* result_mul, double* result_div,
+                             long count, double zero_div_value, int streaming) {
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d fill = _mm256_set1_pd(zero_div_value);
+    long i = 0;
+    long head = streaming ? streaming_head(result_add, result_sub, result_mul, result_div,
+                                           count, sizeof(__m256d)) : -1;
+    if (head >= 0) {
+        // Начало диапазона доводится скалярно до выровненного адреса
+        elementwise_kernel_scalar(arr1, arr2, result_add, result_sub, result_mul, result_div,
+                                  head, zero_div_value, 0);
+        for (i = head; i + 4 <= count; i += 4) {
+            __m256d a = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(arr1 + i)));
+            __m256d b = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(arr2 + i)));
+            __m256d is_zero = _mm256_cmp_pd(b, zero, _CMP_EQ_OQ);
+            _mm256_stream_pd(result_add + i, _mm256_add_pd(a, b));
+            _mm256_stream_pd(result_sub + i, _mm256_sub_pd(a, b));
+            _mm256_stream_pd(result_mul + i, _mm256_mul_pd(a, b));
+            _mm256_stream_pd(result_div + i, _mm256_blendv_pd(_mm256_div_pd(a, b), fill, is_zero));
+        }
+        // Потоковые записи должны стать видимыми до выхода из ядра
+        _mm_sfence();
+    } else {
+        for (; i + 4 <= count; i += 4) {
+            __m256d a = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(arr1 + i)));
+            __m256d b = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(arr2 + i)));
+            __m256d is_zero = _mm256_cmp_pd(b, zero, _CMP_EQ_OQ);
+            _mm256_storeu_pd(result_add + i, _mm256_add_pd(a, b));
+            _mm256_storeu_pd(result_sub + i, _mm256_sub_pd(a, b));
+            _mm256_storeu_pd(result_mul + i, _mm256_mul_pd(a, b));
+            _mm256_storeu_pd(result_div + i, _mm256_blendv_pd(_mm256_div_pd(a, b), fill, is_zero));
+        }
+    }
+    elementwise_kernel_scalar(arr1 + i, arr2 + i, result_add + i, result_sub + i,
+                              result_mul + i, result_div + i, count - i, zero_div_value, 0);
+}
+
+// AVX-512: по 8 элементов, деление выполняется только в линиях с ненулевым делителем
+__attribute__((target("avx512f")))
+void elementwise_kernel_avx512(const int* arr1, const int* arr2,
+                               double* result_add, double* result_sub,
+                               double* result_mul, double* result_div,
+                               long count, double zero_div_value, int streaming) {
+    const __m512d zero = _mm512_setzero_pd();
+    const __m512d fill = _mm512_set1_pd(zero_div_value);
+    long i = 0;
+    long head = streaming ? streaming_head(result_add, result_sub, result_mul, result_div,
+                                           count, sizeof(__m512d)) : -1;
+    if (head >= 0) {
+        // Начало диапазона доводится скалярно до границы строки кэша
+        elementwise_kernel_scalar(arr1, arr2, result_add, result_sub, result_mul, result_div,
+                                  head, zero_div_value, 0);
+        for (i = head; i + 8 <= count; i += 8) {
+            __m512d a = _mm512_cvtepi32_pd(_mm256_loadu_si256((const __m256i*)(arr1 + i)));
+            __m512d b = _mm512_cvtepi32_pd(_mm256_loadu_si256((const __m256i*)(arr2 + i)));
+            __mmask8 nonzero = _mm512_cmp_pd_mask(b, zero, _CMP_NEQ_UQ);
+            _mm512_stream_pd(result_add + i, _mm512_add_pd(a, b));
+            _mm512_stream_pd(result_sub + i, _mm512_sub_pd(a, b));
+            _mm512_stream_pd(result_mul + i, _mm512_mul_pd(a, b));
+            _mm512_stream_pd(result_div + i, _mm512_mask_div_pd(fill, nonzero, a, b));
+        }
+        // Потоковые записи должны стать видимыми до выхода из ядра
+        _mm_sfence();
+    } else {
+        for (; i + 8 <= count; i += 8) {
+            __m512d a = _mm512_cvtepi32_pd(_mm256_loadu_si256((const __m256i*)(arr1 + i)));
+            __m512d b = _mm512_cvtepi32_pd(_mm256_loadu_si256((const __m256i*)(arr2 + i)));
+            __mmask8 nonzero = _mm512_cmp_pd_mask(b, zero, _CMP_NEQ_UQ);
+            _mm512_storeu_pd(result_add + i, _mm512_add_pd(a, b));
+            _mm512_storeu_pd(result_sub + i, _mm512_sub_pd(a, b));
+            _mm512_storeu_pd(result_mul + i, _mm512_mul_pd(a, b));
+            _mm512_storeu_pd(result_div + i, _mm512_mask_div_pd(fill, nonzero, a, b));
+        }
+    }
+    elementwise_kernel_scalar(arr1 + i, arr2 + i, result_add + i, result_sub + i,
+                              result_mul + i, result_div + i, count - i, zero_div_value, 0);
+}
+#endif
+
+// Функция для выбора лучшего ядра поэлементных операций по данным CPUID
+elementwise_kernel_fn select_elementwise_kernel(const char** name) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        *name = "AVX-512";
+        return elementwise_kernel_avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        *name = "AVX2";
+        return elementwise_kernel_avx2;
+    }
+#endif
+    *name = "скалярное";
+    return elementwise_kernel_scalar;
+}
+
+// Ядро поэлементных операций, выбранное при запуске
+elementwise_kernel_fn elementwise_kernel = elementwise_kernel_scalar;
+
+// Функция для выполнения операций над массивами с использованием OpenMP.
+// Каждый поток обрабатывает непрерывный диапазон выбранным векторным ядром;
+// при streaming != 0 результаты пишутся в память в обход кэша
 void perform_operations_parallel(const int* arr1, const int* arr2, 
                                double* result_add, double* result_sub, 
                                double* result_mul, double* result_div, 
-                               int size, int num_threads) {
+                               int size, int num_threads, int streaming) {
     // Устанавливаем количество потоков
     omp_set_num_threads(num_threads);
     
-    // Параллельный цикл для выполнения операций
-    #pragma omp parallel for
-    for (int i = 0; i < size; i++) {
-        // Сложение
-        result_add[i] = arr1[i] + arr2[i];
-        
-        // Вычитание
-        result_sub[i] = arr1[i] - arr2[i];
-        
-        // Умножение
-        result_mul[i] = arr1[i] * arr2[i];
+    #pragma omp parallel
+    {
+        int tid = omp_get_thread_num();
+        int nthreads = omp_get_num_threads();
+        long begin = (long)size * tid / nthreads;
+        long end = (long)size * (tid + 1) / nthreads;
+        // Деление на ноль дает NAN (Not a Number)
+        elementwise_kernel(arr1 + begin, arr2 + begin,
+                           result_add + begin, result_sub + begin,
+                           result_mul + begin, result_div + begin,
+                           end - begin, NAN, streaming);
+    }
+}
+
+// Максимальное число запрашиваемых выходов
+#define MAX_OUTPUTS 8
+
+// Ограничения на программу одного выражения: число операций и глубина стека
+#define EXPR_MAX_OPS 64
+#define EXPR_MAX_DEPTH 16
+
+// Размер блока элементов при вычислении выражений (стек блока помещается в кэш L1/L2)
+#define EXPR_BLOCK 256
+
+// Операции программы выражения (обратная польская запись)
+typedef enum {
+    EXPR_LOAD_A,
+    EXPR_LOAD_B,
+    EXPR_CONST,
+    EXPR_ADD,
+    EXPR_SUB,
+    EXPR_MUL,
+    EXPR_DIV,
+    EXPR_NEG
+} ExprOpCode;
+
+typedef struct {
+    ExprOpCode code;
+    double value;
+} ExprOp;
+
+// Скомпилированное выражение над элементами a и b: исходный текст и программа
+typedef struct {
+    const char* text;
+    ExprOp ops[EXPR_MAX_OPS];
+    int count;
+} Expression;
+
+// Состояние разбора выражения
+typedef struct {
+    const char* p;
+    Expression* expr;
+    int depth;
+    int ok;
+} ExprParser;
+
+// Функция для добавления операции в программу с учетом глубины стека
+void expr_emit(ExprParser* parser, ExprOpCode code, double value) {
+    if (parser->expr->count >= EXPR_MAX_OPS) {
+        parser->ok = 0;
+        return;
+    }
+    parser->expr->ops[parser->expr->count].code = code;
+    parser->expr->ops[parser->expr->count].value = value;
+    parser->expr->count++;
+    
+    if (code == EXPR_LOAD_A || code == EXPR_LOAD_B || code == EXPR_CONST) {
+        if (++parser->depth > EXPR_MAX_DEPTH) {
+            parser->ok = 0;
+        }
+    } else if (code != EXPR_NEG) {
+        parser->depth--;
+    }
+}
+
+// Функция для пропуска пробелов в выражении
+void expr_skip_spaces(ExprParser* parser) {
+    while (*parser->p == ' ' || *parser->p == '\t') {
+        parser->p++;
+    }
+}
+
+void parse_expr_sum(ExprParser* parser);
+
+// Функция для разбора множителя: число, a, b, унарный минус или выражение в скобках
+void parse_expr_factor(ExprParser* parser) {
+    expr_skip_spaces(parser);
+    char c = *parser->p;
+    
+    if (c == '-') {
+        parser->p++;
+        parse_expr_factor(parser);
+        expr_emit(parser, EXPR_NEG, 0.0);
+    } else if (c == '(') {
+        parser->p++;
+        parse_expr_sum(parser);
+        expr_skip_spaces(parser);
+        if (*parser->p != ')') {
+            parser->ok = 0;
+            return;
+        }
+        parser->p++;
+    } else if ((c == 'a' || c == 'b') && !isalnum((unsigned char)parser->p[1])) {
+        parser->p++;
+        expr_emit(parser, c == 'a' ? EXPR_LOAD_A : EXPR_LOAD_B, 0.0);
+    } else if (isdigit((unsigned char)c) || c == '.') {
+        char* end;
+        double value = strtod(parser->p, &end);
+        if (end == parser->p) {
+            parser->ok = 0;
+            return;
+        }
+        parser->p = end;
+        expr_emit(parser, EXPR_CONST, value);
+    } else {
+        parser->ok = 0;
+    }
+}
+
+// Функция для разбора произведения множителей (операции * и /)
+void parse_expr_product(ExprParser* parser) {
+    parse_expr_factor(parser);
+    while (parser->ok) {
+        expr_skip_spaces(parser);
+        char op = *parser->p;
+        if (op != '*' && op != '/') {
+            break;
+        }
+        parser->p++;
+        parse_expr_factor(parser);
+        expr_emit(parser, op == '*' ? EXPR_MUL : EXPR_DIV, 0.0);
+    }
+}
+
+// Функция для разбора суммы слагаемых (операции + и -)
+void parse_expr_sum(ExprParser* parser) {
+    parse_expr_product(parser);
+    while (parser->ok) {
+        expr_skip_spaces(parser);
+        char op = *parser->p;
+        if (op != '+' && op != '-') {
+            break;
+        }
+        parser->p++;
+        parse_expr_product(parser);
+        expr_emit(parser, op == '+' ? EXPR_ADD : EXPR_SUB, 0.0);
+    }
+}
+
+// Функция для компиляции выражения в программу. Помимо формул над a и b
+// понимает имена add, sub, mul и div. Возвращает 0 при ошибке в выражении
+int compile_expression(const char* text, Expression* expr) {
+    static const char* aliases[][2] = {
+        {"add", "a + b"}, {"sub", "a - b"}, {"mul", "a * b"}, {"div", "a / b"}
+    };
+    const char* source = text;
+    for (size_t i = 0; i < sizeof(aliases) / sizeof(aliases[0]); i++) {
+        if (strcmp(text, aliases[i][0]) == 0) {
+            source = aliases[i][1];
+        }
+    }
+    
+    expr->text = text;
+    expr->count = 0;
+    ExprParser parser = {source, expr, 0, 1};
+    parse_expr_sum(&parser);
+    expr_skip_spaces(&parser);
+    return parser.ok && *parser.p == '\0' && parser.depth == 1;
+}
+
+// Функция для вычисления выражения над блоком из count <= EXPR_BLOCK элементов.
+// Каждая операция выполняется векторизуемым циклом по всему блоку, промежуточные
+// значения хранятся в стеке блоков, последняя операция пишет сразу в out.
+// При нулевом делителе результатом деления становится zero_div_value
+void eval_expression_block(const Expression* expr, const double* a, const double* b,
+                           double* out, int count, double zero_div_value) {
+    double stack[EXPR_MAX_DEPTH][EXPR_BLOCK];
+    const double* operand[EXPR_MAX_DEPTH];
+    int sp = 0;
+    
+    // Слот стека i хранит указатель на a, b или на блок stack[i]
+    for (int k = 0; k < expr->count; k++) {
+        const ExprOp* op = &expr->ops[k];
+        int last = (k == expr->count - 1);
         
-        // Деление (с проверкой деления на ноль)
-        if (arr2[i] != 0) {
-            result_div[i] = (double)arr1[i] / arr2[i];
+        if (op->code == EXPR_LOAD_A || op->code == EXPR_LOAD_B) {
+            operand[sp++] = (op->code == EXPR_LOAD_A) ? a : b;
+        } else if (op->code == EXPR_CONST) {
+            double* dst = last ? out : stack[sp];
+            for (int j = 0; j < count; j++) {
+                dst[j] = op->value;
+            }
+            operand[sp++] = dst;
+        } else if (op->code == EXPR_NEG) {
+            double* dst = last ? out : stack[sp - 1];
+            const double* x = operand[sp - 1];
+            for (int j = 0; j < count; j++) {
+                dst[j] = -x[j];
+            }
+            operand[sp - 1] = dst;
         } else {
-            result_div[i] = NAN; // Not a Number при делении на ноль
+            double* dst = last ? out : stack[sp - 2];
+            const double* x = operand[sp - 2];
+            const double* y = operand[sp - 1];
+            switch (op->code) {
+                case EXPR_ADD:
+                    for (int j = 0; j < count; j++) {
+                        dst[j] = x[j] + y[j];
+                    }
+                    break;
+                case EXPR_SUB:
+                    for (int j = 0; j < count; j++) {
+                        dst[j] = x[j] - y[j];
+                    }
+                    break;
+                case EXPR_MUL:
+                    for (int j = 0; j < count; j++) {
+                        dst[j] = x[j] * y[j];
+                    }
+                    break;
+                default:
+                    // Частное считается всегда и заменяется выбором без ветвления
+                    for (int j = 0; j < count; j++) {
+                        double quotient = x[j] / y[j];
+                        dst[j] = (y[j] != 0.0) ? quotient : zero_div_value;
+                    }
+                    break;
+            }
+            operand[sp - 2] = dst;
+            sp--;
+        }
+    }
+    
+    // Выражение из одной переменной: результат еще не записан в out
+    if (operand[0] != out) {
+        memcpy(out, operand[0], count * sizeof(double));
+    }
+}
+
+// Функция для вычисления запрошенных выражений с использованием OpenMP.
+// Входные массивы читаются один раз: каждый блок преобразуется в double
+// и по нему сразу вычисляются все выражения
+void evaluate_expressions_parallel(const int* arr1, const int* arr2, int size,
+                                   const Expression* exprs, int num_exprs, double** outputs,
+                                   int num_threads) {
+    int num_blocks = (size + EXPR_BLOCK - 1) / EXPR_BLOCK;
+    
+    #pragma omp parallel for schedule(static) num_threads(num_threads)
+    for (int blk = 0; blk < num_blocks; blk++) {
+        double a[EXPR_BLOCK], b[EXPR_BLOCK];
+        int begin = blk * EXPR_BLOCK;
+        int count = (size - begin < EXPR_BLOCK) ? size - begin : EXPR_BLOCK;
+        for (int j = 0; j < count; j++) {
+            a[j] = arr1[begin + j];
+            b[j] = arr2[begin + j];
+        }
+        for (int k = 0; k < num_exprs; k++) {
+            // Деление на ноль дает NAN, как и в основном ядре
+            eval_expression_block(&exprs[k], a, b, outputs[k] + begin, count, NAN);
         }
     }
 }
@@ -91,8 +753,9 @@ void check_results(const double* result, int size, const char* operation) {
 
 int main(int argc, char* argv[]) {
     // Проверка аргументов командной строки
-    if (argc != 2) {
-        printf("Использование: %s <количество_потоков>\n", argv[0]);
+    if (argc < 2) {
+        printf("Использование: %s <количество_потоков> [auto|stream|cache] [выражение ...]\n", argv[0]);
+        printf("Выражения над элементами a и b: add, sub, mul, div или формулы вида \"a*b + a\"\n");
         return 1;
     }
     
@@ -102,6 +765,35 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
+    // Режим записи результатов: auto (по умолчанию) включает потоковые записи,
+    // если результаты не помещаются в кэш последнего уровня.
+    // Остальные аргументы - запрошенные выражения; без них вычисляются add, sub, mul и div
+    StoreMode store_mode = STORE_AUTO;
+    Expression exprs[MAX_OUTPUTS];
+    int num_exprs = 0;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "stream") == 0) {
+            store_mode = STORE_STREAMING;
+        } else if (strcmp(argv[i], "cache") == 0) {
+            store_mode = STORE_CACHED;
+        } else if (strcmp(argv[i], "auto") == 0) {
+            store_mode = STORE_AUTO;
+        } else if (num_exprs == MAX_OUTPUTS) {
+            printf("Можно запросить не более %d выражений\n", MAX_OUTPUTS);
+            return 1;
+        } else if (!compile_expression(argv[i], &exprs[num_exprs++])) {
+            printf("Некорректное выражение: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    
+    // Количество потоков задается до чтения файла, чтобы разбор шел тем же числом потоков
+    omp_set_num_threads(num_threads);
+    
+    // Выбираем ядро поэлементных операций по возможностям процессора
+    const char* kernel_name;
+    elementwise_kernel = select_elementwise_kernel(&kernel_name);
+    
     double start_time, end_time;
     int size1, size2;
     
@@ -109,41 +801,63 @@ int main(int argc, char* argv[]) {
     start_time = omp_get_wtime();
     
     // Чтение первого массива из файла
-    int* array1 = read_array_from_file("array1.txt", &size1);
+    MappedArray mapped1, mapped2;
+    int* array1 = load_array("array1.bin", "array1.txt", &size1, &mapped1);
     
     // Чтение второго массива из файла
-    int* array2 = read_array_from_file("array2.txt", &size2);
+    int* array2 = load_array("array2.bin", "array2.txt", &size2, &mapped2);
     
     // Проверка, что массивы одного размера
     if (size1 != size2) {
         fprintf(stderr, "Ошибка: массивы имеют разный размер (%d и %d)\n", size1, size2);
-        free(array1);
-        free(array2);
+        release_array(array1, &mapped1);
+        release_array(array2, &mapped2);
         return 1;
     }
     
     int size = size1; // Оба массива одного размера
     
-    // Выделяем память под результаты операций
-    double* result_add = (double*)malloc(size * sizeof(double));
-    double* result_sub = (double*)malloc(size * sizeof(double));
-    double* result_mul = (double*)malloc(size * sizeof(double));
-    double* result_div = (double*)malloc(size * sizeof(double));
+    // Выделяем память только под запрошенные результаты
+    static const char* default_labels[] = {"Сумма", "Разность", "Произведение", "Частное"};
+    int num_outputs = num_exprs > 0 ? num_exprs : 4;
+    double* outputs[MAX_OUTPUTS] = {NULL};
+    int alloc_failed = 0;
+    for (int k = 0; k < num_outputs; k++) {
+        outputs[k] = alloc_result_array(size);
+        alloc_failed |= (outputs[k] == NULL);
+    }
     
-    if (!result_add || !result_sub || !result_mul || !result_div) {
+    if (alloc_failed) {
         perror("Ошибка выделения памяти для результатов");
-        free(array1);
-        free(array2);
-        free(result_add);
-        free(result_sub);
-        free(result_mul);
-        free(result_div);
+        release_array(array1, &mapped1);
+        release_array(array2, &mapped2);
+        for (int k = 0; k < num_outputs; k++) {
+            free(outputs[k]);
+        }
         return 1;
     }
     
-    // Выполнение операций над массивами с использованием OpenMP
-    perform_operations_parallel(array1, array2, result_add, result_sub, 
-                              result_mul, result_div, size, num_threads);
+    // Результаты: если они больше кэша последнего уровня,
+    // их запись через кэш только вытесняет входные данные
+    long llc_size = last_level_cache_size();
+    double output_bytes = (double)num_outputs * size * sizeof(double);
+    int streaming = (store_mode == STORE_STREAMING) ||
+                    (store_mode == STORE_AUTO && output_bytes > llc_size);
+    
+    if (num_exprs > 0) {
+        // Запрошенные выражения вычисляются за один проход по входным массивам
+        // (потоковые записи в этом режиме не используются)
+        streaming = 0;
+        evaluate_expressions_parallel(array1, array2, size, exprs, num_exprs, outputs, num_threads);
+    } else {
+        // Скалярное ядро потоковых записей не делает
+        if (elementwise_kernel == elementwise_kernel_scalar) {
+            streaming = 0;
+        }
+        // Выполнение всех четырех операций над массивами с использованием OpenMP
+        perform_operations_parallel(array1, array2, outputs[0], outputs[1], 
+                                  outputs[2], outputs[3], size, num_threads, streaming);
+    }
     
     // Замер времени окончания выполнения
     end_time = omp_get_wtime();
@@ -153,25 +867,31 @@ int main(int argc, char* argv[]) {
     printf("=== ПАРАЛЛЕЛЬНАЯ ВЕРСИЯ ===\n");
     printf("Количество потоков: %d\n", num_threads);
     printf("Размер массивов: %d элементов\n", size);
+    if (num_exprs > 0) {
+        printf("Выражений: %d (вычисляются за один проход)\n", num_exprs);
+    } else {
+        printf("Ядро операций: %s\n", kernel_name);
+    }
+    printf("Запись результатов: %s (результаты %.1f МБ, кэш последнего уровня %.1f МБ)\n",
+           streaming ? "потоковая (non-temporal)" : "через кэш",
+           output_bytes / (1024.0 * 1024.0), llc_size / (1024.0 * 1024.0));
     printf("Время выполнения: %.6f секунд\n\n", exec_time);
     
     // Проверка результатов (выводим первые 20 элементов)
-    check_results(result_add, size, "Сумма");
-    check_results(result_sub, size, "Разность");
-    check_results(result_mul, size, "Произведение");
-    check_results(result_div, size, "Частное");
+    for (int k = 0; k < num_outputs; k++) {
+        check_results(outputs[k], size, num_exprs > 0 ? exprs[k].text : default_labels[k]);
+    }
     printf("\n");
     
     // Добавляем информацию о скорости работы
     printf("Скорость: %.2f операций/сек\n", size / exec_time);
     
     // Освобождение памяти
-    free(array1);
-    free(array2);
-    free(result_add);
-    free(result_sub);
-    free(result_mul);
-    free(result_div);
+    release_array(array1, &mapped1);
+    release_array(array2, &mapped2);
+    for (int k = 0; k < num_outputs; k++) {
+        free(outputs[k]);
+    }
     
     return 0;
 }
@@ -3,105 +3,809 @@
 #include <time.h>
 #include <math.h>
 #include <omp.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
-// Функция для чтения матрицы из файла
-double** read_matrix_from_file(const char* filename, int* rows, int* cols) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
+// Выравнивание начала матрицы и каждой ее строки в байтах
+#define MATRIX_ALIGNMENT 64
+
+// Ширина плитки по столбцам (в элементах) для параллельных ядер
+#define TILE_COLS 1024
+
+// Размер кэша последнего уровня по умолчанию, если система его не сообщает
+#define DEFAULT_LLC_SIZE (8L * 1024 * 1024)
+
+// Структура для хранения матрицы: один непрерывный выровненный блок,
+// строка i начинается с элемента data[i * stride]
+typedef struct {
+    double* data;
+    int rows;
+    int cols;
+    int stride;     // Шаг между строками в элементах (cols, дополненный до MATRIX_ALIGNMENT)
+} Matrix;
+
+// Функция для создания матрицы
+Matrix create_matrix(int rows, int cols) {
+    Matrix matrix;
+    int per_line = MATRIX_ALIGNMENT / sizeof(double);
+    matrix.rows = rows;
+    matrix.cols = cols;
+    matrix.stride = (cols + per_line - 1) / per_line * per_line;
+    
+    size_t bytes = (size_t)rows * matrix.stride * sizeof(double);
+    if (posix_memalign((void**)&matrix.data, MATRIX_ALIGNMENT, bytes > 0 ? bytes : MATRIX_ALIGNMENT) != 0) {
+        perror("Ошибка выделения памяти для матрицы");
+        exit(EXIT_FAILURE);
+    }
+    return matrix;
+}
+
+// Функция для освобождения памяти, выделенной под матрицу
+void free_matrix(Matrix* matrix) {
+    free(matrix->data);
+    matrix->data = NULL;
+}
+
+// Функция для получения указателя на строку матрицы
+static inline double* matrix_row(Matrix matrix, int i) {
+    return matrix.data + (size_t)i * matrix.stride;
+}
+
+// Функция для проверки, является ли символ разделителем чисел
+static inline int is_separator(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Функция для разбиения текста на диапазоны байтов по числу потоков.
+// Границы сдвигаются вперед до ближайшего разделителя, чтобы не разрезать числа
+void split_text_ranges(const char* text, size_t length, int parts, size_t* bounds) {
+    bounds[0] = 0;
+    for (int i = 1; i < parts; i++) {
+        size_t b = length / parts * i;
+        if (b < bounds[i - 1]) {
+            b = bounds[i - 1];
+        }
+        while (b < length && !is_separator(text[b])) {
+            b++;
+        }
+        bounds[i] = b;
+    }
+    bounds[parts] = length;
+}
+
+// Функция для отображения текстового файла в память только для чтения
+const char* map_text_file(const char* filename, size_t* length) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
         perror("Ошибка при открытии файла");
         exit(EXIT_FAILURE);
     }
 
-    // Читаем размеры матрицы
-    if (fscanf(file, "%d %d", rows, cols) != 2) {
-        fprintf(stderr, "Ошибка при чтении размеров матрицы\n");
-        fclose(file);
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror("Ошибка при получении размера файла");
+        close(fd);
         exit(EXIT_FAILURE);
     }
-    
-    // Выделяем память под матрицу
-    double** matrix = (double**)malloc(*rows * sizeof(double*));
-    if (!matrix) {
-        perror("Ошибка выделения памяти для матрицы");
-        fclose(file);
+
+    *length = (size_t)st.st_size;
+    if (*length == 0) {
+        close(fd);
+        return "";
+    }
+
+    void* text = mmap(NULL, *length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (text == MAP_FAILED) {
+        perror("Ошибка отображения файла в память");
         exit(EXIT_FAILURE);
     }
-    
-    for (int i = 0; i < *rows; i++) {
-        matrix[i] = (double*)malloc(*cols * sizeof(double));
-        if (!matrix[i]) {
-            perror("Ошибка выделения памяти для строки матрицы");
-            // Освобождаем уже выделенную память в случае ошибки
-            for (int j = 0; j < i; j++) {
-                free(matrix[j]);
+    madvise(text, *length, MADV_SEQUENTIAL);
+    return (const char*)text;
+}
+
+// Функция для освобождения отображения текстового файла
+void unmap_text_file(const char* text, size_t length) {
+    if (length > 0) {
+        munmap((void*)text, length);
+    }
+}
+
+// Наибольшая длина числа, разбираемого через strtod без выделения памяти
+#define DOUBLE_TOKEN_BUFFER 128
+
+// Функция для разбора числа [begin, end) через strtod (корректное округление
+// для любых мантисс и порядков)
+double parse_double_slow(const char* begin, const char* end) {
+    size_t length = (size_t)(end - begin);
+    char buffer[DOUBLE_TOKEN_BUFFER];
+    char* token = (length < sizeof(buffer)) ? buffer : (char*)malloc(length + 1);
+    if (!token) {
+        perror("Ошибка выделения памяти");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(token, begin, length);
+    token[length] = '\0';
+    double value = strtod(token, NULL);
+    if (token != buffer) {
+        free(token);
+    }
+    return value;
+}
+
+// Функция для разбора вещественных чисел из диапазона [p, end) в out.
+// Быстрый путь используется только в точном случае Клингера: мантисса не больше 2^53
+// и порядок не больше 22 по модулю, тогда оба множителя представимы точно и результат
+// округляется один раз. Остальные числа разбираются через strtod, поэтому результат
+// совпадает с fscanf бит в бит. Возвращает количество прочитанных чисел или -1 при ошибке формата
+long parse_double_range(const char* p, const char* end, double* out) {
+    static const double powers_of_10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    long count = 0;
+    while (1) {
+        while (p < end && is_separator(*p)) {
+            p++;
+        }
+        if (p == end) {
+            break;
+        }
+
+        const char* token = p;
+        int negative = (*p == '-');
+        if (*p == '-' || *p == '+') {
+            p++;
+        }
+
+        // Мантисса накапливается в целом числе, лишние цифры уходят в порядок;
+        // отброшенная ненулевая цифра означает, что мантисса неточна
+        uint64_t mantissa = 0;
+        int exponent = 0;
+        int digits = 0;
+        int truncated = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (mantissa < 100000000000000000ULL) {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            } else {
+                exponent++;
+                truncated |= (*p != '0');
             }
-            free(matrix);
-            fclose(file);
-            exit(EXIT_FAILURE);
+            digits++;
+            p++;
         }
-        
-        // Читаем элементы строки
-        for (int j = 0; j < *cols; j++) {
-            if (fscanf(file, "%lf", &matrix[i][j]) != 1) {
-                fprintf(stderr, "Ошибка при чтении элемента [%d][%d]\n", i, j);
-                // Освобождаем память в случае ошибки
-                for (int k = 0; k <= i; k++) {
-                    free(matrix[k]);
+        if (p < end && *p == '.') {
+            p++;
+            while (p < end && *p >= '0' && *p <= '9') {
+                if (mantissa < 100000000000000000ULL) {
+                    mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                    exponent--;
+                } else {
+                    truncated |= (*p != '0');
+                }
+                digits++;
+                p++;
+            }
+        }
+        if (digits == 0) {
+            return -1;
+        }
+
+        if (p < end && (*p == 'e' || *p == 'E')) {
+            p++;
+            int exp_negative = (p < end && *p == '-');
+            if (p < end && (*p == '-' || *p == '+')) {
+                p++;
+            }
+            if (p == end || *p < '0' || *p > '9') {
+                return -1;
+            }
+            int exp_value = 0;
+            while (p < end && *p >= '0' && *p <= '9') {
+                if (exp_value < 10000) {
+                    exp_value = exp_value * 10 + (*p - '0');
                 }
-                free(matrix);
-                fclose(file);
-                exit(EXIT_FAILURE);
+                p++;
+            }
+            exponent += exp_negative ? -exp_value : exp_value;
+        }
+        if (p < end && !is_separator(*p)) {
+            return -1;
+        }
+
+        double value;
+        if (mantissa == 0) {
+            value = negative ? -0.0 : 0.0;
+        } else if (!truncated && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+            value = (double)mantissa;
+            value = (exponent >= 0) ? value * powers_of_10[exponent] : value / powers_of_10[-exponent];
+            if (negative) {
+                value = -value;
             }
+        } else {
+            value = parse_double_slow(token, p);
         }
+        out[count++] = value;
+    }
+    return count;
+}
+
+// Функция для параллельного разбора текста с вещественными числами за один проход
+// (устроена так же, как разбор целых: временные буферы потоков + префиксная сумма).
+// Возвращает NULL при ошибке формата
+double* parse_double_text_parallel(const char* text, size_t length, long* size) {
+#ifdef _OPENMP
+    int num_chunks = omp_get_max_threads();
+#else
+    int num_chunks = 1;
+#endif
+    size_t* bounds = (size_t*)malloc((num_chunks + 1) * sizeof(size_t));
+    long* counts = (long*)malloc(num_chunks * sizeof(long));
+    size_t* offsets = (size_t*)malloc(num_chunks * sizeof(size_t));
+    double** chunks = (double**)calloc(num_chunks, sizeof(double*));
+    if (!bounds || !counts || !offsets || !chunks) {
+        perror("Ошибка выделения памяти");
+        exit(EXIT_FAILURE);
+    }
+
+    split_text_ranges(text, length, num_chunks, bounds);
+
+    int failed = 0;
+    #pragma omp parallel for num_threads(num_chunks) schedule(static, 1) reduction(|:failed)
+    for (int c = 0; c < num_chunks; c++) {
+        size_t chunk_length = bounds[c + 1] - bounds[c];
+        chunks[c] = (double*)malloc((chunk_length / 2 + 1) * sizeof(double));
+        counts[c] = chunks[c] ? parse_double_range(text + bounds[c], text + bounds[c + 1], chunks[c]) : -1;
+        if (counts[c] < 0) {
+            failed = 1;
+        }
+    }
+
+    size_t total = 0;
+    for (int c = 0; c < num_chunks && !failed; c++) {
+        offsets[c] = total;
+        total += (size_t)counts[c];
+    }
+
+    double* values = NULL;
+    if (!failed) {
+        values = (double*)malloc((total > 0 ? total : 1) * sizeof(double));
+        if (!values) {
+            perror("Ошибка выделения памяти");
+            exit(EXIT_FAILURE);
+        }
+
+        #pragma omp parallel for num_threads(num_chunks) schedule(static, 1)
+        for (int c = 0; c < num_chunks; c++) {
+            memcpy(values + offsets[c], chunks[c], (size_t)counts[c] * sizeof(double));
+        }
+        *size = (long)total;
+    }
+
+    for (int c = 0; c < num_chunks; c++) {
+        free(chunks[c]);
     }
+    free(chunks);
+    free(offsets);
+    free(counts);
+    free(bounds);
+    return values;
+}
+
+// Функция для чтения размера матрицы (целого неотрицательного числа) из начала текста.
+// Возвращает указатель на символ после числа или NULL при ошибке
+const char* parse_dimension(const char* p, const char* end, int* value) {
+    while (p < end && is_separator(*p)) {
+        p++;
+    }
+    if (p == end || *p < '0' || *p > '9') {
+        return NULL;
+    }
+    long long result = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        result = result * 10 + (*p - '0');
+        if (result > INT_MAX) {
+            return NULL;
+        }
+        p++;
+    }
+    *value = (int)result;
+    return p;
+}
+
+// Функция для чтения элементов матрицы из файла в один непрерывный буфер
+// (размеры читаются из первой строки, элементы разбираются параллельно)
+double* read_matrix_values(const char* filename, int* rows, int* cols) {
+    size_t length;
+    const char* text = map_text_file(filename, &length);
+    const char* end = text + length;
+
+    // Читаем размеры матрицы
+    const char* p = parse_dimension(text, end, rows);
+    if (p) {
+        p = parse_dimension(p, end, cols);
+    }
+    if (!p) {
+        fprintf(stderr, "Ошибка при чтении размеров матрицы\n");
+        unmap_text_file(text, length);
+        exit(EXIT_FAILURE);
+    }
+
+    // Разбираем элементы матрицы
+    long count = 0;
+    double* values = parse_double_text_parallel(p, (size_t)(end - p), &count);
+    unmap_text_file(text, length);
+    if (!values || count != (long)*rows * *cols) {
+        fprintf(stderr, "Ошибка при чтении элементов матрицы из файла %s\n", filename);
+        free(values);
+        exit(EXIT_FAILURE);
+    }
+    return values;
+}
+
+// Функция для чтения матрицы из файла
+Matrix read_matrix_from_file(const char* filename) {
+    int rows, cols;
+    double* values = read_matrix_values(filename, &rows, &cols);
     
-    fclose(file);
+    // Копируем разобранные элементы теми же плитками "строка x TILE_COLS столбцов"
+    // и с тем же распределением collapse(2), что и в perform_matrix_operations_parallel:
+    // каждую плитку заполняет поток, который потом будет ее обрабатывать (первое касание страниц)
+    Matrix matrix = create_matrix(rows, cols);
+    int col_tiles = (cols + TILE_COLS - 1) / TILE_COLS;
+    #pragma omp parallel for collapse(2) schedule(static)
+    for (int i = 0; i < rows; i++) {
+        for (int t = 0; t < col_tiles; t++) {
+            int j_begin = t * TILE_COLS;
+            int j_end = (j_begin + TILE_COLS < cols) ? j_begin + TILE_COLS : cols;
+            memcpy(matrix_row(matrix, i) + j_begin, values + (size_t)i * cols + j_begin,
+                   (size_t)(j_end - j_begin) * sizeof(double));
+        }
+    }
+    
+    free(values);
     return matrix;
 }
 
-// Функция для освобождения памяти, выделенной под матрицу
-void free_matrix(double** matrix, int rows) {
-    if (matrix) {
+// Режимы записи результатов: обычные записи через кэш или потоковые (non-temporal),
+// минуя кэш и без чтения строк перед записью (read-for-ownership)
+typedef enum {
+    STORE_AUTO,
+    STORE_CACHED,
+    STORE_STREAMING
+} StoreMode;
+
+// Функция для определения размера кэша последнего уровня в байтах
+long last_level_cache_size(void) {
+    long size = -1;
+#ifdef _SC_LEVEL3_CACHE_SIZE
+    size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (size <= 0) {
+        size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    }
+#endif
+    return size > 0 ? size : DEFAULT_LLC_SIZE;
+}
+
+// Ядро для отрезка строки с потоковой записью результатов.
+// Начало отрезка должно быть выровнено по MATRIX_ALIGNMENT
+typedef void (*stream_tile_fn)(const double* a, const double* b,
+                               double* add, double* sub, double* mul, double* div,
+                               int count);
+
+#if defined(__x86_64__) || defined(__i386__)
+// AVX2: по 4 элемента, частное при нулевом делителе заменяется на NaN через blend
+__attribute__((target("avx2")))
+void stream_tile_avx2(const double* a, const double* b,
+                      double* add, double* sub, double* mul, double* div,
+                      int count) {
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d nan = _mm256_set1_pd(NAN);
+    int j = 0;
+    for (; j + 4 <= count; j += 4) {
+        __m256d va = _mm256_load_pd(a + j);
+        __m256d vb = _mm256_load_pd(b + j);
+        __m256d is_zero = _mm256_cmp_pd(vb, zero, _CMP_EQ_OQ);
+        _mm256_stream_pd(add + j, _mm256_add_pd(va, vb));
+        _mm256_stream_pd(sub + j, _mm256_sub_pd(va, vb));
+        _mm256_stream_pd(mul + j, _mm256_mul_pd(va, vb));
+        _mm256_stream_pd(div + j, _mm256_blendv_pd(_mm256_div_pd(va, vb), nan, is_zero));
+    }
+    for (; j < count; j++) {
+        add[j] = a[j] + b[j];
+        sub[j] = a[j] - b[j];
+        mul[j] = a[j] * b[j];
+        div[j] = (b[j] != 0.0) ? a[j] / b[j] : NAN;
+    }
+}
+
+// AVX-512: по 8 элементов (целая строка кэша), деление только в линиях с ненулевым делителем
+__attribute__((target("avx512f")))
+void stream_tile_avx512(const double* a, const double* b,
+                        double* add, double* sub, double* mul, double* div,
+                        int count) {
+    const __m512d zero = _mm512_setzero_pd();
+    const __m512d nan = _mm512_set1_pd(NAN);
+    int j = 0;
+    for (; j + 8 <= count; j += 8) {
+        __m512d va = _mm512_load_pd(a + j);
+        __m512d vb = _mm512_load_pd(b + j);
+        __mmask8 nonzero = _mm512_cmp_pd_mask(vb, zero, _CMP_NEQ_UQ);
+        _mm512_stream_pd(add + j, _mm512_add_pd(va, vb));
+        _mm512_stream_pd(sub + j, _mm512_sub_pd(va, vb));
+        _mm512_stream_pd(mul + j, _mm512_mul_pd(va, vb));
+        _mm512_stream_pd(div + j, _mm512_mask_div_pd(nan, nonzero, va, vb));
+    }
+    for (; j < count; j++) {
+        add[j] = a[j] + b[j];
+        sub[j] = a[j] - b[j];
+        mul[j] = a[j] * b[j];
+        div[j] = (b[j] != 0.0) ? a[j] / b[j] : NAN;
+    }
+}
+#endif
+
+// Функция для выбора ядра потоковой записи по данным CPUID.
+// Возвращает NULL, если потоковые записи на этом процессоре недоступны
+stream_tile_fn select_stream_tile(const char** name) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        *name = "AVX-512";
+        return stream_tile_avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        *name = "AVX2";
+        return stream_tile_avx2;
+    }
+#endif
+    *name = "недоступно";
+    return NULL;
+}
+
+// Функция для выполнения операций над матрицами с использованием OpenMP.
+// Матрицы обходятся плитками "строка x TILE_COLS столбцов": collapse распределяет
+// плитки между потоками даже при малом числе строк, а внутренний цикл по
+// выровненному непрерывному отрезку строки векторизуется.
+// Если задано stream_tile, результаты пишутся потоковыми записями в обход кэша
+void perform_matrix_operations_parallel(Matrix matrix1, Matrix matrix2, 
+                                      Matrix* result_add, Matrix* result_sub,
+                                      Matrix* result_mul, Matrix* result_div,
+                                      int num_threads, stream_tile_fn stream_tile) {
+    int rows = matrix1.rows;
+    int cols = matrix1.cols;
+    int col_tiles = (cols + TILE_COLS - 1) / TILE_COLS;
+    
+    #pragma omp parallel num_threads(num_threads)
+    {
+        #pragma omp for collapse(2) schedule(static) nowait
         for (int i = 0; i < rows; i++) {
-            free(matrix[i]);
+            for (int t = 0; t < col_tiles; t++) {
+                int j_begin = t * TILE_COLS;
+                int j_end = (j_begin + TILE_COLS < cols) ? j_begin + TILE_COLS : cols;
+                const double* restrict a = matrix_row(matrix1, i);
+                const double* restrict b = matrix_row(matrix2, i);
+                double* restrict add = matrix_row(*result_add, i);
+                double* restrict sub = matrix_row(*result_sub, i);
+                double* restrict mul = matrix_row(*result_mul, i);
+                double* restrict div = matrix_row(*result_div, i);
+                
+                if (stream_tile) {
+                    // Потоковая запись в обход кэша (плитка начинается с выровненного адреса)
+                    stream_tile(a + j_begin, b + j_begin, add + j_begin, sub + j_begin,
+                                mul + j_begin, div + j_begin, j_end - j_begin);
+                    continue;
+                }
+                
+                #pragma omp simd aligned(a, b, add, sub, mul, div : MATRIX_ALIGNMENT)
+                for (int j = j_begin; j < j_end; j++) {
+                    add[j] = a[j] + b[j];
+                    sub[j] = a[j] - b[j];
+                    mul[j] = a[j] * b[j];
+                    // Деление (с проверкой деления на ноль): частное считается всегда,
+                    // а при нулевом делителе заменяется на NaN выбором без ветвления
+                    double quotient = a[j] / b[j];
+                    div[j] = (b[j] != 0.0) ? quotient : NAN;
+                }
+            }
         }
-        free(matrix);
+        
+#if defined(__x86_64__) || defined(__i386__)
+        // Потоковые записи каждого потока должны стать видимыми до завершения параллельной области
+        if (stream_tile) {
+            _mm_sfence();
+        }
+#endif
     }
 }
 
-// Функция для выполнения операций над матрицами с использованием OpenMP
-void perform_matrix_operations_parallel(double** matrix1, double** matrix2, 
-                                      double** result_add, double** result_sub,
-                                      double** result_mul, double** result_div,
-                                      int rows, int cols, int num_threads) {
-    // Устанавливаем количество потоков
-    omp_set_num_threads(num_threads);
+// Максимальное число запрашиваемых выходов
+#define MAX_OUTPUTS 8
+
+// Ограничения на программу одного выражения: число операций и глубина стека
+#define EXPR_MAX_OPS 64
+#define EXPR_MAX_DEPTH 16
+
+// Размер блока элементов при вычислении выражений (стек блока помещается в кэш L1/L2)
+#define EXPR_BLOCK 256
+
+// Операции программы выражения (обратная польская запись)
+typedef enum {
+    EXPR_LOAD_A,
+    EXPR_LOAD_B,
+    EXPR_CONST,
+    EXPR_ADD,
+    EXPR_SUB,
+    EXPR_MUL,
+    EXPR_DIV,
+    EXPR_NEG
+} ExprOpCode;
+
+typedef struct {
+    ExprOpCode code;
+    double value;
+} ExprOp;
+
+// Скомпилированное выражение над элементами a и b: исходный текст и программа
+typedef struct {
+    const char* text;
+    ExprOp ops[EXPR_MAX_OPS];
+    int count;
+} Expression;
+
+// Состояние разбора выражения
+typedef struct {
+    const char* p;
+    Expression* expr;
+    int depth;
+    int ok;
+} ExprParser;
+
+// Функция для добавления операции в программу с учетом глубины стека
+void expr_emit(ExprParser* parser, ExprOpCode code, double value) {
+    if (parser->expr->count >= EXPR_MAX_OPS) {
+        parser->ok = 0;
+        return;
+    }
+    parser->expr->ops[parser->expr->count].code = code;
+    parser->expr->ops[parser->expr->count].value = value;
+    parser->expr->count++;
+    
+    if (code == EXPR_LOAD_A || code == EXPR_LOAD_B || code == EXPR_CONST) {
+        if (++parser->depth > EXPR_MAX_DEPTH) {
+            parser->ok = 0;
+        }
+    } else if (code != EXPR_NEG) {
+        parser->depth--;
+    }
+}
+
+// Функция для пропуска пробелов в выражении
+void expr_skip_spaces(ExprParser* parser) {
+    while (*parser->p == ' ' || *parser->p == '\t') {
+        parser->p++;
+    }
+}
+
+void parse_expr_sum(ExprParser* parser);
+
+// Функция для разбора множителя: число, a, b, унарный минус или выражение в скобках
+void parse_expr_factor(ExprParser* parser) {
+    expr_skip_spaces(parser);
+    char c = *parser->p;
+    
+    if (c == '-') {
+        parser->p++;
+        parse_expr_factor(parser);
+        expr_emit(parser, EXPR_NEG, 0.0);
+    } else if (c == '(') {
+        parser->p++;
+        parse_expr_sum(parser);
+        expr_skip_spaces(parser);
+        if (*parser->p != ')') {
+            parser->ok = 0;
+            return;
+        }
+        parser->p++;
+    } else if ((c == 'a' || c == 'b') && !isalnum((unsigned char)parser->p[1])) {
+        parser->p++;
+        expr_emit(parser, c == 'a' ? EXPR_LOAD_A : EXPR_LOAD_B, 0.0);
+    } else if (isdigit((unsigned char)c) || c == '.') {
+        char* end;
+        double value = strtod(parser->p, &end);
+        if (end == parser->p) {
+            parser->ok = 0;
+            return;
+        }
+        parser->p = end;
+        expr_emit(parser, EXPR_CONST, value);
+    } else {
+        parser->ok = 0;
+    }
+}
+
+// Функция для разбора произведения множителей (операции * и /)
+void parse_expr_product(ExprParser* parser) {
+    parse_expr_factor(parser);
+    while (parser->ok) {
+        expr_skip_spaces(parser);
+        char op = *parser->p;
+        if (op != '*' && op != '/') {
+            break;
+        }
+        parser->p++;
+        parse_expr_factor(parser);
+        expr_emit(parser, op == '*' ? EXPR_MUL : EXPR_DIV, 0.0);
+    }
+}
+
+// Функция для разбора суммы слагаемых (операции + и -)
+void parse_expr_sum(ExprParser* parser) {
+    parse_expr_product(parser);
+    while (parser->ok) {
+        expr_skip_spaces(parser);
+        char op = *parser->p;
+        if (op != '+' && op != '-') {
+            break;
+        }
+        parser->p++;
+        parse_expr_product(parser);
+        expr_emit(parser, op == '+' ? EXPR_ADD : EXPR_SUB, 0.0);
+    }
+}
+
+// Функция для компиляции выражения в программу. Помимо формул над a и b
+// понимает имена add, sub, mul и div. Возвращает 0 при ошибке в выражении
+int compile_expression(const char* text, Expression* expr) {
+    static const char* aliases[][2] = {
+        {"add", "a + b"}, {"sub", "a - b"}, {"mul", "a * b"}, {"div", "a / b"}
+    };
+    const char* source = text;
+    for (size_t i = 0; i < sizeof(aliases) / sizeof(aliases[0]); i++) {
+        if (strcmp(text, aliases[i][0]) == 0) {
+            source = aliases[i][1];
+        }
+    }
     
-    // Параллельный цикл по строкам матрицы
-    #pragma omp parallel for
+    expr->text = text;
+    expr->count = 0;
+    ExprParser parser = {source, expr, 0, 1};
+    parse_expr_sum(&parser);
+    expr_skip_spaces(&parser);
+    return parser.ok && *parser.p == '\0' && parser.depth == 1;
+}
+
+// Функция для вычисления выражения над блоком из count <= EXPR_BLOCK элементов.
+// Каждая операция выполняется векторизуемым циклом по всему блоку, промежуточные
+// значения хранятся в стеке блоков, последняя операция пишет сразу в out.
+// При нулевом делителе результатом деления становится zero_div_value
+void eval_expression_block(const Expression* expr, const double* a, const double* b,
+                           double* out, int count, double zero_div_value) {
+    double stack[EXPR_MAX_DEPTH][EXPR_BLOCK];
+    const double* operand[EXPR_MAX_DEPTH];
+    int sp = 0;
+    
+    // Слот стека i хранит указатель на a, b или на блок stack[i]
+    for (int k = 0; k < expr->count; k++) {
+        const ExprOp* op = &expr->ops[k];
+        int last = (k == expr->count - 1);
+        
+        if (op->code == EXPR_LOAD_A || op->code == EXPR_LOAD_B) {
+            operand[sp++] = (op->code == EXPR_LOAD_A) ? a : b;
+        } else if (op->code == EXPR_CONST) {
+            double* dst = last ? out : stack[sp];
+            for (int j = 0; j < count; j++) {
+                dst[j] = op->value;
+            }
+            operand[sp++] = dst;
+        } else if (op->code == EXPR_NEG) {
+            double* dst = last ? out : stack[sp - 1];
+            const double* x = operand[sp - 1];
+            for (int j = 0; j < count; j++) {
+                dst[j] = -x[j];
+            }
+            operand[sp - 1] = dst;
+        } else {
+            double* dst = last ? out : stack[sp - 2];
+            const double* x = operand[sp - 2];
+            const double* y = operand[sp - 1];
+            switch (op->code) {
+                case EXPR_ADD:
+                    for (int j = 0; j < count; j++) {
+                        dst[j] = x[j] + y[j];
+                    }
+                    break;
+                case EXPR_SUB:
+                    for (int j = 0; j < count; j++) {
+                        dst[j] = x[j] - y[j];
+                    }
+                    break;
+                case EXPR_MUL:
+                    for (int j = 0; j < count; j++) {
+                        dst[j] = x[j] * y[j];
+                    }
+                    break;
+                default:
+                    // Частное считается всегда и заменяется выбором без ветвления
+                    for (int j = 0; j < count; j++) {
+                        double quotient = x[j] / y[j];
+                        dst[j] = (y[j] != 0.0) ? quotient : zero_div_value;
+                    }
+                    break;
+            }
+            operand[sp - 2] = dst;
+            sp--;
+        }
+    }
+    
+    // Выражение из одной переменной: результат еще не записан в out
+    if (operand[0] != out) {
+        memcpy(out, operand[0], count * sizeof(double));
+    }
+}
+
+// Функция для вычисления запрошенных выражений над матрицами с использованием OpenMP.
+// Строки обходятся блоками по EXPR_BLOCK столбцов, по каждому блоку входов
+// сразу вычисляются все выражения
+void evaluate_expressions_parallel(Matrix matrix1, Matrix matrix2,
+                                   const Expression* exprs, int num_exprs, Matrix* outputs,
+                                   int num_threads) {
+    int rows = matrix1.rows;
+    int cols = matrix1.cols;
+    int col_blocks = (cols + EXPR_BLOCK - 1) / EXPR_BLOCK;
+    
+    #pragma omp parallel for collapse(2) schedule(static) num_threads(num_threads)
     for (int i = 0; i < rows; i++) {
-        for (int j = 0; j < cols; j++) {
-            // Сложение
-            result_add[i][j] = matrix1[i][j] + matrix2[i][j];
-            
-            // Вычитание
-            result_sub[i][j] = matrix1[i][j] - matrix2[i][j];
-            
-            // Умножение
-            result_mul[i][j] = matrix1[i][j] * matrix2[i][j];
-            
-            // Деление (с проверкой деления на ноль)
-            if (matrix2[i][j] != 0.0) {
-                result_div[i][j] = matrix1[i][j] / matrix2[i][j];
-            } else {
-                result_div[i][j] = NAN; // Not a Number при делении на ноль
+        for (int t = 0; t < col_blocks; t++) {
+            int j_begin = t * EXPR_BLOCK;
+            int count = (cols - j_begin < EXPR_BLOCK) ? cols - j_begin : EXPR_BLOCK;
+            const double* a = matrix_row(matrix1, i) + j_begin;
+            const double* b = matrix_row(matrix2, i) + j_begin;
+            for (int k = 0; k < num_exprs; k++) {
+                // Деление на ноль дает NaN, как и в основном ядре
+                eval_expression_block(&exprs[k], a, b, matrix_row(outputs[k], i) + j_begin,
+                                      count, NAN);
             }
         }
     }
 }
 
+// Функция для вывода первых результатов запрошенных выражений
+void print_expression_results(const Matrix* outputs, const Expression* exprs, int num_exprs, int count) {
+    printf("Первые %d результатов выражений:\n", count);
+    printf("Индекс");
+    for (int k = 0; k < num_exprs; k++) {
+        printf(" | %12s", exprs[k].text);
+    }
+    printf("\n");
+    
+    int total = outputs[0].rows * outputs[0].cols;
+    for (int idx = 0; idx < count && idx < total; idx++) {
+        int i = idx / outputs[0].cols;
+        int j = idx % outputs[0].cols;
+        printf("%6d", idx + 1);
+        for (int k = 0; k < num_exprs; k++) {
+            printf(" | %12.2f", matrix_row(outputs[k], i)[j]);
+        }
+        printf("\n");
+    }
+    printf("\nВсего обработано элементов: %d\n\n", total);
+}
+
 // Функция для выполнения операций над матрицами и вывода первых 5 результатов
-void perform_operations_and_print(double** matrix1, double** matrix2, int rows, int cols, int num_threads) {
+void perform_operations_and_print(Matrix matrix1, Matrix matrix2, int num_threads) {
+    int rows = matrix1.rows;
+    int cols = matrix1.cols;
+    
     printf("Первые 5 результатов операций:\n");
     printf("Индекс |   Сложение  |  Вычитание  | Умножение  |  Деление   \n");
     printf("-------+-------------+-------------+------------+-------------\n");
@@ -110,13 +814,11 @@ void perform_operations_and_print(double** matrix1, double** matrix2, int rows,
     int printed = 0;
     
     // Используем директиву OpenMP для параллельного выполнения
-    #pragma omp parallel for private(i, j) num_threads(num_threads) schedule(static, chunk_size)
+    #pragma omp parallel for num_threads(num_threads) schedule(static)
     for (int i = 0; i < rows; i++) {
         for (int j = 0; j < cols; j++) {
-            int idx = i * cols + j;
-            
-            double a = matrix1[i][j];
-            double b = matrix2[i][j];
+            double a = matrix_row(matrix1, i)[j];
+            double b = matrix_row(matrix2, i)[j];
             
             // Выполняем операции
             double add = a + b;
@@ -148,8 +850,9 @@ void perform_operations_and_print(double** matrix1, double** matrix2, int rows,
 
 int main(int argc, char* argv[]) {
     // Проверка аргументов командной строки
-    if (argc != 2) {
-        printf("Использование: %s <количество_потоков>\n", argv[0]);
+    if (argc < 2) {
+        printf("Использование: %s <количество_потоков> [auto|stream|cache] [выражение ...]\n", argv[0]);
+        printf("Выражения над элементами a и b: add, sub, mul, div или формулы вида \"a*b + a\"\n");
         return 1;
     }
     
@@ -159,75 +862,81 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
+    // Режим записи результатов: auto (по умолчанию) включает потоковые записи,
+    // если результаты не помещаются в кэш последнего уровня.
+    // Остальные аргументы - запрошенные выражения; без них вычисляются add, sub, mul и div
+    StoreMode store_mode = STORE_AUTO;
+    Expression exprs[MAX_OUTPUTS];
+    int num_exprs = 0;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "stream") == 0) {
+            store_mode = STORE_STREAMING;
+        } else if (strcmp(argv[i], "cache") == 0) {
+            store_mode = STORE_CACHED;
+        } else if (strcmp(argv[i], "auto") == 0) {
+            store_mode = STORE_AUTO;
+        } else if (num_exprs == MAX_OUTPUTS) {
+            printf("Можно запросить не более %d выражений\n", MAX_OUTPUTS);
+            return 1;
+        } else if (!compile_expression(argv[i], &exprs[num_exprs++])) {
+            printf("Некорректное выражение: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    
+    // Количество потоков задается до чтения файла, чтобы разбор шел тем же числом потоков
+    omp_set_num_threads(num_threads);
+    
     double start_time, end_time;
-    int rows1, cols1, rows2, cols2;
     
     // Замер времени начала выполнения
     start_time = omp_get_wtime();
     
     // Чтение первой матрицы из файла
-    double** matrix1 = read_matrix_from_file("matrix1.txt", &rows1, &cols1);
+    Matrix matrix1 = read_matrix_from_file("matrix1.txt");
     
     // Чтение второй матрицы из файла
-    double** matrix2 = read_matrix_from_file("matrix2.txt", &rows2, &cols2);
+    Matrix matrix2 = read_matrix_from_file("matrix2.txt");
     
     // Проверка, что матрицы одного размера
-    if (rows1 != rows2 || cols1 != cols2) {
+    if (matrix1.rows != matrix2.rows || matrix1.cols != matrix2.cols) {
         fprintf(stderr, "Ошибка: матрицы имеют разные размеры (%dx%d и %dx%d)\n", 
-                rows1, cols1, rows2, cols2);
-        free_matrix(matrix1, rows1);
-        free_matrix(matrix2, rows2);
+                matrix1.rows, matrix1.cols, matrix2.rows, matrix2.cols);
+        free_matrix(&matrix1);
+        free_matrix(&matrix2);
         return 1;
     }
     
-    int rows = rows1;
-    int cols = cols1;
-    
-    // Выделяем память под результаты операций
-    double** result_add = (double**)malloc(rows * sizeof(double*));
-    double** result_sub = (double**)malloc(rows * sizeof(double*));
-    double** result_mul = (double**)malloc(rows * sizeof(double*));
-    double** result_div = (double**)malloc(rows * sizeof(double*));
+    int rows = matrix1.rows;
+    int cols = matrix1.cols;
     
-    if (!result_add || !result_sub || !result_mul || !result_div) {
-        perror("Ошибка выделения памяти для результатов");
-        free_matrix(matrix1, rows);
-        free_matrix(matrix2, rows);
-        if (result_add) free(result_add);
-        if (result_sub) free(result_sub);
-        if (result_mul) free(result_mul);
-        if (result_div) free(result_div);
-        return 1;
+    // Выделяем память только под запрошенные результаты (страницы заполняются потоками в ядре)
+    int num_outputs = num_exprs > 0 ? num_exprs : 4;
+    Matrix outputs[MAX_OUTPUTS];
+    for (int k = 0; k < num_outputs; k++) {
+        outputs[k] = create_matrix(rows, cols);
     }
     
-    for (int i = 0; i < rows; i++) {
-        result_add[i] = (double*)malloc(cols * sizeof(double));
-        result_sub[i] = (double*)malloc(cols * sizeof(double));
-        result_mul[i] = (double*)malloc(cols * sizeof(double));
-        result_div[i] = (double*)malloc(cols * sizeof(double));
-        
-        if (!result_add[i] || !result_sub[i] || !result_mul[i] || !result_div[i]) {
-            perror("Ошибка выделения памяти для строк результатов");
-            // Освобождаем уже выделенную память
-            for (int j = 0; j <= i; j++) {
-                if (result_add[j]) free(result_add[j]);
-                if (result_sub[j]) free(result_sub[j]);
-                if (result_mul[j]) free(result_mul[j]);
-                if (result_div[j]) free(result_div[j]);
-            }
-            free(result_add);
-            free(result_sub);
-            free(result_mul);
-            free(result_div);
-            free_matrix(matrix1, rows);
-            free_matrix(matrix2, rows);
-            return 1;
-        }
+    // Результаты: если они больше кэша последнего уровня,
+    // их запись через кэш только вытесняет входные данные
+    long llc_size = last_level_cache_size();
+    double output_bytes = (double)num_outputs * rows * outputs[0].stride * sizeof(double);
+    const char* stream_name;
+    stream_tile_fn stream_tile = select_stream_tile(&stream_name);
+    if (num_exprs > 0 || store_mode == STORE_CACHED ||
+        (store_mode == STORE_AUTO && output_bytes <= llc_size)) {
+        // В режиме выражений потоковые записи не используются
+        stream_tile = NULL;
     }
     
-    // Выполнение операций над матрицами с использованием OpenMP
-    perform_matrix_operations_parallel(matrix1, matrix2, result_add, result_sub, 
-                                     result_mul, result_div, rows, cols, num_threads);
+    if (num_exprs > 0) {
+        // Запрошенные выражения вычисляются за один проход по входным матрицам
+        evaluate_expressions_parallel(matrix1, matrix2, exprs, num_exprs, outputs, num_threads);
+    } else {
+        // Выполнение всех четырех операций над матрицами с использованием OpenMP
+        perform_matrix_operations_parallel(matrix1, matrix2, &outputs[0], &outputs[1], 
+                                         &outputs[2], &outputs[3], num_threads, stream_tile);
+    }
     
     // Замер времени окончания выполнения
     end_time = omp_get_wtime();
@@ -235,23 +944,36 @@ int main(int argc, char* argv[]) {
     // Вывод результатов
     printf("=== ПАРАЛЛЕЛЬНАЯ ВЕРСИЯ (%d потоков) ===\n", num_threads);
     printf("Размер матриц: %dx%d (всего %d элементов)\n", rows, cols, rows * cols);
+    if (num_exprs > 0) {
+        printf("Выражений: %d (вычисляются за один проход)\n", num_exprs);
+    }
+    if (stream_tile) {
+        printf("Запись результатов: потоковая (non-temporal, %s)", stream_name);
+    } else {
+        printf("Запись результатов: через кэш");
+    }
+    printf(" (результаты %.1f МБ, кэш последнего уровня %.1f МБ)\n",
+           output_bytes / (1024.0 * 1024.0), llc_size / (1024.0 * 1024.0));
     printf("Время выполнения: %.6f секунд\n", end_time - start_time);
     
-    // Выполняем операции и выводим результаты
-    perform_operations_and_print(matrix1, matrix2, rows, cols, num_threads);
+    // Выводим первые результаты
+    if (num_exprs > 0) {
+        print_expression_results(outputs, exprs, num_exprs, 5);
+    } else {
+        perform_operations_and_print(matrix1, matrix2, num_threads);
+    }
     
     // Вычисляем и выводим скорость обработки
-    double total_elements = (double)(rows * cols);
+    double total_elements = (double)rows * cols;
     double exec_time = end_time - start_time;
     printf("\nСкорость: %.2f операций/сек\n", total_elements / exec_time);
     
     // Освобождение памяти
-    free_matrix(matrix1, rows);
-    free_matrix(matrix2, rows);
-    free_matrix(result_add, rows);
-    free_matrix(result_sub, rows);
-    free_matrix(result_mul, rows);
-    free_matrix(result_div, rows);
+    free_matrix(&matrix1);
+    free_matrix(&matrix2);
+    for (int k = 0; k < num_outputs; k++) {
+        free_matrix(&outputs[k]);
+    }
     
     return 0;
 }
@@ -1,127 +1,1313 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <mpi.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
-// Функция для чтения массива из файла (только корневым процессом)
-int* read_array_from_file(const char* filename, int* size, int rank) {
-    FILE* file = NULL;
-    int* arr = NULL;
-    
-    if (rank == 0) {  // Только корневой процесс читает файл
-        file = fopen(filename, "r");
-        if (!file) {
-            perror("Ошибка при открытии файла");
-            MPI_Abort(MPI_COMM_WORLD, 1);
+// Функция для проверки, является ли символ разделителем чисел
+static inline int is_separator(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Функция для разбиения текста на диапазоны байтов по числу потоков.
+// Границы сдвигаются вперед до ближайшего разделителя, чтобы не разрезать числа
+void split_text_ranges(const char* text, size_t length, int parts, size_t* bounds) {
+    bounds[0] = 0;
+    for (int i = 1; i < parts; i++) {
+        size_t b = length / parts * i;
+        if (b < bounds[i - 1]) {
+            b = bounds[i - 1];
+        }
+        while (b < length && !is_separator(text[b])) {
+            b++;
         }
+        bounds[i] = b;
+    }
+    bounds[parts] = length;
+}
 
-        // Подсчет количества чисел в файле
-        int count = 0;
-        int temp;
-        while (fscanf(file, "%d", &temp) == 1) {
-            count++;
+// Функция для отображения текстового файла в память только для чтения
+const char* map_text_file(const char* filename, size_t* length) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        perror("Ошибка при открытии файла");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror("Ошибка при получении размера файла");
+        close(fd);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    *length = (size_t)st.st_size;
+    if (*length == 0) {
+        close(fd);
+        return "";
+    }
+
+    void* text = mmap(NULL, *length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (text == MAP_FAILED) {
+        perror("Ошибка отображения файла в память");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    madvise(text, *length, MADV_SEQUENTIAL);
+    return (const char*)text;
+}
+
+// Функция для освобождения отображения текстового файла
+void unmap_text_file(const char* text, size_t length) {
+    if (length > 0) {
+        munmap((void*)text, length);
+    }
+}
+
+// Функция для разбора целых чисел из диапазона [p, end) в out.
+// Возвращает количество прочитанных чисел или -1 при ошибке формата
+long parse_int_range(const char* p, const char* end, int* out) {
+    long count = 0;
+    while (1) {
+        while (p < end && is_separator(*p)) {
+            p++;
         }
-        
-        rewind(file);  // Возврат к началу файла
-        
-        // Выделение памяти под массив
-        arr = (int*)malloc(count * sizeof(int));
+        if (p == end) {
+            break;
+        }
+
+        int negative = (*p == '-');
+        if (*p == '-' || *p == '+') {
+            p++;
+        }
+        if (p == end || *p < '0' || *p > '9') {
+            return -1;
+        }
+
+        long long value = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            value = value * 10 + (*p - '0');
+            if (value > (long long)INT_MAX + 1) {
+                return -1;
+            }
+            p++;
+        }
+        if (p < end && !is_separator(*p)) {
+            return -1;
+        }
+
+        value = negative ? -value : value;
+        if (value > INT_MAX) {
+            return -1;
+        }
+        out[count++] = (int)value;
+    }
+    return count;
+}
+
+// Функция для параллельного разбора текста с целыми числами за один проход:
+// каждый поток разбирает свой диапазон во временный буфер, затем куски
+// склеиваются в общий массив по префиксной сумме количеств.
+// Возвращает NULL при ошибке формата
+int* parse_int_text_parallel(const char* text, size_t length, int* size) {
+#ifdef _OPENMP
+    int num_chunks = omp_get_max_threads();
+#else
+    int num_chunks = 1;
+#endif
+    size_t* bounds = (size_t*)malloc((num_chunks + 1) * sizeof(size_t));
+    long* counts = (long*)malloc(num_chunks * sizeof(long));
+    size_t* offsets = (size_t*)malloc(num_chunks * sizeof(size_t));
+    int** chunks = (int**)calloc(num_chunks, sizeof(int*));
+    if (!bounds || !counts || !offsets || !chunks) {
+        perror("Ошибка выделения памяти");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    split_text_ranges(text, length, num_chunks, bounds);
+
+    // Разбор диапазонов: в диапазоне из L байт не больше L / 2 + 1 чисел
+    int failed = 0;
+    #pragma omp parallel for num_threads(num_chunks) schedule(static, 1) reduction(|:failed)
+    for (int c = 0; c < num_chunks; c++) {
+        size_t chunk_length = bounds[c + 1] - bounds[c];
+        chunks[c] = (int*)malloc((chunk_length / 2 + 1) * sizeof(int));
+        counts[c] = chunks[c] ? parse_int_range(text + bounds[c], text + bounds[c + 1], chunks[c]) : -1;
+        if (counts[c] < 0) {
+            failed = 1;
+        }
+    }
+
+    // Префиксная сумма количеств дает смещение каждого куска в итоговом массиве
+    size_t total = 0;
+    for (int c = 0; c < num_chunks && !failed; c++) {
+        offsets[c] = total;
+        total += (size_t)counts[c];
+    }
+
+    int* arr = NULL;
+    if (!failed && total <= INT_MAX) {
+        arr = (int*)malloc((total > 0 ? total : 1) * sizeof(int));
         if (!arr) {
             perror("Ошибка выделения памяти");
-            fclose(file);
             MPI_Abort(MPI_COMM_WORLD, 1);
         }
-        
-        // Чтение чисел в массив
-        for (int i = 0; i < count; i++) {
-            if (fscanf(file, "%d", &arr[i]) != 1) {
-                fprintf(stderr, "Ошибка при чтении элемента %d\n", i);
-                free(arr);
-                fclose(file);
-                MPI_Abort(MPI_COMM_WORLD, 1);
-            }
+
+        // Склейка кусков в общий массив
+        #pragma omp parallel for num_threads(num_chunks) schedule(static, 1)
+        for (int c = 0; c < num_chunks; c++) {
+            memcpy(arr + offsets[c], chunks[c], (size_t)counts[c] * sizeof(int));
         }
-        
-        fclose(file);
-        *size = count;
+        *size = (int)total;
+    }
+
+    for (int c = 0; c < num_chunks; c++) {
+        free(chunks[c]);
+    }
+    free(chunks);
+    free(offsets);
+    free(counts);
+    free(bounds);
+    return arr;
+}
+
+// Функция для чтения массива из текстового файла (параллельный разбор за один проход)
+int* read_array_from_file(const char* filename, int* size) {
+    size_t length;
+    const char* text = map_text_file(filename, &length);
+
+    int* arr = parse_int_text_parallel(text, length, size);
+    unmap_text_file(text, length);
+    if (!arr) {
+        fprintf(stderr, "Ошибка при чтении чисел из файла %s\n", filename);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    return arr;
+}
+
+// Бинарный формат массива: заголовок ArrayFileHeader, затем сырые данные,
+// начинающиеся со смещения data_offset (кратного alignment)
+#define ARRAY_FILE_MAGIC "PCSARR01"
+#define ARRAY_FILE_INT32 1
+#define ARRAY_FILE_FLOAT64 2
+
+typedef struct {
+    char magic[8];          // Сигнатура ARRAY_FILE_MAGIC
+    uint32_t elem_type;     // Тип элементов (ARRAY_FILE_INT32 / ARRAY_FILE_FLOAT64)
+    uint32_t alignment;     // Выравнивание начала данных в байтах
+    uint64_t count;         // Количество элементов
+    uint64_t data_offset;   // Смещение данных от начала файла
+} ArrayFileHeader;
+
+// Отображение бинарного файла в память
+typedef struct {
+    void* base;             // Начало отображения (NULL, если массив прочитан из текста)
+    size_t length;          // Длина отображения в байтах
+} MappedArray;
+
+// Функция для отображения бинарного массива в память (без разбора и копирования).
+// Возвращает указатель на данные или NULL, если файла нет
+void* map_array_file(const char* filename, uint32_t elem_type, int* size, MappedArray* mapped) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ArrayFileHeader)) {
+        fprintf(stderr, "Ошибка: файл %s не является бинарным массивом\n", filename);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // Закрытое отображение с правом записи: страницы копируются только при изменении
+    void* base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("Ошибка отображения файла в память");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // Проверка заголовка
+    const ArrayFileHeader* header = (const ArrayFileHeader*)base;
+    size_t elem_size = (elem_type == ARRAY_FILE_INT32) ? sizeof(int32_t) : sizeof(double);
+    if (memcmp(header->magic, ARRAY_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->elem_type != elem_type ||
+        header->alignment == 0 || header->data_offset % header->alignment != 0 ||
+        header->count > INT_MAX ||
+        header->data_offset + header->count * elem_size > (uint64_t)st.st_size) {
+        fprintf(stderr, "Ошибка: некорректный заголовок бинарного массива %s\n", filename);
+        munmap(base, (size_t)st.st_size);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // Данные читаются последовательно - подсказываем ядру упреждающее чтение
+    madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    mapped->base = base;
+    mapped->length = (size_t)st.st_size;
+    *size = (int)header->count;
+    return (char*)base + header->data_offset;
+}
+
+// Функция для загрузки массива: бинарный файл отображается в память,
+// при его отсутствии читается текстовый
+int* load_array(const char* bin_filename, const char* txt_filename, int* size, MappedArray* mapped) {
+    mapped->base = NULL;
+    mapped->length = 0;
+
+    int* arr = (int*)map_array_file(bin_filename, ARRAY_FILE_INT32, size, mapped);
+    if (!arr) {
+        arr = read_array_from_file(txt_filename, size);
     }
-    
     return arr;
 }
 
-// Функция для вычисления частичной суммы
-long long calculate_partial_sum(const int* arr, int start, int end) {
+// Функция для освобождения массива, полученного через load_array
+void release_array(int* arr, MappedArray* mapped) {
+    if (mapped->base) {
+        munmap(mapped->base, mapped->length);
+    } else {
+        free(arr);
+    }
+}
+
+// Запас байтов, дочитываемый за границей своего диапазона текстового файла,
+// чтобы найти конец последнего числа (длиннее запаса числа быть не могут)
+#define TEXT_SLICE_OVERLAP 64
+
+// Наибольший объем одного вызова MPI_File_read_at_all (счетчик в MPI имеет тип int)
+#define TEXT_READ_CHUNK (1 << 30)
+
+// Функция для вычисления блочного распределения: первые remainder процессов
+// получают на один элемент больше
+void block_range(int global_size, int rank, int size, int* count, int* displ) {
+    int chunk_size = global_size / size;
+    int remainder = global_size % size;
+    *count = chunk_size + (rank < remainder ? 1 : 0);
+    *displ = rank * chunk_size + (rank < remainder ? rank : remainder);
+}
+
+// Функция для коллективного чтения своей части бинарного массива через MPI-IO.
+// Возвращает NULL, если файла нет
+int* read_binary_slice(const char* filename, int* global_size, int* local_size, int rank, int size) {
+    MPI_File fh;
+    if (MPI_File_open(MPI_COMM_WORLD, filename, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+        return NULL;
+    }
+
+    // Все процессы читают заголовок и проверяют его
+    ArrayFileHeader header;
+    MPI_Offset file_size;
+    MPI_File_get_size(fh, &file_size);
+    MPI_File_read_at_all(fh, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE);
+    if ((uint64_t)file_size < sizeof(header) ||
+        memcmp(header.magic, ARRAY_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.elem_type != ARRAY_FILE_INT32 ||
+        header.alignment == 0 || header.data_offset % header.alignment != 0 ||
+        header.count > INT_MAX ||
+        header.data_offset + header.count * sizeof(int32_t) > (uint64_t)file_size) {
+        if (rank == 0) {
+            fprintf(stderr, "Ошибка: некорректный заголовок бинарного массива %s\n", filename);
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // Каждый процесс читает только свой блок
+    int displ;
+    *global_size = (int)header.count;
+    block_range(*global_size, rank, size, local_size, &displ);
+    int* local_array = (int*)malloc((*local_size > 0 ? *local_size : 1) * sizeof(int));
+    if (!local_array) {
+        perror("Ошибка выделения памяти");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_Offset offset = (MPI_Offset)header.data_offset + (MPI_Offset)displ * (MPI_Offset)sizeof(int32_t);
+    MPI_File_read_at_all(fh, offset, local_array, *local_size, MPI_INT, MPI_STATUS_IGNORE);
+
+    MPI_File_close(&fh);
+    return local_array;
+}
+
+// Функция для перераспределения частей массива произвольного размера
+// в блочное распределение (один вызов MPI_Alltoallv; ненулевые части передаются
+// только процессам, чьи блоки пересекаются с частью отправителя)
+int* rebalance_to_blocks(int* parts, int part_size, int* global_size, int* local_size, int rank, int size) {
+    long long my_count = part_size, my_offset = 0, total = 0;
+    MPI_Exscan(&my_count, &my_offset, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0) {
+        my_offset = 0;
+    }
+    MPI_Allreduce(&my_count, &total, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    if (total > INT_MAX) {
+        if (rank == 0) {
+            fprintf(stderr, "Ошибка: слишком большой массив (%lld элементов)\n", total);
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    *global_size = (int)total;
+
+    // Смещения частей всех процессов нужны, чтобы понять, от кого получать данные
+    long long* offsets = (long long*)malloc((size + 1) * sizeof(long long));
+    int* sendcounts = (int*)calloc(size, sizeof(int));
+    int* sdispls = (int*)calloc(size, sizeof(int));
+    int* recvcounts = (int*)calloc(size, sizeof(int));
+    int* rdispls = (int*)calloc(size, sizeof(int));
+    if (!offsets || !sendcounts || !sdispls || !recvcounts || !rdispls) {
+        perror("Ошибка выделения памяти");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_Allgather(&my_offset, 1, MPI_LONG_LONG, offsets, 1, MPI_LONG_LONG, MPI_COMM_WORLD);
+    offsets[size] = total;
+
+    int my_displ;
+    block_range(*global_size, rank, size, local_size, &my_displ);
+    for (int j = 0; j < size; j++) {
+        // Пересечение моей части с блоком процесса j
+        int count, displ;
+        block_range(*global_size, j, size, &count, &displ);
+        long long lo = (my_offset > displ) ? my_offset : displ;
+        long long hi = (my_offset + my_count < displ + count) ? my_offset + my_count : displ + count;
+        if (hi > lo) {
+            sendcounts[j] = (int)(hi - lo);
+            sdispls[j] = (int)(lo - my_offset);
+        }
+
+        // Пересечение части процесса j с моим блоком
+        lo = (offsets[j] > my_displ) ? offsets[j] : my_displ;
+        hi = (offsets[j + 1] < my_displ + *local_size) ? offsets[j + 1] : my_displ + *local_size;
+        if (hi > lo) {
+            recvcounts[j] = (int)(hi - lo);
+            rdispls[j] = (int)(lo - my_displ);
+        }
+    }
+
+    int* local_array = (int*)malloc((*local_size > 0 ? *local_size : 1) * sizeof(int));
+    if (!local_array) {
+        perror("Ошибка выделения памяти");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_Alltoallv(parts, sendcounts, sdispls, MPI_INT,
+                  local_array, recvcounts, rdispls, MPI_INT, MPI_COMM_WORLD);
+
+    free(offsets);
+    free(sendcounts);
+    free(sdispls);
+    free(recvcounts);
+    free(rdispls);
+    return local_array;
+}
+
+// Функция для коллективного чтения своей части текстового файла через MPI-IO.
+// Файл делится на диапазоны байтов по числу процессов; число относится к процессу,
+// в диапазоне которого (после сдвига границ к разделителям) оно начинается
+int* read_text_slice(const char* filename, int* global_size, int* local_size, int rank, int size) {
+    MPI_File fh;
+    if (MPI_File_open(MPI_COMM_WORLD, filename, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+        if (rank == 0) {
+            fprintf(stderr, "Ошибка при открытии файла %s\n", filename);
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    MPI_Offset file_size;
+    MPI_File_get_size(fh, &file_size);
+    MPI_Offset begin = file_size / size * rank;
+    MPI_Offset end = (rank == size - 1) ? file_size : file_size / size * (rank + 1);
+    MPI_Offset read_end = (end + TEXT_SLICE_OVERLAP < file_size) ? end + TEXT_SLICE_OVERLAP : file_size;
+
+    // Читаем свой диапазон вместе с запасом. Диапазон может превышать INT_MAX байт,
+    // поэтому он читается порциями; число коллективных вызовов у всех процессов одинаково
+    size_t read_length = (size_t)(read_end - begin);
+    char* text = (char*)malloc(read_length > 0 ? read_length : 1);
+    if (!text) {
+        perror("Ошибка выделения памяти");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    long long my_rounds = (long long)((read_length + TEXT_READ_CHUNK - 1) / TEXT_READ_CHUNK), rounds = 0;
+    MPI_Allreduce(&my_rounds, &rounds, 1, MPI_LONG_LONG, MPI_MAX, MPI_COMM_WORLD);
+    size_t done = 0;
+    for (long long r = 0; r < rounds; r++) {
+        size_t chunk = read_length - done < TEXT_READ_CHUNK ? read_length - done : TEXT_READ_CHUNK;
+        MPI_File_read_at_all(fh, begin + (MPI_Offset)done, text + done, (int)chunk, MPI_CHAR, MPI_STATUS_IGNORE);
+        done += chunk;
+    }
+    MPI_File_close(&fh);
+
+    // Сдвигаем обе границы вперед до ближайшего разделителя
+    size_t local_begin = 0;
+    if (rank > 0) {
+        while (local_begin < read_length && !is_separator(text[local_begin])) {
+            local_begin++;
+        }
+    }
+    size_t local_end = (size_t)(end - begin);
+    if (rank < size - 1) {
+        while (local_end < read_length && !is_separator(text[local_end])) {
+            local_end++;
+        }
+    }
+    int failed = (local_end == read_length && read_end < file_size);
+    if (local_begin > local_end) {
+        local_begin = local_end;
+    }
+
+    int part_size = 0;
+    int* parts = NULL;
+    if (!failed) {
+        parts = parse_int_text_parallel(text + local_begin, local_end - local_begin, &part_size);
+        failed = (parts == NULL);
+    }
+    free(text);
+
+    int any_failed = 0;
+    MPI_Allreduce(&failed, &any_failed, 1, MPI_INT, MPI_LOR, MPI_COMM_WORLD);
+    if (any_failed) {
+        if (rank == 0) {
+            fprintf(stderr, "Ошибка при чтении чисел из файла %s\n", filename);
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // Части разного размера приводим к тому же блочному распределению, что и у бинарного файла
+    int* local_array = rebalance_to_blocks(parts, part_size, global_size, local_size, rank, size);
+    free(parts);
+    return local_array;
+}
+
+// Функция для распределенного чтения массива: каждый процесс читает только свою часть
+// (бинарный файл, если он есть, иначе текстовый), без рассылки с корневого процесса
+int* read_array_distributed(const char* bin_filename, const char* txt_filename,
+                            int* global_size, int* local_size, int rank, int size) {
+    int* local_array = read_binary_slice(bin_filename, global_size, local_size, rank, size);
+    if (!local_array) {
+        local_array = read_text_slice(txt_filename, global_size, local_size, rank, size);
+    }
+    return local_array;
+}
+
+// Ядро суммирования: сумма count элементов int32 в long long
+typedef long long (*sum_kernel_fn)(const int* arr, long count);
+
+// Скалярное ядро (используется, если векторные расширения недоступны)
+long long sum_kernel_scalar(const int* arr, long count) {
     long long sum = 0;
-    for (int i = start; i < end; i++) {
+    for (long i = 0; i < count; i++) {
+        sum += arr[i];
+    }
+    return sum;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// SSE2: знаковое расширение int32 -> int64 через распаковку со знаковой маской,
+// два независимых аккумулятора
+__attribute__((target("sse2")))
+long long sum_kernel_sse2(const int* arr, long count) {
+    __m128i acc0 = _mm_setzero_si128();
+    __m128i acc1 = _mm_setzero_si128();
+    long i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(arr + i));
+        __m128i sign = _mm_srai_epi32(v, 31);
+        acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(v, sign));
+        acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(v, sign));
+    }
+    long long lanes[2];
+    _mm_storeu_si128((__m128i*)lanes, _mm_add_epi64(acc0, acc1));
+    long long sum = lanes[0] + lanes[1];
+    for (; i < count; i++) {
+        sum += arr[i];
+    }
+    return sum;
+}
+
+// AVX2: 16 элементов за итерацию, четыре независимых аккумулятора по 4 x int64
+__attribute__((target("avx2")))
+long long sum_kernel_avx2(const int* arr, long count) {
+    __m256i acc0 = _mm256_setzero_si256();
+    __m256i acc1 = _mm256_setzero_si256();
+    __m256i acc2 = _mm256_setzero_si256();
+    __m256i acc3 = _mm256_setzero_si256();
+    long i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i v0 = _mm256_loadu_si256((const __m256i*)(arr + i));
+        __m256i v1 = _mm256_loadu_si256((const __m256i*)(arr + i + 8));
+        acc0 = _mm256_add_epi64(acc0, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v0)));
+        acc1 = _mm256_add_epi64(acc1, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v0, 1)));
+        acc2 = _mm256_add_epi64(acc2, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v1)));
+        acc3 = _mm256_add_epi64(acc3, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v1, 1)));
+    }
+    __m256i acc = _mm256_add_epi64(_mm256_add_epi64(acc0, acc1), _mm256_add_epi64(acc2, acc3));
+    long long lanes[4];
+    _mm256_storeu_si256((__m256i*)lanes, acc);
+    long long sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for (; i < count; i++) {
         sum += arr[i];
     }
     return sum;
 }
 
+// AVX-512: 32 элемента за итерацию, четыре независимых аккумулятора по 8 x int64
+__attribute__((target("avx512f")))
+long long sum_kernel_avx512(const int* arr, long count) {
+    __m512i acc0 = _mm512_setzero_si512();
+    __m512i acc1 = _mm512_setzero_si512();
+    __m512i acc2 = _mm512_setzero_si512();
+    __m512i acc3 = _mm512_setzero_si512();
+    long i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m512i v0 = _mm512_loadu_si512((const void*)(arr + i));
+        __m512i v1 = _mm512_loadu_si512((const void*)(arr + i + 16));
+        acc0 = _mm512_add_epi64(acc0, _mm512_cvtepi32_epi64(_mm512_castsi512_si256(v0)));
+        acc1 = _mm512_add_epi64(acc1, _mm512_cvtepi32_epi64(_mm512_extracti64x4_epi64(v0, 1)));
+        acc2 = _mm512_add_epi64(acc2, _mm512_cvtepi32_epi64(_mm512_castsi512_si256(v1)));
+        acc3 = _mm512_add_epi64(acc3, _mm512_cvtepi32_epi64(_mm512_extracti64x4_epi64(v1, 1)));
+    }
+    __m512i acc = _mm512_add_epi64(_mm512_add_epi64(acc0, acc1), _mm512_add_epi64(acc2, acc3));
+    long long sum = _mm512_reduce_add_epi64(acc);
+    for (; i < count; i++) {
+        sum += arr[i];
+    }
+    return sum;
+}
+#endif
+
+// Функция для выбора лучшего ядра суммирования по данным CPUID
+sum_kernel_fn select_sum_kernel(const char** name) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        *name = "AVX-512";
+        return sum_kernel_avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        *name = "AVX2";
+        return sum_kernel_avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        *name = "SSE2";
+        return sum_kernel_sse2;
+    }
+#endif
+    *name = "скалярное";
+    return sum_kernel_scalar;
+}
+
+// Ядро суммирования, выбранное при запуске
+sum_kernel_fn sum_kernel = sum_kernel_scalar;
+
+// Функция для получения числа OpenMP-потоков процесса (1 без OpenMP)
+int max_threads(void) {
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+// Функция для получения номера текущего потока и его диапазона [begin, end)
+// в массиве из count элементов (непрерывные диапазоны равного размера)
+int thread_range(long count, long* begin, long* end) {
+#ifdef _OPENMP
+    int thread = omp_get_thread_num();
+    int threads = omp_get_num_threads();
+#else
+    int thread = 0;
+    int threads = 1;
+#endif
+    *begin = count * thread / threads;
+    *end = count * (thread + 1) / threads;
+    return thread;
+}
+
+// Диапазон гистограммы по умолчанию соответствует Array_generation.py
+#define HIST_DEFAULT_LOW 1
+#define HIST_DEFAULT_HIGH 1000
+#define HIST_DEFAULT_BINS 10
+
+// Параметры гистограммы: максимальное число интервалов и размер блока,
+// который после чтения из памяти обрабатывается повторно уже из кэша L1
+#define HIST_MAX_BINS 64
+#define STATS_BLOCK 2048
+
+// Наибольшая ширина диапазона гистограммы, для которой номер интервала
+// берется из таблицы (по байту на значение)
+#define HIST_LUT_MAX 65536
+
+// Частичная статистика части массива. Дисперсия хранится как сумма квадратов
+// отклонений от среднего (m2) и объединяется по формуле Чана
+typedef struct {
+    long long count;
+    long long sum;
+    int min;
+    int max;
+    double mean;
+    double m2;
+    long long below;                // Элементов ниже диапазона гистограммы
+    long long above;                // Элементов выше диапазона гистограммы
+    long long hist[HIST_MAX_BINS];
+} ArrayStats;
+
+// Диапазон гистограммы [low, high], разбитый на bins равных интервалов.
+// Значение v попадает в интервал (v - low) * bins / span; отображение
+// заполняется один раз функцией hist_range_prepare
+typedef struct {
+    int low;
+    int high;
+    int bins;
+    unsigned long long span;                        // high - low + 1
+    unsigned char* lut;                             // Интервал каждого значения (span <= HIST_LUT_MAX)
+    unsigned long long recip;                       // floor(bins * 2^32 / span) для широкого диапазона
+    unsigned long long starts[HIST_MAX_BINS + 1];   // Смещение начала интервала от low
+} HistRange;
+
+// Функция для подготовки отображения значений в интервалы: для узкого диапазона
+// строится таблица, для широкого - обратная величина в фиксированной точке.
+// Возвращает 0 при нехватке памяти
+int hist_range_prepare(HistRange* range) {
+    range->span = (unsigned long long)((long long)range->high - range->low + 1);
+    for (int i = 0; i <= range->bins; i++) {
+        range->starts[i] = (range->span * i + range->bins - 1) / range->bins;
+    }
+    range->lut = NULL;
+    range->recip = ((unsigned long long)range->bins << 32) / range->span;
+    if (range->span <= HIST_LUT_MAX) {
+        range->lut = (unsigned char*)malloc(range->span);
+        if (!range->lut) {
+            return 0;
+        }
+        for (int i = 0; i < range->bins; i++) {
+            for (unsigned long long off = range->starts[i]; off < range->starts[i + 1]; off++) {
+                range->lut[off] = (unsigned char)i;
+            }
+        }
+    }
+    return 1;
+}
+
+// Функция для освобождения таблицы интервалов
+void hist_range_free(HistRange* range) {
+    free(range->lut);
+    range->lut = NULL;
+}
+
+// Функция для вычисления интервала по смещению off = v - low из [0, span) без деления:
+// off * recip / 2^32 меньше точного значения не более чем на единицу (off < 2^32),
+// поэтому достаточно одной поправки по границе следующего интервала
+static inline int hist_bin_wide(const HistRange* range, unsigned long long off) {
+    int bin = (int)((off * range->recip) >> 32);
+    return bin + (off >= range->starts[bin + 1]);
+}
+
+// Функция для определения ячейки счетчиков значения без ветвлений по данным:
+// интервалы 0..bins - 1, bins - ниже диапазона, bins + 1 - выше. Значение
+// ограничивается диапазоном, а ячейка вне диапазона выбирается по маске
+static inline int hist_slot(const HistRange* range, int value) {
+    int below = value < range->low;
+    int above = value > range->high;
+    int clamped = below ? range->low : value;
+    clamped = above ? range->high : clamped;
+    unsigned int off = (unsigned int)clamped - (unsigned int)range->low;
+    int bin = range->lut ? range->lut[off] : hist_bin_wide(range, off);
+    int outside = -(below | above);
+    return (bin & ~outside) | ((range->bins + above) & outside);
+}
+
+// Функция для инициализации пустой статистики
+void stats_init(ArrayStats* s) {
+    memset(s, 0, sizeof(*s));
+    s->min = INT_MAX;
+    s->max = INT_MIN;
+}
+
+// Функция для объединения статистики b с a (формула Чана для среднего и m2)
+void stats_merge(ArrayStats* a, const ArrayStats* b) {
+    if (b->count == 0) {
+        return;
+    }
+    if (a->count == 0) {
+        *a = *b;
+        return;
+    }
+    
+    long long n = a->count + b->count;
+    double delta = b->mean - a->mean;
+    a->mean += delta * b->count / n;
+    a->m2 += b->m2 + delta * delta * ((double)a->count * b->count / n);
+    a->count = n;
+    a->sum += b->sum;
+    if (b->min < a->min) a->min = b->min;
+    if (b->max > a->max) a->max = b->max;
+    a->below += b->below;
+    a->above += b->above;
+    for (int i = 0; i < HIST_MAX_BINS; i++) {
+        a->hist[i] += b->hist[i];
+    }
+}
+
+// Функция для добавления блока к статистике: сумма считается векторным ядром,
+// затем тот же блок (уже в кэше) проходится векторизуемым циклом для минимума,
+// максимума и отклонений от среднего блока и отдельным циклом для гистограммы
+void stats_add_block(ArrayStats* s, const int* arr, long count, const HistRange* range) {
+    ArrayStats block;
+    stats_init(&block);
+    block.count = count;
+    block.sum = sum_kernel(arr, count);
+    block.mean = (double)block.sum / count;
+    
+    double mean = block.mean;
+    int min = INT_MAX, max = INT_MIN;
+    double m2 = 0.0;
+    #pragma omp simd reduction(min:min) reduction(max:max) reduction(+:m2)
+    for (long i = 0; i < count; i++) {
+        int value = arr[i];
+        min = (value < min) ? value : min;
+        max = (value > max) ? value : max;
+        double d = value - mean;
+        m2 += d * d;
+    }
+    block.min = min;
+    block.max = max;
+    block.m2 = m2;
+    
+    // Четыре копии счетчиков, чтобы соседние увеличения одной ячейки не ждали друг друга
+    unsigned int counts[4][HIST_MAX_BINS + 2];
+    memset(counts, 0, sizeof(counts));
+    long i = 0;
+    if (range->lut && min >= range->low && max <= range->high) {
+        // Весь блок внутри узкого диапазона: интервал берется из таблицы без проверок
+        const unsigned char* lut = range->lut;
+        unsigned int low = (unsigned int)range->low;
+        for (; i + 4 <= count; i += 4) {
+            counts[0][lut[(unsigned int)arr[i] - low]]++;
+            counts[1][lut[(unsigned int)arr[i + 1] - low]]++;
+            counts[2][lut[(unsigned int)arr[i + 2] - low]]++;
+            counts[3][lut[(unsigned int)arr[i + 3] - low]]++;
+        }
+        for (; i < count; i++) {
+            counts[0][lut[(unsigned int)arr[i] - low]]++;
+        }
+    } else {
+        for (; i + 4 <= count; i += 4) {
+            counts[0][hist_slot(range, arr[i])]++;
+            counts[1][hist_slot(range, arr[i + 1])]++;
+            counts[2][hist_slot(range, arr[i + 2])]++;
+            counts[3][hist_slot(range, arr[i + 3])]++;
+        }
+        for (; i < count; i++) {
+            counts[0][hist_slot(range, arr[i])]++;
+        }
+    }
+    for (int b = 0; b < range->bins + 2; b++) {
+        long long c = (long long)counts[0][b] + counts[1][b] + counts[2][b] + counts[3][b];
+        if (b < range->bins) {
+            block.hist[b] = c;
+        } else if (b == range->bins) {
+            block.below = c;
+        } else {
+            block.above = c;
+        }
+    }
+    stats_merge(s, &block);
+}
+
+// Функция для вычисления статистики диапазона массива за один проход блоками STATS_BLOCK
+void calculate_partial_stats(const int* arr, long count, const HistRange* range, ArrayStats* s) {
+    stats_init(s);
+    for (long begin = 0; begin < count; begin += STATS_BLOCK) {
+        long n = (count - begin < STATS_BLOCK) ? count - begin : STATS_BLOCK;
+        stats_add_block(s, arr + begin, n, range);
+    }
+}
+
+// Функция для вычисления только суммы локальной части всеми OpenMP-потоками процесса:
+// каждый поток суммирует свой непрерывный диапазон векторным ядром
+long long calculate_local_sum(const int* arr, long count) {
+    long long sum = 0;
+    #pragma omp parallel num_threads(max_threads()) reduction(+:sum)
+    {
+        long begin, end;
+        thread_range(count, &begin, &end);
+        sum += sum_kernel(arr + begin, end - begin);
+    }
+    return sum;
+}
+
+// Функция для вычисления статистики локальной части всеми OpenMP-потоками процесса:
+// каждый поток обрабатывает свой непрерывный диапазон, статистики потоков объединяются по порядку
+void calculate_local_stats(const int* arr, long count, const HistRange* range, ArrayStats* result) {
+    int threads = max_threads();
+    ArrayStats* partial = (ArrayStats*)malloc(threads * sizeof(ArrayStats));
+    if (!partial) {
+        fprintf(stderr, "Ошибка выделения памяти для статистики\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    for (int i = 0; i < threads; i++) {
+        stats_init(&partial[i]);
+    }
+    
+    #pragma omp parallel num_threads(threads)
+    {
+        long begin, end;
+        int thread = thread_range(count, &begin, &end);
+        calculate_partial_stats(arr + begin, end - begin, range, &partial[thread]);
+    }
+    
+    stats_init(result);
+    for (int i = 0; i < threads; i++) {
+        stats_merge(result, &partial[i]);
+    }
+    free(partial);
+}
+
+// Функция для разбора диапазона гистограммы из аргументов <нижняя> <верхняя> [<интервалов>].
+// Возвращает 0 при некорректных значениях
+int parse_hist_range(char** args, int count, HistRange* range) {
+    if (count >= 2) {
+        range->low = atoi(args[0]);
+        range->high = atoi(args[1]);
+    }
+    if (count >= 3) {
+        range->bins = atoi(args[2]);
+    }
+    return range->low <= range->high && range->bins > 0 && range->bins <= HIST_MAX_BINS;
+}
+
+// Функция для вывода сводной статистики и гистограммы
+void print_stats(const ArrayStats* s, const HistRange* range) {
+    if (s->count == 0) {
+        printf("Массив пуст\n");
+        return;
+    }
+    printf("Минимум: %d\n", s->min);
+    printf("Максимум: %d\n", s->max);
+    printf("Среднее: %.6f\n", s->mean);
+    printf("Дисперсия: %.6f\n", s->m2 / s->count);
+    
+    printf("Гистограмма [%d, %d], %d интервалов:\n", range->low, range->high, range->bins);
+    long long span = (long long)range->high - range->low + 1;
+    for (int i = 0; i < range->bins; i++) {
+        // Значение v попадает в интервал (v - low) * bins / span, отсюда границы интервала i
+        long long from = range->low + (span * i + range->bins - 1) / range->bins;
+        long long to = range->low + (span * (i + 1) + range->bins - 1) / range->bins - 1;
+        if (to < from) {
+            continue;  // Интервалов больше, чем значений в диапазоне
+        }
+        printf("  [%lld, %lld]: %lld\n", from, to, s->hist[i]);
+    }
+    if (s->below > 0) {
+        printf("  ниже %d: %lld\n", range->low, s->below);
+    }
+    if (s->above > 0) {
+        printf("  выше %d: %lld\n", range->high, s->above);
+    }
+}
+
+// Функция пользовательской операции MPI_Reduce: объединение частичных статистик
+// процессов (inout = in + inout по формуле Чана)
+void stats_reduce_op(void* in, void* inout, int* len, MPI_Datatype* datatype) {
+    (void)datatype;
+    const ArrayStats* a = (const ArrayStats*)in;
+    ArrayStats* b = (ArrayStats*)inout;
+    for (int i = 0; i < *len; i++) {
+        stats_merge(&b[i], &a[i]);
+    }
+}
+
+// Коммуникаторы двухуровневой схемы коллективных операций: процессы одного узла
+// (общая память) и лидеры узлов (процессы с номером 0 на своем узле)
+typedef struct {
+    MPI_Comm node;          // Процессы узла
+    MPI_Comm leaders;       // Лидеры узлов (MPI_COMM_NULL у остальных процессов)
+    int node_rank;          // Номер процесса на узле
+    int num_nodes;          // Число узлов
+    int hierarchical;       // 1, если есть несколько узлов и хотя бы на одном несколько процессов
+} NodeComms;
+
+// Функция для построения коммуникаторов узла и лидеров. Процессы упорядочены по
+// глобальному номеру, поэтому процесс 0 - лидер своего узла и лидер с номером 0
+void create_node_comms(NodeComms* nc, int rank, int size) {
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &nc->node);
+    MPI_Comm_rank(nc->node, &nc->node_rank);
+    int is_leader = (nc->node_rank == 0);
+    MPI_Comm_split(MPI_COMM_WORLD, is_leader ? 0 : MPI_UNDEFINED, rank, &nc->leaders);
+    MPI_Allreduce(&is_leader, &nc->num_nodes, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    nc->hierarchical = (nc->num_nodes > 1 && nc->num_nodes < size);
+}
+
+// Функция для освобождения коммуникаторов двухуровневой схемы
+void free_node_comms(NodeComms* nc) {
+    if (nc->leaders != MPI_COMM_NULL) {
+        MPI_Comm_free(&nc->leaders);
+    }
+    MPI_Comm_free(&nc->node);
+}
+
+// Функция для двухуровневой редукции на процесс 0: сначала внутри узла через общую
+// память на лидера узла, затем между узлами только среди лидеров.
+// При одном узле или одном процессе на узел выполняется обычный MPI_Reduce
+void hierarchical_reduce(const void* sendbuf, void* recvbuf, int count, MPI_Datatype type,
+                         MPI_Op op, const NodeComms* nc) {
+    if (!nc->hierarchical) {
+        MPI_Reduce(sendbuf, recvbuf, count, type, op, 0, MPI_COMM_WORLD);
+        return;
+    }
+    
+    MPI_Aint lb, extent;
+    MPI_Type_get_extent(type, &lb, &extent);
+    void* node_result = NULL;
+    if (nc->node_rank == 0) {
+        node_result = malloc((size_t)count * extent);
+        if (!node_result) {
+            fprintf(stderr, "Ошибка выделения памяти для редукции\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    
+    MPI_Reduce(sendbuf, node_result, count, type, op, 0, nc->node);
+    if (nc->leaders != MPI_COMM_NULL) {
+        MPI_Reduce(node_result, recvbuf, count, type, op, 0, nc->leaders);
+    }
+    free(node_result);
+}
+
+// Число повторов при замере времени сканирования (берется лучшее время)
+#define SCAN_REPEATS 5
+
+// Функция для последовательного префиксного суммирования: out[i] - сумма arr[0..i]
+// (inclusive) или arr[0..i-1] (exclusive). Результат в long long, чтобы не переполниться
+void scan_sequential(const int* arr, long long* out, long count, long long offset, int inclusive) {
+    long long running = offset;
+    if (inclusive) {
+        for (long i = 0; i < count; i++) {
+            running += arr[i];
+            out[i] = running;
+        }
+    } else {
+        for (long i = 0; i < count; i++) {
+            out[i] = running;
+            running += arr[i];
+        }
+    }
+}
+
+// Функция для распределенного префиксного суммирования: локальная сумма части,
+// MPI_Exscan сумм дает глобальное смещение части, затем локальное сканирование с этим смещением.
+// Внутри процесса оба прохода выполняются OpenMP-потоками по своим диапазонам.
+// Результат остается распределенным: out[i] соответствует local_array[i]
+void scan_distributed(const int* local_array, long long* out, int local_size, int rank, int inclusive) {
+    int threads = max_threads();
+    long long* offsets = (long long*)calloc(threads + 1, sizeof(long long));
+    if (!offsets) {
+        fprintf(stderr, "Ошибка выделения памяти для сканирования\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    
+    // Проход 1: суммы диапазонов потоков и их исключающее сканирование
+    #pragma omp parallel num_threads(threads)
+    {
+        long begin, end;
+        int thread = thread_range(local_size, &begin, &end);
+        offsets[thread + 1] = sum_kernel(local_array + begin, end - begin);
+    }
+    for (int t = 1; t <= threads; t++) {
+        offsets[t] += offsets[t - 1];
+    }
+    
+    // Смещение части процесса - сумма частей предыдущих процессов (вызов из главного потока)
+    long long local_total = offsets[threads];
+    long long offset = 0;
+    MPI_Exscan(&local_total, &offset, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0) {
+        offset = 0;  // На процессе 0 результат MPI_Exscan не определен
+    }
+    
+    // Проход 2: каждый поток сканирует свой диапазон со своим смещением
+    #pragma omp parallel num_threads(threads)
+    {
+        long begin, end;
+        int thread = thread_range(local_size, &begin, &end);
+        scan_sequential(local_array + begin, out + begin, end - begin,
+                        offset + offsets[thread], inclusive);
+    }
+    free(offsets);
+}
+
+// Функция для проверки распределенного сканирования: начало части каждого процесса
+// независимо получается через MPI_Scan сумм частей, затем результат сверяется поэлементно.
+// Возвращает результат проверки на всех процессах
+int check_scan_distributed(const int* local_array, const long long* out, int local_size, int inclusive) {
+    long long local_total = 0, end_value;
+    for (int i = 0; i < local_size; i++) {
+        local_total += local_array[i];
+    }
+    MPI_Scan(&local_total, &end_value, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    
+    int ok = 1;
+    long long running = end_value - local_total;
+    for (int i = 0; i < local_size; i++) {
+        if (inclusive) {
+            running += local_array[i];
+            ok &= (out[i] == running);
+        } else {
+            ok &= (out[i] == running);
+            running += local_array[i];
+        }
+    }
+    
+    int all_ok;
+    MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+    return all_ok;
+}
+
 int main(int argc, char** argv) {
     int rank, size;
     int* global_array = NULL;
     int global_size = 0;
-    double start_time, end_time;
+    int* local_array = NULL;
+    int local_size = 0;
+    MappedArray mapped;
+    double start_time, end_time, read_start, read_time;
     
-    // Инициализация MPI
-    MPI_Init(&argc, &argv);
+    // Инициализация MPI для гибридного режима: локальные вычисления выполняют
+    // OpenMP-потоки процесса, MPI вызывается только из главного потока
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
+    if (provided < MPI_THREAD_FUNNELED) {
+        if (rank == 0) {
+            fprintf(stderr, "Предупреждение: MPI не поддерживает MPI_THREAD_FUNNELED, "
+                            "используется один поток на процесс\n");
+        }
+#ifdef _OPENMP
+        omp_set_num_threads(1);
+#endif
+    }
     
-    // Корневой процесс читает массив из файла
-    global_array = read_array_from_file("array.txt", &global_size, rank);
+    // Выбор ядра суммирования по возможностям процессора
+    const char* kernel_name;
+    sum_kernel = select_sum_kernel(&kernel_name);
+    
+    // Режим чтения: distributed (по умолчанию) - каждый процесс читает только свою часть файла,
+    // root - корневой процесс читает весь файл и рассылает части через MPI_Scatterv
+    // Следующие аргументы <нижняя> <верхняя> [<интервалов>] задают диапазон гистограммы
+    int root_read = (argc > 1 && strcmp(argv[1], "root") == 0);
+    int first_hist_arg = (argc > 1 && (root_read || strcmp(argv[1], "distributed") == 0)) ? 2 : 1;
+    // Вместо статистики можно вычислить только сумму (sum)
+    // или префиксную сумму: scan (inclusive) или exscan (exclusive)
+    int scan_mode = 0, inclusive = 1, sum_only = 0;
+    if (first_hist_arg < argc &&
+        (strcmp(argv[first_hist_arg], "scan") == 0 || strcmp(argv[first_hist_arg], "exscan") == 0)) {
+        scan_mode = 1;
+        inclusive = strcmp(argv[first_hist_arg], "scan") == 0;
+        first_hist_arg++;
+    } else if (first_hist_arg < argc && strcmp(argv[first_hist_arg], "sum") == 0) {
+        sum_only = 1;
+        first_hist_arg++;
+    }
+    int hist_args = argc - first_hist_arg;
+    HistRange range = {.low = HIST_DEFAULT_LOW, .high = HIST_DEFAULT_HIGH, .bins = HIST_DEFAULT_BINS};
+    if ((hist_args != 0 && hist_args != 2 && hist_args != 3) || ((scan_mode || sum_only) && hist_args != 0) ||
+        !parse_hist_range(argv + first_hist_arg, hist_args, &range)) {
+        if (rank == 0) {
+            printf("Использование: %s [root|distributed] [<нижняя_граница> <верхняя_граница> [<интервалов>]]\n", argv[0]);
+            printf("       %s [root|distributed] sum|scan|exscan\n", argv[0]);
+            printf("  границы и число интервалов (до %d) задают гистограмму (по умолчанию [%d, %d], %d интервалов)\n",
+                   HIST_MAX_BINS, HIST_DEFAULT_LOW, HIST_DEFAULT_HIGH, HIST_DEFAULT_BINS);
+            printf("  sum - только сумма элементов (без статистики)\n");
+        }
+        MPI_Finalize();
+        return 1;
+    }
+    
+    // Коммуникаторы узлов для двухуровневой редукции
+    NodeComms node_comms;
+    create_node_comms(&node_comms, rank, size);
     
-    // Синхронизация перед началом замера времени
     MPI_Barrier(MPI_COMM_WORLD);
-    start_time = MPI_Wtime();
+    read_start = MPI_Wtime();
     
-    // Рассылаем размер массива всем процессам
-    MPI_Bcast(&global_size, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (root_read) {
+        // Корневой процесс загружает массив (array.bin отображается в память, иначе читается array.txt)
+        if (rank == 0) {
+            global_array = load_array("array.bin", "array.txt", &global_size, &mapped);
+        }
+    } else {
+        // Каждый процесс читает свой блок (array.bin через MPI-IO, иначе свой диапазон array.txt)
+        local_array = read_array_distributed("array.bin", "array.txt",
+                                             &global_size, &local_size, rank, size);
+    }
     
-    // Вычисляем размер части массива для каждого процесса
-    int chunk_size = global_size / size;
-    int remainder = global_size % size;
+    // Синхронизация перед началом замера времени
+    MPI_Barrier(MPI_COMM_WORLD);
+    read_time = MPI_Wtime() - read_start;
+    start_time = MPI_Wtime();
     
-    // Массивы для хранения размеров и смещений для каждого процесса
-    int* send_counts = NULL;
-    int* displacements = NULL;
+    if (root_read) {
+        // Рассылаем размер массива всем процессам
+        MPI_Bcast(&global_size, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        
+        // Вычисляем размер части массива для каждого процесса
+        int chunk_size = global_size / size;
+        int remainder = global_size % size;
+        
+        // Массивы для хранения размеров и смещений для каждого процесса
+        int* send_counts = NULL;
+        int* displacements = NULL;
+        
+        if (rank == 0) {
+            send_counts = (int*)malloc(size * sizeof(int));
+            displacements = (int*)malloc(size * sizeof(int));
+            
+            // Вычисляем размеры и смещения для каждого процесса
+            int sum = 0;
+            for (int i = 0; i < size; i++) {
+                send_counts[i] = chunk_size + (i < remainder ? 1 : 0);
+                displacements[i] = sum;
+                sum += send_counts[i];
+            }
+        }
+        
+        // Отправляем каждому процессу его размер части массива
+        if (rank == 0) {
+            local_size = send_counts[0];
+        } else {
+            local_size = chunk_size + (rank < remainder ? 1 : 0);
+        }
+        
+        // Выделяем память под локальную часть массива
+        local_array = (int*)malloc(local_size * sizeof(int));
+        
+        // Рассылаем части массива процессам
+        MPI_Scatterv(global_array, send_counts, displacements, MPI_INT,
+                    local_array, local_size, MPI_INT,
+                    0, MPI_COMM_WORLD);
+        
+        // Освобождаем память
+        free(send_counts);
+        free(displacements);
+    }
     
-    if (rank == 0) {
-        send_counts = (int*)malloc(size * sizeof(int));
-        displacements = (int*)malloc(size * sizeof(int));
+    // Префиксная сумма: локальное сканирование + MPI_Exscan сумм частей
+    if (scan_mode) {
+        long long* local_scan = (long long*)malloc((local_size > 0 ? local_size : 1) * sizeof(long long));
+        if (!local_scan) {
+            fprintf(stderr, "Ошибка выделения памяти для сканирования\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        
+        // Лучшее из SCAN_REPEATS время распределенного и последовательного сканирования.
+        // Последовательное - на процессе 0 по всему массиву (режим root) или
+        // сумма времен локальных сканирований без обмена (режим distributed)
+        double scan_time = -1.0, seq_time = -1.0;
+        long long* seq_scan = NULL;
+        if (root_read && rank == 0) {
+            seq_scan = (long long*)malloc((global_size > 0 ? global_size : 1) * sizeof(long long));
+            if (!seq_scan) {
+                fprintf(stderr, "Ошибка выделения памяти для сканирования\n");
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+        }
+        for (int rep = 0; rep < SCAN_REPEATS; rep++) {
+            MPI_Barrier(MPI_COMM_WORLD);
+            double t0 = MPI_Wtime();
+            scan_distributed(local_array, local_scan, local_size, rank, inclusive);
+            MPI_Barrier(MPI_COMM_WORLD);
+            double elapsed = MPI_Wtime() - t0;
+            if (scan_time < 0.0 || elapsed < scan_time) scan_time = elapsed;
+            
+            double local_seq = 0.0;
+            if (root_read) {
+                if (rank == 0) {
+                    t0 = MPI_Wtime();
+                    scan_sequential(global_array, seq_scan, global_size, 0, inclusive);
+                    local_seq = MPI_Wtime() - t0;
+                }
+            } else {
+                t0 = MPI_Wtime();
+                scan_sequential(local_array, local_scan, local_size, 0, inclusive);
+                local_seq = MPI_Wtime() - t0;
+            }
+            MPI_Allreduce(MPI_IN_PLACE, &local_seq, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+            if (seq_time < 0.0 || local_seq < seq_time) seq_time = local_seq;
+        }
+        
+        // Последний замер последовательного сканирования мог перезаписать local_scan
+        scan_distributed(local_array, local_scan, local_size, rank, inclusive);
+        int correct = check_scan_distributed(local_array, local_scan, local_size, inclusive);
         
-        // Вычисляем размеры и смещения для каждого процесса
-        int sum = 0;
-        for (int i = 0; i < size; i++) {
-            send_counts[i] = chunk_size + (i < remainder ? 1 : 0);
-            displacements[i] = sum;
-            sum += send_counts[i];
+        // Итоговая накопленная сумма - на последнем процессе с непустой частью
+        int owner = local_size > 0 ? rank : -1;
+        MPI_Allreduce(MPI_IN_PLACE, &owner, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+        long long last_value = local_size > 0 ? local_scan[local_size - 1] : 0;
+        if (owner >= 0) {
+            MPI_Bcast(&last_value, 1, MPI_LONG_LONG, owner, MPI_COMM_WORLD);
         }
+        
+        if (rank == 0) {
+            double bytes = (double)global_size * (sizeof(int) + sizeof(long long));
+            printf("=== ПРЕФИКСНАЯ СУММА (MPI_Exscan) ===\n");
+            printf("Количество процессов: %d\n", size);
+            printf("OpenMP-потоков на процесс: %d\n", max_threads());
+            printf("Вид: %s\n", inclusive ? "inclusive" : "exclusive");
+            printf("Размер массива: %d элементов\n", global_size);
+            if (global_size > 0) {
+                printf("Последний элемент: %lld\n", last_value);
+            }
+            printf("Распределенное сканирование: %.6f секунд (%.2f ГБ/с)\n", scan_time, bytes / scan_time / 1e9);
+            printf("Последовательное сканирование%s: %.6f секунд\n",
+                   root_read ? "" : " (сумма локальных времен)", seq_time);
+            printf("Ускорение: %.2f\n", seq_time / scan_time);
+            printf(correct ? "Проверка: префиксные суммы корректны\n"
+                           : "ОШИБКА: префиксные суммы некорректны!\n");
+            if (root_read) {
+                release_array(global_array, &mapped);
+            }
+        }
+        free(seq_scan);
+        free(local_scan);
+        free(local_array);
+        free_node_comms(&node_comms);
+        MPI_Finalize();
+        return correct ? 0 : 1;
     }
     
-    // Отправляем каждому процессу его размер части массива
-    int local_size;
-    if (rank == 0) {
-        local_size = send_counts[0];
+    // Вычисляем локальную сумму (и статистику) за один проход и собираем результаты
+    // на корневом процессе (на многоузловом запуске - сначала внутри узлов,
+    // затем между лидерами узлов)
+    ArrayStats local_stats, total_stats;
+    if (sum_only) {
+        long long local_sum = calculate_local_sum(local_array, local_size);
+        hierarchical_reduce(&local_sum, &total_stats.sum, 1, MPI_LONG_LONG, MPI_SUM, &node_comms);
     } else {
-        local_size = chunk_size + (rank < remainder ? 1 : 0);
+        if (!hist_range_prepare(&range)) {
+            fprintf(stderr, "Ошибка выделения памяти для гистограммы\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        calculate_local_stats(local_array, local_size, &range, &local_stats);
+        
+        // Частичные статистики объединяются пользовательской операцией
+        MPI_Datatype stats_type;
+        MPI_Type_contiguous(sizeof(ArrayStats), MPI_BYTE, &stats_type);
+        MPI_Type_commit(&stats_type);
+        MPI_Op stats_op;
+        MPI_Op_create(stats_reduce_op, 1, &stats_op);
+        hierarchical_reduce(&local_stats, &total_stats, 1, stats_type, stats_op, &node_comms);
+        MPI_Op_free(&stats_op);
+        MPI_Type_free(&stats_type);
     }
     
-    // Выделяем память под локальную часть массива
-    int* local_array = (int*)malloc(local_size * sizeof(int));
-    
-    // Рассылаем части массива процессам
-    MPI_Scatterv(global_array, send_counts, displacements, MPI_INT,
-                local_array, local_size, MPI_INT,
-                0, MPI_COMM_WORLD);
-    
-    // Вычисляем локальную сумму
-    long long local_sum = calculate_partial_sum(local_array, 0, local_size);
-    
-    // Собираем частичные суммы на корневом процессе
-    long long total_sum;
-    MPI_Reduce(&local_sum, &total_sum, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
-    
     // Синхронизация перед замером времени
     MPI_Barrier(MPI_COMM_WORLD);
     end_time = MPI_Wtime();
@@ -130,22 +1316,30 @@ int main(int argc, char** argv) {
     if (rank == 0) {
         printf("=== ПАРАЛЛЕЛЬНАЯ ВЕРСИЯ (MPI) ===\n");
         printf("Количество процессов: %d\n", size);
+        printf("OpenMP-потоков на процесс: %d\n", max_threads());
+        printf("Ядро суммирования: %s\n", kernel_name);
+        printf("Режим чтения: %s\n", root_read ? "корневой процесс + MPI_Scatterv" : "распределенный (MPI-IO)");
+        if (node_comms.hierarchical) {
+            printf("Редукция: двухуровневая (%d узлов)\n", node_comms.num_nodes);
+        }
         printf("Размер массива: %d элементов\n", global_size);
-        printf("Сумма элементов: %lld\n", total_sum);
+        printf("Сумма элементов: %lld\n", total_stats.sum);
+        if (!sum_only) {
+            print_stats(&total_stats, &range);
+        }
+        printf("Время чтения входных данных: %.6f секунд\n", read_time);
         printf("Время выполнения: %.6f секунд\n", end_time - start_time);
-        
-        // Освобождаем память
-        free(send_counts);
-        free(displacements);
     }
     
     // Освобождаем память
-    if (rank == 0) {
-        free(global_array);
+    if (rank == 0 && root_read) {
+        release_array(global_array, &mapped);
     }
     free(local_array);
+    hist_range_free(&range);
+    free_node_comms(&node_comms);
     
     // Завершаем работу с MPI
     MPI_Finalize();
     return 0;
-}
\ No newline at end of file
+}
@@ -1,51 +1,288 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <mpi.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include <stdbool.h>
 #include <time.h>
 #include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+#include <aio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-// Функция для чтения массива из файла
-int* read_array_from_file(const char* filename, int* size) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
+// Функция для проверки, является ли символ разделителем чисел
+static inline int is_separator(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Функция для разбиения текста на диапазоны байтов по числу потоков.
+// Границы сдвигаются вперед до ближайшего разделителя, чтобы не разрезать числа
+void split_text_ranges(const char* text, size_t length, int parts, size_t* bounds) {
+    bounds[0] = 0;
+    for (int i = 1; i < parts; i++) {
+        size_t b = length / parts * i;
+        if (b < bounds[i - 1]) {
+            b = bounds[i - 1];
+        }
+        while (b < length && !is_separator(text[b])) {
+            b++;
+        }
+        bounds[i] = b;
+    }
+    bounds[parts] = length;
+}
+
+// Функция для отображения текстового файла в память только для чтения
+const char* map_text_file(const char* filename, size_t* length) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
         perror("Ошибка при открытии файла");
         exit(EXIT_FAILURE);
     }
 
-    // Подсчет количества чисел в файле
-    int count = 0;
-    int temp;
-    while (fscanf(file, "%d", &temp) == 1) {
-        count++;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror("Ошибка при получении размера файла");
+        close(fd);
+        exit(EXIT_FAILURE);
     }
-    
-    // Возврат к началу файла
-    rewind(file);
-    
-    // Выделение памяти под массив
-    int* arr = (int*)malloc(count * sizeof(int));
-    if (!arr) {
+
+    *length = (size_t)st.st_size;
+    if (*length == 0) {
+        close(fd);
+        return "";
+    }
+
+    void* text = mmap(NULL, *length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (text == MAP_FAILED) {
+        perror("Ошибка отображения файла в память");
+        exit(EXIT_FAILURE);
+    }
+    madvise(text, *length, MADV_SEQUENTIAL);
+    return (const char*)text;
+}
+
+// Функция для освобождения отображения текстового файла
+void unmap_text_file(const char* text, size_t length) {
+    if (length > 0) {
+        munmap((void*)text, length);
+    }
+}
+
+// Функция для разбора целых чисел из диапазона [p, end) в out.
+// Возвращает количество прочитанных чисел или -1 при ошибке формата
+long parse_int_range(const char* p, const char* end, int* out) {
+    long count = 0;
+    while (1) {
+        while (p < end && is_separator(*p)) {
+            p++;
+        }
+        if (p == end) {
+            break;
+        }
+
+        int negative = (*p == '-');
+        if (*p == '-' || *p == '+') {
+            p++;
+        }
+        if (p == end || *p < '0' || *p > '9') {
+            return -1;
+        }
+
+        long long value = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            value = value * 10 + (*p - '0');
+            if (value > (long long)INT_MAX + 1) {
+                return -1;
+            }
+            p++;
+        }
+        if (p < end && !is_separator(*p)) {
+            return -1;
+        }
+
+        value = negative ? -value : value;
+        if (value > INT_MAX) {
+            return -1;
+        }
+        out[count++] = (int)value;
+    }
+    return count;
+}
+
+// Функция для параллельного разбора текста с целыми числами за один проход:
+// каждый поток разбирает свой диапазон во временный буфер, затем куски
+// склеиваются в общий массив по префиксной сумме количеств.
+// Возвращает NULL при ошибке формата
+int* parse_int_text_parallel(const char* text, size_t length, int* size) {
+#ifdef _OPENMP
+    int num_chunks = omp_get_max_threads();
+#else
+    int num_chunks = 1;
+#endif
+    size_t* bounds = (size_t*)malloc((num_chunks + 1) * sizeof(size_t));
+    long* counts = (long*)malloc(num_chunks * sizeof(long));
+    size_t* offsets = (size_t*)malloc(num_chunks * sizeof(size_t));
+    int** chunks = (int**)calloc(num_chunks, sizeof(int*));
+    if (!bounds || !counts || !offsets || !chunks) {
         perror("Ошибка выделения памяти");
-        fclose(file);
         exit(EXIT_FAILURE);
     }
-    
-    // Чтение чисел в массив
-    for (int i = 0; i < count; i++) {
-        if (fscanf(file, "%d", &arr[i]) != 1) {
-            fprintf(stderr, "Ошибка при чтении элемента %d\n", i);
-            free(arr);
-            fclose(file);
+
+    split_text_ranges(text, length, num_chunks, bounds);
+
+    // Разбор диапазонов: в диапазоне из L байт не больше L / 2 + 1 чисел
+    int failed = 0;
+    #pragma omp parallel for num_threads(num_chunks) schedule(static, 1) reduction(|:failed)
+    for (int c = 0; c < num_chunks; c++) {
+        size_t chunk_length = bounds[c + 1] - bounds[c];
+        chunks[c] = (int*)malloc((chunk_length / 2 + 1) * sizeof(int));
+        counts[c] = chunks[c] ? parse_int_range(text + bounds[c], text + bounds[c + 1], chunks[c]) : -1;
+        if (counts[c] < 0) {
+            failed = 1;
+        }
+    }
+
+    // Префиксная сумма количеств дает смещение каждого куска в итоговом массиве
+    size_t total = 0;
+    for (int c = 0; c < num_chunks && !failed; c++) {
+        offsets[c] = total;
+        total += (size_t)counts[c];
+    }
+
+    int* arr = NULL;
+    if (!failed && total <= INT_MAX) {
+        arr = (int*)malloc((total > 0 ? total : 1) * sizeof(int));
+        if (!arr) {
+            perror("Ошибка выделения памяти");
             exit(EXIT_FAILURE);
         }
+
+        // Склейка кусков в общий массив
+        #pragma omp parallel for num_threads(num_chunks) schedule(static, 1)
+        for (int c = 0; c < num_chunks; c++) {
+            memcpy(arr + offsets[c], chunks[c], (size_t)counts[c] * sizeof(int));
+        }
+        *size = (int)total;
+    }
+
+    for (int c = 0; c < num_chunks; c++) {
+        free(chunks[c]);
+    }
+    free(chunks);
+    free(offsets);
+    free(counts);
+    free(bounds);
+    return arr;
+}
+
+// Функция для чтения массива из текстового файла (параллельный разбор за один проход)
+int* read_array_from_file(const char* filename, int* size) {
+    size_t length;
+    const char* text = map_text_file(filename, &length);
+
+    int* arr = parse_int_text_parallel(text, length, size);
+    unmap_text_file(text, length);
+    if (!arr) {
+        fprintf(stderr, "Ошибка при чтении чисел из файла %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    return arr;
+}
+
+// Бинарный формат массива: заголовок ArrayFileHeader, затем сырые данные,
+// начинающиеся со смещения data_offset (кратного alignment)
+#define ARRAY_FILE_MAGIC "PCSARR01"
+#define ARRAY_FILE_INT32 1
+#define ARRAY_FILE_FLOAT64 2
+
+typedef struct {
+    char magic[8];          // Сигнатура ARRAY_FILE_MAGIC
+    uint32_t elem_type;     // Тип элементов (ARRAY_FILE_INT32 / ARRAY_FILE_FLOAT64)
+    uint32_t alignment;     // Выравнивание начала данных в байтах
+    uint64_t count;         // Количество элементов
+    uint64_t data_offset;   // Смещение данных от начала файла
+} ArrayFileHeader;
+
+// Отображение бинарного файла в память
+typedef struct {
+    void* base;             // Начало отображения (NULL, если массив прочитан из текста)
+    size_t length;          // Длина отображения в байтах
+} MappedArray;
+
+// Функция для отображения бинарного массива в память (без разбора и копирования).
+// Возвращает указатель на данные или NULL, если файла нет
+void* map_array_file(const char* filename, uint32_t elem_type, int* size, MappedArray* mapped) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ArrayFileHeader)) {
+        fprintf(stderr, "Ошибка: файл %s не является бинарным массивом\n", filename);
+        exit(EXIT_FAILURE);
+    }
+
+    // Закрытое отображение с правом записи: страницы копируются только при изменении
+    void* base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("Ошибка отображения файла в память");
+        exit(EXIT_FAILURE);
+    }
+
+    // Проверка заголовка
+    const ArrayFileHeader* header = (const ArrayFileHeader*)base;
+    size_t elem_size = (elem_type == ARRAY_FILE_INT32) ? sizeof(int32_t) : sizeof(double);
+    if (memcmp(header->magic, ARRAY_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->elem_type != elem_type ||
+        header->alignment == 0 || header->data_offset % header->alignment != 0 ||
+        header->count > INT_MAX ||
+        header->data_offset + header->count * elem_size > (uint64_t)st.st_size) {
+        fprintf(stderr, "Ошибка: некорректный заголовок бинарного массива %s\n", filename);
+        munmap(base, (size_t)st.st_size);
+        exit(EXIT_FAILURE);
+    }
+
+    // Данные читаются последовательно - подсказываем ядру упреждающее чтение
+    madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    mapped->base = base;
+    mapped->length = (size_t)st.st_size;
+    *size = (int)header->count;
+    return (char*)base + header->data_offset;
+}
+
+// Функция для загрузки массива: бинарный файл отображается в память,
+// при его отсутствии читается текстовый
+int* load_array(const char* bin_filename, const char* txt_filename, int* size, MappedArray* mapped) {
+    mapped->base = NULL;
+    mapped->length = 0;
+
+    int* arr = (int*)map_array_file(bin_filename, ARRAY_FILE_INT32, size, mapped);
+    if (!arr) {
+        arr = read_array_from_file(txt_filename, size);
     }
-    
-    fclose(file);
-    *size = count;
     return arr;
 }
 
+// Функция для освобождения массива, полученного через load_array
+void release_array(int* arr, MappedArray* mapped) {
+    if (mapped->base) {
+        munmap(mapped->base, mapped->length);
+    } else {
+        free(arr);
+    }
+}
+
 // Функция для проверки отсортированности массива
 bool is_sorted(const int* arr, int size) {
     for (int i = 0; i < size - 1; i++) {
@@ -71,32 +308,930 @@ void bubble_sort(int* arr, int size) {
             }
         }
         
-        // Если на текущей итерации не было перестановок, массив отсортирован
-        if (!swapped) {
+        // Если на текущей итерации не было перестановок, массив отсортирован
+        if (!swapped) {
+            break;
+        }
+    }
+}
+
+// Параметры поразрядной сортировки: разряд 8 бит, 4 прохода для int32
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_PASSES (32 / RADIX_BITS)
+
+// Размер буфера записи на корзину в элементах (одна строка кэша в 64 байта)
+#define RADIX_WC_SIZE 16
+
+// Функция для получения разряда ключа: знаковый бит инвертируется,
+// чтобы отрицательные числа оказались перед положительными
+static inline unsigned radix_digit(int value, int shift) {
+    return (((unsigned)value ^ 0x80000000u) >> shift) & (RADIX_BUCKETS - 1);
+}
+
+// Параллельная поразрядная сортировка LSD для массива int32.
+// На каждом проходе потоки строят гистограммы своих диапазонов, префиксная сумма
+// по (разряд, поток) дает каждому потоку места для записи, а запись идет через
+// буферы размером в строку кэша на каждую корзину. Проходы, в которых все ключи
+// попадают в одну корзину, пропускаются. Возвращает 0 при ошибке выделения памяти
+int radix_sort_parallel(int arr[], int size, int num_threads) {
+    int* buffer = (int*)malloc((size > 0 ? size : 1) * sizeof(int));
+    int* counts = (int*)malloc((size_t)num_threads * RADIX_BUCKETS * sizeof(int));
+    if (!buffer || !counts) {
+        free(buffer);
+        free(counts);
+        return 0;
+    }
+    
+    int* src = arr;
+    int* dst = buffer;
+    int failed = 0;
+    
+    #pragma omp parallel num_threads(num_threads)
+    {
+#ifdef _OPENMP
+        int tid = omp_get_thread_num();
+        int nthreads = omp_get_num_threads();
+#else
+        int tid = 0;
+        int nthreads = 1;
+#endif
+        int begin = (int)((long)size * tid / nthreads);
+        int end = (int)((long)size * (tid + 1) / nthreads);
+        int* my_counts = counts + (size_t)tid * RADIX_BUCKETS;
+        
+        // Буферы записи потока: RADIX_WC_SIZE элементов на корзину
+        int* wc = NULL;
+        if (posix_memalign((void**)&wc, 64, RADIX_BUCKETS * RADIX_WC_SIZE * sizeof(int)) != 0) {
+            wc = NULL;
+            #pragma omp atomic write
+            failed = 1;
+        }
+        int fill[RADIX_BUCKETS];
+        int pos[RADIX_BUCKETS];
+        #pragma omp barrier
+        
+        for (int pass = 0; pass < RADIX_PASSES && !failed; pass++) {
+            int shift = pass * RADIX_BITS;
+            
+            // Гистограмма разрядов своего диапазона
+            memset(my_counts, 0, RADIX_BUCKETS * sizeof(int));
+            for (int i = begin; i < end; i++) {
+                my_counts[radix_digit(src[i], shift)]++;
+            }
+            #pragma omp barrier
+            
+            // Проход не нужен, если все ключи имеют одинаковый разряд
+            int skip = 0;
+            for (int d = 0; d < RADIX_BUCKETS && !skip; d++) {
+                int total = 0;
+                for (int t = 0; t < nthreads; t++) {
+                    total += counts[t * RADIX_BUCKETS + d];
+                }
+                skip = (total == size);
+            }
+            
+            if (!skip) {
+                // Префиксная сумма в порядке (разряд, поток) - позиции записи потока
+                int offset = 0;
+                for (int d = 0; d < RADIX_BUCKETS; d++) {
+                    for (int t = 0; t < nthreads; t++) {
+                        if (t == tid) {
+                            pos[d] = offset;
+                        }
+                        offset += counts[t * RADIX_BUCKETS + d];
+                    }
+                    fill[d] = 0;
+                }
+                
+                // Распределение по корзинам через буферы записи
+                for (int i = begin; i < end; i++) {
+                    int value = src[i];
+                    unsigned d = radix_digit(value, shift);
+                    int* slot = wc + d * RADIX_WC_SIZE;
+                    slot[fill[d]++] = value;
+                    if (fill[d] == RADIX_WC_SIZE) {
+                        memcpy(dst + pos[d], slot, RADIX_WC_SIZE * sizeof(int));
+                        pos[d] += RADIX_WC_SIZE;
+                        fill[d] = 0;
+                    }
+                }
+                for (int d = 0; d < RADIX_BUCKETS; d++) {
+                    memcpy(dst + pos[d], wc + d * RADIX_WC_SIZE, fill[d] * sizeof(int));
+                }
+            }
+            
+            // Все потоки дочитали гистограммы и дописали свои части
+            #pragma omp barrier
+            if (!skip) {
+                #pragma omp single
+                {
+                    int* tmp = src;
+                    src = dst;
+                    dst = tmp;
+                }
+            }
+        }
+        
+        free(wc);
+    }
+    
+    // После нечетного числа выполненных проходов результат находится в буфере
+    if (!failed && src != arr) {
+        memcpy(arr, src, size * sizeof(int));
+    }
+    
+    free(buffer);
+    free(counts);
+    return !failed;
+}
+
+// Сортировка подсчетом используется, если диапазон значений (max - min + 1), умноженный
+// на число потоков, не превышает размер массива: счетчики тогда занимают не больше
+// памяти, чем сам массив, а сортировка выполняется за O(n + k)
+
+// Функция для параллельной сортировки подсчетом. Сначала параллельно ищутся минимум
+// и максимум; если диапазон мал, потоки считают значения своих частей, счетчики
+// сливаются, а выходной массив заполняется параллельно равными по длине участками.
+// Возвращает 1, если массив отсортирован, и 0, если диапазон для нее слишком велик
+int counting_sort_parallel(int arr[], int size, int num_threads) {
+    if (size < 2) {
+        return 1;
+    }
+    
+    int min_value = arr[0], max_value = arr[0];
+    #pragma omp parallel for num_threads(num_threads) reduction(min:min_value) reduction(max:max_value)
+    for (int i = 0; i < size; i++) {
+        if (arr[i] < min_value) min_value = arr[i];
+        if (arr[i] > max_value) max_value = arr[i];
+    }
+    
+    long range = (long)max_value - min_value + 1;
+    if (range * num_threads > size) {
+        return 0;
+    }
+    
+    int k = (int)range;
+    int* counts = (int*)calloc((size_t)num_threads * k, sizeof(int));
+    int* starts = (int*)malloc((k + 1) * sizeof(int));
+    if (!counts || !starts) {
+        free(counts);
+        free(starts);
+        return 0;
+    }
+    
+    #pragma omp parallel num_threads(num_threads)
+    {
+#ifdef _OPENMP
+        int tid = omp_get_thread_num();
+        int nthreads = omp_get_num_threads();
+#else
+        int tid = 0;
+        int nthreads = 1;
+#endif
+        // Подсчет значений своей части массива
+        int* my_counts = counts + (size_t)tid * k;
+        int begin = (int)((long)size * tid / nthreads);
+        int end = (int)((long)size * (tid + 1) / nthreads);
+        for (int i = begin; i < end; i++) {
+            my_counts[arr[i] - min_value]++;
+        }
+        #pragma omp barrier
+        
+        // Слияние счетчиков потоков (по диапазонам значений)
+        #pragma omp for schedule(static)
+        for (int v = 0; v < k; v++) {
+            int total = 0;
+            for (int t = 0; t < nthreads; t++) {
+                total += counts[(size_t)t * k + v];
+            }
+            counts[v] = total;
+        }
+        
+        // Префиксная сумма: starts[v] - позиция первого элемента со значением min + v
+        #pragma omp single
+        {
+            starts[0] = 0;
+            for (int v = 0; v < k; v++) {
+                starts[v + 1] = starts[v] + counts[v];
+            }
+        }
+        
+        // Заполнение своего участка выходного массива: начальное значение
+        // находится двоичным поиском по префиксным суммам
+        int lo = 0, hi = k - 1;
+        while (lo < hi) {
+            int mid = (lo + hi + 1) / 2;
+            if (starts[mid] <= begin) {
+                lo = mid;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        for (int i = begin, v = lo; i < end; v++) {
+            int stop = (starts[v + 1] < end) ? starts[v + 1] : end;
+            for (; i < stop; i++) {
+                arr[i] = min_value + v;
+            }
+        }
+    }
+    
+    free(counts);
+    free(starts);
+    return 1;
+}
+
+// Размер порции (в элементах) при пересылке участка между процессами в слиянии по дереву
+#define MERGE_CHUNK 16384
+
+// Функция для приема участка от процесса source и слияния его с участком mine.
+// Участок передается порциями через неблокирующие операции: пока очередные порции
+// еще в пути, уже принятая часть сливается с mine. Результат записывается в out
+void receive_and_merge(const int* mine, int mine_size, int* incoming, int incoming_size,
+                       int source, int* out) {
+    int num_chunks = (incoming_size + MERGE_CHUNK - 1) / MERGE_CHUNK;
+    MPI_Request* requests = (MPI_Request*)malloc((num_chunks > 0 ? num_chunks : 1) * sizeof(MPI_Request));
+    for (int c = 0; c < num_chunks; c++) {
+        int count = (c == num_chunks - 1) ? incoming_size - c * MERGE_CHUNK : MERGE_CHUNK;
+        MPI_Irecv(incoming + c * MERGE_CHUNK, count, MPI_INT, source, 1,
+                 MPI_COMM_WORLD, &requests[c]);
+    }
+    
+    int i = 0, j = 0, k = 0;
+    for (int c = 0; c < num_chunks; c++) {
+        MPI_Wait(&requests[c], MPI_STATUS_IGNORE);
+        int available = (c == num_chunks - 1) ? incoming_size : (c + 1) * MERGE_CHUNK;
+        
+        // Сливаем, пока есть принятые элементы входящего участка
+        while (j < available) {
+            if (i < mine_size && mine[i] <= incoming[j]) {
+                out[k++] = mine[i++];
+            } else {
+                out[k++] = incoming[j++];
+            }
+        }
+    }
+    
+    // Остаток своего участка
+    memcpy(out + k, mine + i, (mine_size - i) * sizeof(int));
+    free(requests);
+}
+
+// Функция для отправки участка процессу dest: сначала размер, затем порции
+// неблокирующими операциями (их прием перекрывается со слиянием у получателя).
+// Порции идут с одним тегом: MPI сохраняет порядок сообщений между парой процессов
+void send_run(const int* run, int run_size, int dest) {
+    MPI_Send(&run_size, 1, MPI_INT, dest, 0, MPI_COMM_WORLD);
+    int num_chunks = (run_size + MERGE_CHUNK - 1) / MERGE_CHUNK;
+    MPI_Request* requests = (MPI_Request*)malloc((num_chunks > 0 ? num_chunks : 1) * sizeof(MPI_Request));
+    for (int c = 0; c < num_chunks; c++) {
+        int count = (c == num_chunks - 1) ? run_size - c * MERGE_CHUNK : MERGE_CHUNK;
+        MPI_Isend(run + c * MERGE_CHUNK, count, MPI_INT, dest, 1,
+                 MPI_COMM_WORLD, &requests[c]);
+    }
+    MPI_Waitall(num_chunks, requests, MPI_STATUSES_IGNORE);
+    free(requests);
+}
+
+// Функция для слияния отсортированных частей по двоичному дереву процессов за
+// log2(proc_size) раундов. В раунде со сдвигом step процесс rank (кратный step)
+// при rank % (2 * step) == step отправляет свой участок процессу rank - step и выходит,
+// а получатель сливает его со своим; пары в одном раунде работают параллельно.
+// Процесс 0 выполняет только последнее слияние и записывает результат в result
+void tree_merge(int* local_array, int local_size, int rank, int proc_size, int* result) {
+    int* run = local_array;
+    int run_size = local_size;
+    
+    for (int step = 1; step < proc_size; step *= 2) {
+        if (rank % (2 * step) == step) {
+            send_run(run, run_size, rank - step);
+            break;
+        }
+        if (rank % (2 * step) == 0 && rank + step < proc_size) {
+            int incoming_size;
+            MPI_Recv(&incoming_size, 1, MPI_INT, rank + step, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            
+            // На последнем раунде процесс 0 пишет сразу в итоговый массив
+            bool last_round = (rank == 0 && 2 * step >= proc_size);
+            int* incoming = (int*)malloc((incoming_size > 0 ? incoming_size : 1) * sizeof(int));
+            int* merged = last_round ? result
+                                     : (int*)malloc((run_size + incoming_size) * sizeof(int));
+            if (!incoming || !merged) {
+                fprintf(stderr, "Ошибка выделения памяти для слияния\n");
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            
+            receive_and_merge(run, run_size, incoming, incoming_size, rank + step, merged);
+            free(incoming);
+            if (run != local_array) {
+                free(run);
+            }
+            run = merged;
+            run_size += incoming_size;
+        }
+    }
+    
+    // Единственный процесс: результат - его собственная часть
+    if (rank == 0 && run != result) {
+        memcpy(result, run, run_size * sizeof(int));
+    }
+    if (run != local_array && run != result) {
+        free(run);
+    }
+}
+
+// Функция для поиска первого элемента отсортированного массива, большего value
+int upper_bound(const int* arr, int size, int value) {
+    int lo = 0, hi = size;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (arr[mid] <= value) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static int compare_ints(const void* a, const void* b) {
+    int x = *(const int*)a;
+    int y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+// Турнирное дерево проигравших для k-путевого слияния. Листья - текущие элементы
+// участков, во внутренних узлах tree[1..k-1] хранятся проигравшие, в tree[0] - победитель.
+// После извлечения победителя пересчитывается только путь от его листа к корню (log2 k)
+typedef struct {
+    int k;
+    int* tree;
+    const int** cur;
+    const int** end;
+} LoserTree;
+
+// Функция сравнения участков a и b: true, если текущий элемент a идет раньше.
+// Исчерпанный участок всегда проигрывает, при равенстве побеждает участок с меньшим номером
+static inline bool loser_tree_beats(const LoserTree* lt, int a, int b) {
+    if (lt->cur[a] == lt->end[a]) return false;
+    if (lt->cur[b] == lt->end[b]) return true;
+    int x = *lt->cur[a];
+    int y = *lt->cur[b];
+    return x < y || (x == y && a < b);
+}
+
+// Функция для построения поддерева с корнем node; возвращает победителя поддерева
+int loser_tree_build(LoserTree* lt, int node) {
+    if (node >= lt->k) {
+        return node - lt->k;
+    }
+    int left = loser_tree_build(lt, 2 * node);
+    int right = loser_tree_build(lt, 2 * node + 1);
+    if (loser_tree_beats(lt, left, right)) {
+        lt->tree[node] = right;
+        return left;
+    }
+    lt->tree[node] = left;
+    return right;
+}
+
+// Функция для слияния k отсортированных участков [begins[r], ends[r]) в out за один проход.
+// Вызывается из потоков OpenMP, поэтому при нехватке памяти не завершает MPI,
+// а возвращает false
+bool loser_tree_merge(const int** begins, const int** ends, int k, int* out, int total) {
+    if (total <= 0) {
+        return true;
+    }
+    LoserTree lt;
+    lt.k = k;
+    lt.tree = (int*)malloc(k * sizeof(int));
+    lt.cur = (const int**)malloc(k * sizeof(int*));
+    lt.end = (const int**)malloc(k * sizeof(int*));
+    if (!lt.tree || !lt.cur || !lt.end) {
+        free(lt.tree);
+        free(lt.cur);
+        free(lt.end);
+        return false;
+    }
+    memcpy(lt.cur, begins, k * sizeof(int*));
+    memcpy(lt.end, ends, k * sizeof(int*));
+    lt.tree[0] = loser_tree_build(&lt, 1);
+    
+    for (int i = 0; i < total; i++) {
+        int winner = lt.tree[0];
+        out[i] = *lt.cur[winner]++;
+        
+        // Новый элемент участка winner проходит матчи до корня
+        for (int node = (winner + k) / 2; node >= 1; node /= 2) {
+            if (loser_tree_beats(&lt, lt.tree[node], winner)) {
+                int tmp = lt.tree[node];
+                lt.tree[node] = winner;
+                winner = tmp;
+            }
+        }
+        lt.tree[0] = winner;
+    }
+    
+    free(lt.tree);
+    free(lt.cur);
+    free(lt.end);
+    return true;
+}
+
+// Функция для поиска первого элемента отсортированного массива, не меньшего value
+int lower_bound(const int* arr, int size, int value) {
+    int lo = 0, hi = size;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (arr[mid] < value) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Функция для разбиения k отсортированных участков по позиции rank выходного массива
+// (merge path для k участков): splits[r] - сколько элементов участка r попадает в первые
+// rank элементов результата. Граничное значение ищется двоичным поиском по значениям,
+// равные ему элементы берутся из участков с меньшими номерами, как и в дереве слияния
+void multiway_split(const int* data, const int* run_displs, int k, int rank, int* splits) {
+    long lo = INT_MAX, hi = INT_MIN;
+    for (int r = 0; r < k; r++) {
+        int size = run_displs[r + 1] - run_displs[r];
+        if (size > 0) {
+            if (data[run_displs[r]] < lo) lo = data[run_displs[r]];
+            if (data[run_displs[r + 1] - 1] > hi) hi = data[run_displs[r + 1] - 1];
+        }
+    }
+    if (rank <= 0 || lo > hi) {
+        memset(splits, 0, k * sizeof(int));
+        return;
+    }
+    
+    // Наименьшее значение v, для которого элементов <= v не меньше rank
+    while (lo < hi) {
+        long mid = lo + (hi - lo) / 2;
+        long count = 0;
+        for (int r = 0; r < k; r++) {
+            count += upper_bound(data + run_displs[r], run_displs[r + 1] - run_displs[r], (int)mid);
+        }
+        if (count >= rank) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    
+    // Все элементы < v, затем недостающие равные v по порядку участков
+    int value = (int)lo;
+    long need = rank;
+    for (int r = 0; r < k; r++) {
+        splits[r] = lower_bound(data + run_displs[r], run_displs[r + 1] - run_displs[r], value);
+        need -= splits[r];
+    }
+    for (int r = 0; r < k && need > 0; r++) {
+        int equal_end = upper_bound(data + run_displs[r], run_displs[r + 1] - run_displs[r], value);
+        int take = (equal_end - splits[r] < need) ? equal_end - splits[r] : (int)need;
+        splits[r] += take;
+        need -= take;
+    }
+}
+
+// Функция для k-путевого слияния соседних отсортированных участков массива data
+// (участок r - data[run_displs[r] .. run_displs[r + 1] - 1]) в out. При нескольких
+// потоках выходной массив делится на равные диапазоны, границы которых в участках
+// находятся через multiway_split, и каждый поток сливает свой диапазон деревом проигравших.
+// Ошибки выделения памяти в потоках собираются в флаг, и MPI_Abort вызывает главный поток
+// (уровень MPI_THREAD_FUNNELED)
+void kway_merge_parallel(const int* data, const int* run_displs, int k, int* out, int num_threads) {
+    int total = run_displs[k];
+    if (total < num_threads * MERGE_CHUNK) {
+        num_threads = 1;
+    }
+    
+    int failed = 0;
+    #pragma omp parallel num_threads(num_threads) reduction(|:failed)
+    {
+#ifdef _OPENMP
+        int tid = omp_get_thread_num();
+        int nthreads = omp_get_num_threads();
+#else
+        int tid = 0;
+        int nthreads = 1;
+#endif
+        int out_begin = (int)((long)total * tid / nthreads);
+        int out_end = (int)((long)total * (tid + 1) / nthreads);
+        
+        int* split_begin = (int*)malloc(2 * k * sizeof(int));
+        const int** begins = (const int**)malloc(2 * k * sizeof(int*));
+        if (!split_begin || !begins) {
+            failed = 1;
+        } else {
+            int* split_end = split_begin + k;
+            const int** ends = begins + k;
+            
+            multiway_split(data, run_displs, k, out_begin, split_begin);
+            multiway_split(data, run_displs, k, out_end, split_end);
+            for (int r = 0; r < k; r++) {
+                begins[r] = data + run_displs[r] + split_begin[r];
+                ends[r] = data + run_displs[r] + split_end[r];
+            }
+            if (!loser_tree_merge(begins, ends, k, out + out_begin, out_end - out_begin)) {
+                failed = 1;
+            }
+        }
+        
+        free(split_begin);
+        free(begins);
+    }
+    
+    if (failed) {
+        fprintf(stderr, "Ошибка выделения памяти для k-путевого слияния\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+}
+
+// Функция для распределенной сортировки выборкой (PSRS) уже отсортированных
+// локальных частей. Каждый процесс берет proc_size регулярных образцов, процесс 0
+// выбирает по ним proc_size - 1 разделителей и рассылает их, части по разделителям
+// обмениваются через MPI_Alltoallv, а принятые proc_size отсортированных участков
+// сливаются локально за один проход деревом проигравших на num_threads потоках.
+// Возвращает новую локальную часть (процесс r получает r-ю корзину значений),
+// ее размер записывается в result_size
+int* sample_sort(int* local_array, int local_size, int* result_size, int rank, int proc_size,
+                 int num_threads, double* exchange_time, double* merge_time) {
+    double exchange_start = MPI_Wtime();
+    
+    // Регулярная выборка: proc_size образцов из отсортированной локальной части
+    int num_samples = (local_size < proc_size) ? local_size : proc_size;
+    int* samples = (int*)malloc((proc_size > 0 ? proc_size : 1) * sizeof(int));
+    for (int i = 0; i < num_samples; i++) {
+        samples[i] = local_array[(long)i * local_size / num_samples];
+    }
+    
+    int* sample_counts = NULL;
+    int* sample_displs = NULL;
+    int* all_samples = NULL;
+    int total_samples = 0;
+    if (rank == 0) {
+        sample_counts = (int*)malloc(proc_size * sizeof(int));
+        sample_displs = (int*)malloc(proc_size * sizeof(int));
+    }
+    MPI_Gather(&num_samples, 1, MPI_INT, sample_counts, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (rank == 0) {
+        for (int i = 0; i < proc_size; i++) {
+            sample_displs[i] = total_samples;
+            total_samples += sample_counts[i];
+        }
+        all_samples = (int*)malloc((total_samples > 0 ? total_samples : 1) * sizeof(int));
+    }
+    MPI_Gatherv(samples, num_samples, MPI_INT,
+               all_samples, sample_counts, sample_displs, MPI_INT,
+               0, MPI_COMM_WORLD);
+    
+    // Процесс 0 сортирует образцы и выбирает разделители с равным шагом
+    int* splitters = (int*)malloc((proc_size > 1 ? proc_size - 1 : 1) * sizeof(int));
+    if (rank == 0) {
+        qsort(all_samples, total_samples, sizeof(int), compare_ints);
+        for (int i = 1; i < proc_size; i++) {
+            // При отсутствии образцов (пустой массив) разделители не важны
+            splitters[i - 1] = (total_samples > 0) ? all_samples[(long)i * total_samples / proc_size] : 0;
+        }
+    }
+    MPI_Bcast(splitters, proc_size - 1, MPI_INT, 0, MPI_COMM_WORLD);
+    
+    // Границы корзин в локальной части: в корзину i идут значения из (splitter[i-1], splitter[i]]
+    int* send_counts = (int*)malloc(proc_size * sizeof(int));
+    int* send_displs = (int*)malloc(proc_size * sizeof(int));
+    int* recv_counts = (int*)malloc(proc_size * sizeof(int));
+    int* recv_displs = (int*)malloc((proc_size + 1) * sizeof(int));
+    int prev = 0;
+    for (int i = 0; i < proc_size; i++) {
+        int next = (i < proc_size - 1) ? upper_bound(local_array, local_size, splitters[i]) : local_size;
+        send_displs[i] = prev;
+        send_counts[i] = next - prev;
+        prev = next;
+    }
+    
+    MPI_Alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT, MPI_COMM_WORLD);
+    recv_displs[0] = 0;
+    for (int i = 0; i < proc_size; i++) {
+        recv_displs[i + 1] = recv_displs[i] + recv_counts[i];
+    }
+    int total = recv_displs[proc_size];
+    
+    int* received = (int*)malloc((total > 0 ? total : 1) * sizeof(int));
+    int* result = (int*)malloc((total > 0 ? total : 1) * sizeof(int));
+    if (!received || !result) {
+        fprintf(stderr, "Ошибка выделения памяти для обмена корзинами\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_Alltoallv(local_array, send_counts, send_displs, MPI_INT,
+                 received, recv_counts, recv_displs, MPI_INT,
+                 MPI_COMM_WORLD);
+    *exchange_time = MPI_Wtime() - exchange_start;
+    
+    // Слияние принятых отсортированных участков
+    double merge_start = MPI_Wtime();
+    kway_merge_parallel(received, recv_displs, proc_size, result, num_threads);
+    free(received);
+    *merge_time = MPI_Wtime() - merge_start;
+    
+    *result_size = total;
+    free(samples);
+    free(sample_counts);
+    free(sample_displs);
+    free(all_samples);
+    free(splitters);
+    free(send_counts);
+    free(send_displs);
+    free(recv_counts);
+    free(recv_displs);
+    return result;
+}
+
+// Функция для сортировки чет-нечетными перестановками блоков. Локальные части уже
+// отсортированы; за proc_size фаз соседние процессы (пары (0,1), (2,3), ... в четных
+// фазах и (1,2), (3,4), ... в нечетных) обмениваются блоками через MPI_Sendrecv,
+// после чего процесс с меньшим номером оставляет себе наименьшие local_size элементов
+// объединения, а с большим - наибольшие. Буферы приема и слияния выделяются один раз,
+// локальный блок и буфер слияния меняются местами после каждой фазы.
+// Возвращает указатель на массив с результатом (local_array или новый буфер)
+int* odd_even_sort(int* local_array, const int* block_sizes, int rank, int proc_size,
+                   double* exchange_time, double* merge_time) {
+    int local_size = block_sizes[rank];
+    int max_size = 0;
+    for (int i = 0; i < proc_size; i++) {
+        if (block_sizes[i] > max_size) {
+            max_size = block_sizes[i];
+        }
+    }
+    
+    int* recv_buf = (int*)malloc((max_size > 0 ? max_size : 1) * sizeof(int));
+    int* merge_buf = (int*)malloc((local_size > 0 ? local_size : 1) * sizeof(int));
+    if (!recv_buf || !merge_buf) {
+        fprintf(stderr, "Ошибка выделения памяти для буферов обмена\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    
+    int* block = local_array;
+    *exchange_time = 0;
+    *merge_time = 0;
+    
+    for (int phase = 0; phase < proc_size; phase++) {
+        int partner = (phase % 2 == rank % 2) ? rank + 1 : rank - 1;
+        if (partner < 0 || partner >= proc_size) {
+            continue;
+        }
+        int partner_size = block_sizes[partner];
+        
+        double exchange_start = MPI_Wtime();
+        MPI_Sendrecv(block, local_size, MPI_INT, partner, phase,
+                    recv_buf, partner_size, MPI_INT, partner, phase,
+                    MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        *exchange_time += MPI_Wtime() - exchange_start;
+        
+        if (local_size == 0 || partner_size == 0) {
+            continue;
+        }
+        
+        double merge_start = MPI_Wtime();
+        if (rank < partner) {
+            // Блоки уже упорядочены - менять нечего
+            if (block[local_size - 1] <= recv_buf[0]) {
+                *merge_time += MPI_Wtime() - merge_start;
+                continue;
+            }
+            // Оставляем наименьшие local_size элементов: слияние с начала
+            int i = 0, j = 0;
+            for (int k = 0; k < local_size; k++) {
+                if (j >= partner_size || (i < local_size && block[i] <= recv_buf[j])) {
+                    merge_buf[k] = block[i++];
+                } else {
+                    merge_buf[k] = recv_buf[j++];
+                }
+            }
+        } else {
+            if (recv_buf[partner_size - 1] <= block[0]) {
+                *merge_time += MPI_Wtime() - merge_start;
+                continue;
+            }
+            // Оставляем наибольшие local_size элементов: слияние с конца
+            int i = local_size - 1, j = partner_size - 1;
+            for (int k = local_size - 1; k >= 0; k--) {
+                if (j < 0 || (i >= 0 && block[i] > recv_buf[j])) {
+                    merge_buf[k] = block[i--];
+                } else {
+                    merge_buf[k] = recv_buf[j--];
+                }
+            }
+        }
+        
+        int* tmp = block;
+        block = merge_buf;
+        merge_buf = tmp;
+        *merge_time += MPI_Wtime() - merge_start;
+    }
+    
+    free(recv_buf);
+    if (block != local_array) {
+        // Результат в бывшем буфере слияния, а исходный блок больше не нужен
+        free(local_array);
+    } else {
+        free(merge_buf);
+    }
+    return block;
+}
+
+// Функция трехпутевого разделения arr[low..high] относительно значения pivot:
+// arr[low..*lt-1] < pivot, arr[*lt..*gt] == pivot, arr[*gt+1..high] > pivot
+void partition3_value(int arr[], int low, int high, int pivot, int* lt, int* gt) {
+    int l = low, i = low, g = high;
+    while (i <= g) {
+        if (arr[i] < pivot) {
+            int tmp = arr[l]; arr[l++] = arr[i]; arr[i++] = tmp;
+        } else if (arr[i] > pivot) {
+            int tmp = arr[g]; arr[g--] = arr[i]; arr[i] = tmp;
+        } else {
+            i++;
+        }
+    }
+    *lt = l;
+    *gt = g;
+}
+
+// Функция для выбора k-го по порядку элемента локального подмассива arr[low..high]
+// (опорный элемент - медиана трех)
+int quickselect_local(int arr[], int low, int high, int k) {
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        int a = arr[low], b = arr[mid], c = arr[high];
+        int pivot = (a < b) ? ((b < c) ? b : (a < c ? c : a)) : ((a < c) ? a : (b < c ? c : b));
+        int lt, gt;
+        partition3_value(arr, low, high, pivot, &lt, &gt);
+        if (k < lt) {
+            high = lt - 1;
+        } else if (k > gt) {
+            low = gt + 1;
+        } else {
+            break;
+        }
+    }
+    return arr[k];
+}
+
+// Локальная медиана процесса и число активных элементов (ее вес)
+typedef struct {
+    int median;
+    int weight;
+} WeightedMedian;
+
+// Функция для сравнения медиан процессов (для qsort)
+static int compare_weighted_medians(const void* a, const void* b) {
+    int x = ((const WeightedMedian*)a)->median;
+    int y = ((const WeightedMedian*)b)->median;
+    return (x > y) - (x < y);
+}
+
+// Когда активных элементов остается меньше, они собираются на процессе 0
+#define SELECT_GATHER_CUTOFF (1 << 14)
+
+// Функция для распределенного выбора k-го по порядку элемента без сортировки.
+// На каждом шаге опорный элемент - взвешенная медиана локальных медиан процессов
+// (вес - число активных элементов), что отбрасывает не меньше четверти активных
+// элементов. Локальные части переставляются. Результат возвращается на всех процессах
+int distributed_select(int* local_array, int local_size, long long k, int rank, int proc_size,
+                       int* rounds) {
+    WeightedMedian* medians = (WeightedMedian*)malloc(proc_size * sizeof(WeightedMedian));
+    int* counts = (int*)malloc(proc_size * sizeof(int));
+    int* displs = (int*)malloc(proc_size * sizeof(int));
+    if (!medians || !counts || !displs) {
+        fprintf(stderr, "Ошибка выделения памяти для распределенного выбора\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    
+    // Активная часть локального массива: [low, high)
+    int low = 0, high = local_size;
+    int result = 0;
+    *rounds = 0;
+    while (1) {
+        long long active = high - low, total_active;
+        MPI_Allreduce(&active, &total_active, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+        
+        // Остаток собирается на процессе 0 и выбирается последовательно
+        if (total_active <= SELECT_GATHER_CUTOFF) {
+            int count = (int)active;
+            MPI_Gather(&count, 1, MPI_INT, counts, 1, MPI_INT, 0, MPI_COMM_WORLD);
+            int* rest = NULL;
+            if (rank == 0) {
+                for (int i = 0, pos = 0; i < proc_size; i++) {
+                    displs[i] = pos;
+                    pos += counts[i];
+                }
+                rest = (int*)malloc(total_active * sizeof(int));
+                if (!rest) {
+                    fprintf(stderr, "Ошибка выделения памяти для распределенного выбора\n");
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+            }
+            MPI_Gatherv(local_array + low, count, MPI_INT, rest, counts, displs, MPI_INT,
+                        0, MPI_COMM_WORLD);
+            if (rank == 0) {
+                result = quickselect_local(rest, 0, (int)total_active - 1, (int)k);
+                free(rest);
+            }
+            MPI_Bcast(&result, 1, MPI_INT, 0, MPI_COMM_WORLD);
+            break;
+        }
+        (*rounds)++;
+        
+        // Взвешенная медиана локальных медиан (одинаково вычисляется на всех процессах)
+        WeightedMedian mine = {0, (int)active};
+        if (active > 0) {
+            mine.median = quickselect_local(local_array, low, high - 1, low + (int)(active - 1) / 2);
+        }
+        MPI_Allgather(&mine, 2, MPI_INT, medians, 2, MPI_INT, MPI_COMM_WORLD);
+        qsort(medians, proc_size, sizeof(WeightedMedian), compare_weighted_medians);
+        int pivot = 0;
+        long long cumulative = 0;
+        for (int i = 0; i < proc_size; i++) {
+            cumulative += medians[i].weight;
+            if (medians[i].weight > 0 && 2 * cumulative >= total_active) {
+                pivot = medians[i].median;
+                break;
+            }
+        }
+        
+        // Разделение активной части и глобальные размеры частей
+        int lt = low, gt = high - 1;
+        if (active > 0) {
+            partition3_value(local_array, low, high - 1, pivot, &lt, &gt);
+        }
+        long long local_counts[2] = {lt - low, gt - lt + 1};
+        long long global_counts[2];
+        MPI_Allreduce(local_counts, global_counts, 2, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+        
+        if (k < global_counts[0]) {
+            high = lt;
+        } else if (k < global_counts[0] + global_counts[1]) {
+            result = pivot;
             break;
+        } else {
+            k -= global_counts[0] + global_counts[1];
+            low = gt + 1;
         }
     }
+    
+    free(medians);
+    free(counts);
+    free(displs);
+    return result;
 }
 
-// Функция для слияния двух отсортированных массивов
-void merge_arrays(int* arr1, int size1, int* arr2, int size2, int* result) {
-    int i = 0, j = 0, k = 0;
-    
-    while (i < size1 && j < size2) {
-        if (arr1[i] <= arr2[j]) {
-            result[k++] = arr1[i++];
-        } else {
-            result[k++] = arr2[j++];
+// Функция для разбора запроса квантиля: median или p<процент> (например p99 или p99.9).
+// Возвращает долю 0..1 или -1, если аргумент не является запросом квантиля
+double parse_quantile_arg(const char* arg) {
+    if (strcmp(arg, "median") == 0) {
+        return 0.5;
+    }
+    if (arg[0] == 'p' && arg[1] != '\0') {
+        char* end;
+        double p = strtod(arg + 1, &end) / 100.0;
+        if (*end == '\0' && p >= 0.0 && p <= 1.0) {
+            return p;
         }
     }
+    return -1.0;
+}
+
+// Функция для проверки отсортированности массива, распределенного по процессам:
+// каждая часть отсортирована и последний элемент каждой непустой части не больше
+// первого элемента следующей непустой части. Результат одинаков на всех процессах
+bool is_sorted_distributed(const int* local_array, int local_size, int proc_size) {
+    int info[3] = {local_size > 0, local_size > 0 ? local_array[0] : 0,
+                   local_size > 0 ? local_array[local_size - 1] : 0};
+    int* all_info = (int*)malloc(3 * proc_size * sizeof(int));
+    MPI_Allgather(info, 3, MPI_INT, all_info, 3, MPI_INT, MPI_COMM_WORLD);
     
-    while (i < size1) {
-        result[k++] = arr1[i++];
+    int ok = is_sorted(local_array, local_size);
+    int has_prev = 0, prev_last = 0;
+    for (int i = 0; i < proc_size; i++) {
+        if (!all_info[3 * i]) {
+            continue;
+        }
+        if (has_prev && prev_last > all_info[3 * i + 1]) {
+            ok = 0;
+        }
+        has_prev = 1;
+        prev_last = all_info[3 * i + 2];
     }
+    free(all_info);
     
-    while (j < size2) {
-        result[k++] = arr2[j++];
-    }
+    int all_ok;
+    MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+    return all_ok;
 }
 
 // Функция для вывода первых и последних 5 элементов массива
@@ -126,28 +1261,768 @@ void print_array_sample(const int* arr, int size, const char* label, int rank) {
     printf("]\n");
 }
 
+// Максимальное число квантилей в одном запуске
+#define MAX_QUANTILES 16
+
+// Схемы объединения отсортированных локальных частей
+typedef enum {
+    SCHEME_PSRS,
+    SCHEME_TREE_MERGE,
+    SCHEME_KWAY_MERGE,
+    SCHEME_ODD_EVEN
+} SortScheme;
+
+// Функция для сортировки локальной части выбранным алгоритмом.
+// Если алгоритм не указан явно (allow_counting) и диапазон значений мал, часть
+// сортируется подсчетом за O(n + k). Возвращает 1, если использована сортировка подсчетом
+int sort_local_part(int* local_array, int local_size, bool use_radix, bool allow_counting,
+                    int num_threads) {
+    if (allow_counting && counting_sort_parallel(local_array, local_size, num_threads)) {
+        return 1;
+    }
+    if (use_radix) {
+        if (!radix_sort_parallel(local_array, local_size, num_threads)) {
+            fprintf(stderr, "Ошибка выделения памяти для поразрядной сортировки\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    } else {
+        bubble_sort(local_array, local_size);
+    }
+    return 0;
+}
+
+// Параметры внешней сортировки: бюджет памяти процесса по умолчанию и минимальный (в МБ)
+// и минимальный блок слияния (в элементах)
+#define EXTERNAL_DEFAULT_BUDGET_MB 256
+#define EXTERNAL_MIN_BUDGET_MB 16
+#define EXTERNAL_MIN_MERGE_BLOCK (1 << 14)
+#define EXTERNAL_OUTPUT_FILE "sorted.bin"
+#define ARRAY_FILE_ALIGNMENT 64
+
+// Функция для чтения length байт со смещения offset (при ошибке программа завершается)
+void pread_full(int fd, void* buf, size_t length, off_t offset) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t got = pread(fd, (char*)buf + done, length - done, offset + (off_t)done);
+        if (got <= 0) {
+            fprintf(stderr, "Ошибка чтения временного файла\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        done += (size_t)got;
+    }
+}
+
+// Функция для записи length байт целиком (при ошибке программа завершается)
+void write_full(int fd, const void* buf, size_t length) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t put = write(fd, (const char*)buf + done, length - done);
+        if (put < 0) {
+            perror("Ошибка записи во временный файл");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        done += (size_t)put;
+    }
+}
+
+// Функция для создания временного файла серии. Файл сразу удаляется из каталога
+// и исчезает при закрытии дескриптора (каталог - TMPDIR или текущий)
+int create_run_file(void) {
+    const char* dir = getenv("TMPDIR");
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/bubble_sort_runXXXXXX", dir ? dir : ".");
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("Ошибка создания временного файла");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    unlink(path);
+    return fd;
+}
+
+// Чтение серии при слиянии: пока сливается текущий блок, следующий читается асинхронно
+typedef struct {
+    int fd;
+    off_t offset;           // Смещение следующего блока в файле
+    long remaining;         // Элементов, еще не запрошенных чтением
+    int* buf[2];            // Текущий блок и блок упреждающего чтения
+    long len, pos;          // Элементов в текущем блоке и позиция в нем
+    long block;             // Размер блока в элементах
+    struct aiocb cb;        // Запрос упреждающего чтения
+    int pending;
+} RunReader;
+
+// Функция для ожидания завершения асинхронной операции, возвращает число байт
+ssize_t wait_aio(struct aiocb* cb) {
+    const struct aiocb* list[1] = {cb};
+    while (aio_error(cb) == EINPROGRESS) {
+        aio_suspend(list, 1, NULL);
+    }
+    return aio_return(cb);
+}
+
+// Функция для запуска упреждающего чтения следующего блока серии в buf[1]
+void run_reader_prefetch(RunReader* r) {
+    if (r->remaining == 0) {
+        return;
+    }
+    long n = r->remaining < r->block ? r->remaining : r->block;
+    memset(&r->cb, 0, sizeof(r->cb));
+    r->cb.aio_fildes = r->fd;
+    r->cb.aio_buf = r->buf[1];
+    r->cb.aio_nbytes = n * sizeof(int);
+    r->cb.aio_offset = r->offset;
+    if (aio_read(&r->cb) != 0) {
+        perror("Ошибка асинхронного чтения");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    r->offset += n * sizeof(int);
+    r->remaining -= n;
+    r->pending = 1;
+}
+
+// Функция для перехода к следующему блоку серии. Возвращает 0, если серия закончилась
+int run_reader_next(RunReader* r) {
+    if (!r->pending) {
+        return 0;
+    }
+    ssize_t got = wait_aio(&r->cb);
+    if (got != (ssize_t)r->cb.aio_nbytes) {
+        fprintf(stderr, "Ошибка чтения временного файла\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    r->pending = 0;
+    
+    int* tmp = r->buf[0];
+    r->buf[0] = r->buf[1];
+    r->buf[1] = tmp;
+    r->len = got / sizeof(int);
+    r->pos = 0;
+    run_reader_prefetch(r);
+    return 1;
+}
+
+// Запись результата: заполненный блок пишется асинхронно, пока заполняется второй
+typedef struct {
+    int fd;
+    off_t offset;
+    int* buf[2];
+    long len, block;
+    struct aiocb cb;
+    int pending;
+} RunWriter;
+
+// Функция для асинхронной записи заполненного блока результата
+void run_writer_flush(RunWriter* w) {
+    if (w->pending) {
+        if (wait_aio(&w->cb) != (ssize_t)w->cb.aio_nbytes) {
+            fprintf(stderr, "Ошибка записи файла результата\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        w->pending = 0;
+    }
+    if (w->len == 0) {
+        return;
+    }
+    
+    memset(&w->cb, 0, sizeof(w->cb));
+    w->cb.aio_fildes = w->fd;
+    w->cb.aio_buf = w->buf[0];
+    w->cb.aio_nbytes = w->len * sizeof(int);
+    w->cb.aio_offset = w->offset;
+    if (aio_write(&w->cb) != 0) {
+        perror("Ошибка асинхронной записи");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    w->offset += w->len * sizeof(int);
+    w->pending = 1;
+    
+    int* tmp = w->buf[0];
+    w->buf[0] = w->buf[1];
+    w->buf[1] = tmp;
+    w->len = 0;
+}
+
+// Функция просеивания вниз для пирамиды номеров серий по текущему элементу серии
+void sift_down_runs(int* heap, int root, int n, const RunReader* runs) {
+    int run = heap[root];
+    int value = runs[run].buf[0][runs[run].pos];
+    while (2 * root + 1 < n) {
+        int child = 2 * root + 1;
+        if (child + 1 < n &&
+            runs[heap[child + 1]].buf[0][runs[heap[child + 1]].pos] <
+            runs[heap[child]].buf[0][runs[heap[child]].pos]) {
+            child++;
+        }
+        if (runs[heap[child]].buf[0][runs[heap[child]].pos] >= value) {
+            break;
+        }
+        heap[root] = heap[child];
+        root = child;
+    }
+    heap[root] = run;
+}
+
+// Функция для k-путевого слияния отсортированных серий из временных файлов
+// в файл out_fd начиная со смещения out_offset. Блок каждой серии и вывода - block элементов
+void merge_run_files(const int* run_fds, const long* run_sizes, int k, long block,
+                     int out_fd, off_t out_offset) {
+    RunReader* runs = (RunReader*)calloc(k > 0 ? k : 1, sizeof(RunReader));
+    int* heap = (int*)malloc((k > 0 ? k : 1) * sizeof(int));
+    RunWriter w;
+    memset(&w, 0, sizeof(w));
+    w.fd = out_fd;
+    w.offset = out_offset;
+    w.block = block;
+    w.buf[0] = (int*)malloc(block * sizeof(int));
+    w.buf[1] = (int*)malloc(block * sizeof(int));
+    if (!runs || !heap || !w.buf[0] || !w.buf[1]) {
+        fprintf(stderr, "Ошибка выделения памяти для слияния\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    
+    int heap_size = 0;
+    for (int i = 0; i < k; i++) {
+        RunReader* r = &runs[i];
+        r->fd = run_fds[i];
+        r->remaining = run_sizes[i];
+        r->block = block;
+        r->buf[0] = (int*)malloc(block * sizeof(int));
+        r->buf[1] = (int*)malloc(block * sizeof(int));
+        if (!r->buf[0] || !r->buf[1]) {
+            fprintf(stderr, "Ошибка выделения памяти для слияния\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        run_reader_prefetch(r);
+        if (run_reader_next(r)) {
+            heap[heap_size++] = i;
+        }
+    }
+    for (int i = heap_size / 2 - 1; i >= 0; i--) {
+        sift_down_runs(heap, i, heap_size, runs);
+    }
+    
+    while (heap_size > 0) {
+        RunReader* r = &runs[heap[0]];
+        w.buf[0][w.len++] = r->buf[0][r->pos++];
+        if (w.len == w.block) {
+            run_writer_flush(&w);
+        }
+        
+        // Серия исчерпана - она уходит из пирамиды
+        if (r->pos == r->len && !run_reader_next(r)) {
+            heap[0] = heap[--heap_size];
+        }
+        if (heap_size > 0) {
+            sift_down_runs(heap, 0, heap_size, runs);
+        }
+    }
+    run_writer_flush(&w);
+    run_writer_flush(&w);
+    
+    for (int i = 0; i < k; i++) {
+        free(runs[i].buf[0]);
+        free(runs[i].buf[1]);
+    }
+    free(runs);
+    free(heap);
+    free(w.buf[0]);
+    free(w.buf[1]);
+}
+
+// Функция для поиска в отсортированном файле из size элементов позиции первого
+// элемента, большего value (двоичный поиск чтением по одному элементу)
+long file_upper_bound(int fd, long size, int value) {
+    long low = 0, high = size;
+    while (low < high) {
+        long mid = low + (high - low) / 2;
+        int x;
+        pread_full(fd, &x, sizeof(int), (off_t)mid * sizeof(int));
+        if (x <= value) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+// Функция для потоковой проверки отсортированности участка файла результата.
+// Первый и последний элементы участка записываются в first и last
+int is_sorted_file_range(int fd, off_t offset, long long count, long block, int* first, int* last) {
+    int* buf = (int*)malloc(block * sizeof(int));
+    if (!buf) {
+        return 0;
+    }
+    long long seen = 0;
+    int prev = INT_MIN, ok = 1;
+    while (ok && seen < count) {
+        long n = (count - seen < block) ? (long)(count - seen) : block;
+        pread_full(fd, buf, n * sizeof(int), offset + (off_t)seen * sizeof(int));
+        if (seen == 0) {
+            *first = buf[0];
+        }
+        for (long i = 0; i < n; i++) {
+            ok &= (buf[i] >= prev);
+            prev = buf[i];
+        }
+        seen += n;
+    }
+    *last = prev;
+    free(buf);
+    return ok;
+}
+
+// Функция для внешней сортировки массива, не помещающегося в память процессов:
+// 1) каждый процесс читает свой участок array.bin через MPI-IO сериями по размеру
+//    бюджета, сортирует их локальным алгоритмом и сбрасывает во временные файлы;
+// 2) серии процесса сливаются k-путевым слиянием в один локальный файл;
+// 3) как в sample_sort, по регулярной выборке из локальных файлов выбираются
+//    разделители, и корзины передаются через MPI_Alltoallv порциями, помещающимися
+//    в бюджет; принятое от каждого процесса дописывается в отдельный файл;
+// 4) принятые участки сливаются и записываются в EXTERNAL_OUTPUT_FILE со смещения,
+//    найденного через MPI_Exscan, так что процесс r пишет r-ю часть результата.
+// Память каждого процесса ограничена budget_mb мегабайтами (без учета служебных структур)
+int external_sort(int rank, int proc_size, bool use_radix, bool allow_counting,
+                  int num_threads, long budget_mb) {
+    size_t budget = (size_t)budget_mb << 20;
+    double start_time = MPI_Wtime();
+    
+    MPI_File fh;
+    if (MPI_File_open(MPI_COMM_WORLD, "array.bin", MPI_MODE_RDONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+        if (rank == 0) {
+            fprintf(stderr, "Ошибка: внешняя сортировка читает только бинарный файл array.bin\n");
+        }
+        return 1;
+    }
+    ArrayFileHeader header;
+    MPI_File_read_at_all(fh, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE);
+    MPI_Offset file_size;
+    MPI_File_get_size(fh, &file_size);
+    if (memcmp(header.magic, ARRAY_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.elem_type != ARRAY_FILE_INT32 ||
+        header.data_offset + header.count * sizeof(int) > (uint64_t)file_size) {
+        if (rank == 0) {
+            fprintf(stderr, "Ошибка: некорректный заголовок бинарного массива array.bin\n");
+        }
+        MPI_File_close(&fh);
+        return 1;
+    }
+    
+    // Участок процесса: элементы [slice_start, slice_start + slice_size)
+    long long count = (long long)header.count;
+    long long slice_size = count / proc_size + (rank < count % proc_size ? 1 : 0);
+    long long slice_start = count / proc_size * rank + (rank < count % proc_size ? rank : count % proc_size);
+    
+    // Фаза 1: формирование серий. Поразрядной сортировке нужен буфер того же размера
+    long run_capacity = (long)(budget / (2 * sizeof(int)));
+    if (run_capacity > INT_MAX) {
+        run_capacity = INT_MAX;
+    }
+    int run_count = (int)((slice_size + run_capacity - 1) / run_capacity);
+    int* run = (int*)malloc(run_capacity * sizeof(int));
+    int* run_fds = (int*)malloc((run_count > 0 ? run_count : 1) * sizeof(int));
+    long* run_sizes = (long*)malloc((run_count > 0 ? run_count : 1) * sizeof(long));
+    if (!run || !run_fds || !run_sizes) {
+        fprintf(stderr, "Ошибка выделения памяти для серий\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    int counted = 0;
+    for (int i = 0; i < run_count; i++) {
+        long long first = (long long)i * run_capacity;
+        long n = (slice_size - first < run_capacity) ? (long)(slice_size - first) : run_capacity;
+        MPI_Offset offset = (MPI_Offset)(header.data_offset + (slice_start + first) * sizeof(int));
+        MPI_Status status;
+        int got;
+        MPI_File_read_at(fh, offset, run, (int)n, MPI_INT, &status);
+        MPI_Get_count(&status, MPI_INT, &got);
+        if (got != n) {
+            fprintf(stderr, "Ошибка: бинарный массив короче заявленного в заголовке\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        counted |= sort_local_part(run, (int)n, use_radix, allow_counting, num_threads);
+        
+        run_fds[i] = create_run_file();
+        write_full(run_fds[i], run, n * sizeof(int));
+        run_sizes[i] = n;
+    }
+    MPI_File_close(&fh);
+    free(run);
+    double runs_time = MPI_Wtime() - start_time;
+    
+    // Фаза 2: слияние серий процесса в один локальный файл.
+    // На каждую серию и на вывод - по два блока (текущий и асинхронный)
+    double local_merge_start = MPI_Wtime();
+    long block = (long)(budget / (2 * sizeof(int) * (size_t)(run_count + 1)));
+    if (block < EXTERNAL_MIN_MERGE_BLOCK) {
+        block = EXTERNAL_MIN_MERGE_BLOCK;
+    }
+    int local_fd = create_run_file();
+    merge_run_files(run_fds, run_sizes, run_count, block, local_fd, 0);
+    for (int i = 0; i < run_count; i++) {
+        close(run_fds[i]);
+    }
+    free(run_fds);
+    free(run_sizes);
+    double local_merge_time = MPI_Wtime() - local_merge_start;
+    
+    // Фаза 3: регулярная выборка из локального файла и выбор разделителей на процессе 0
+    double exchange_start = MPI_Wtime();
+    int num_samples = (slice_size < proc_size) ? (int)slice_size : proc_size;
+    int* samples = (int*)malloc(proc_size * sizeof(int));
+    for (int i = 0; i < num_samples; i++) {
+        pread_full(local_fd, &samples[i], sizeof(int), (off_t)(i * slice_size / num_samples) * sizeof(int));
+    }
+    int* sample_counts = NULL;
+    int* sample_displs = NULL;
+    int* all_samples = NULL;
+    int total_samples = 0;
+    if (rank == 0) {
+        sample_counts = (int*)malloc(proc_size * sizeof(int));
+        sample_displs = (int*)malloc(proc_size * sizeof(int));
+    }
+    MPI_Gather(&num_samples, 1, MPI_INT, sample_counts, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (rank == 0) {
+        for (int i = 0; i < proc_size; i++) {
+            sample_displs[i] = total_samples;
+            total_samples += sample_counts[i];
+        }
+        all_samples = (int*)malloc((total_samples > 0 ? total_samples : 1) * sizeof(int));
+    }
+    MPI_Gatherv(samples, num_samples, MPI_INT,
+               all_samples, sample_counts, sample_displs, MPI_INT,
+               0, MPI_COMM_WORLD);
+    int* splitters = (int*)malloc((proc_size > 1 ? proc_size - 1 : 1) * sizeof(int));
+    if (rank == 0) {
+        qsort(all_samples, total_samples, sizeof(int), compare_ints);
+        for (int i = 1; i < proc_size; i++) {
+            splitters[i - 1] = (total_samples > 0) ? all_samples[(long)i * total_samples / proc_size] : 0;
+        }
+    }
+    MPI_Bcast(splitters, proc_size - 1, MPI_INT, 0, MPI_COMM_WORLD);
+    
+    // Границы корзин в локальном файле: в корзину i идут значения из (splitter[i-1], splitter[i]]
+    long* bucket_pos = (long*)malloc(proc_size * sizeof(long));
+    long* bucket_end = (long*)malloc(proc_size * sizeof(long));
+    long rounds = 0, prev = 0;
+    for (int i = 0; i < proc_size; i++) {
+        long next = (i < proc_size - 1) ? file_upper_bound(local_fd, (long)slice_size, splitters[i]) : (long)slice_size;
+        bucket_pos[i] = prev;
+        bucket_end[i] = next;
+        prev = next;
+    }
+    
+    // Фаза 4: обмен корзинами порциями по chunk элементов на пару процессов,
+    // чтобы буферы отправки и приема вместе укладывались в бюджет
+    long chunk = (long)(budget / (2 * sizeof(int) * (size_t)proc_size));
+    if (chunk > INT_MAX / proc_size) {
+        chunk = INT_MAX / proc_size;
+    }
+    for (int i = 0; i < proc_size; i++) {
+        long need = (bucket_end[i] - bucket_pos[i] + chunk - 1) / chunk;
+        if (need > rounds) {
+            rounds = need;
+        }
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &rounds, 1, MPI_LONG, MPI_MAX, MPI_COMM_WORLD);
+    
+    int* send_buf = (int*)malloc((size_t)proc_size * chunk * sizeof(int));
+    int* recv_buf = (int*)malloc((size_t)proc_size * chunk * sizeof(int));
+    int* send_counts = (int*)malloc(proc_size * sizeof(int));
+    int* recv_counts = (int*)malloc(proc_size * sizeof(int));
+    int* chunk_displs = (int*)malloc(proc_size * sizeof(int));
+    int* recv_fds = (int*)malloc(proc_size * sizeof(int));
+    long* recv_sizes = (long*)calloc(proc_size, sizeof(long));
+    if (!send_buf || !recv_buf || !send_counts || !recv_counts || !chunk_displs ||
+        !recv_fds || !recv_sizes || !samples || !splitters || !bucket_pos || !bucket_end) {
+        fprintf(stderr, "Ошибка выделения памяти для обмена корзинами\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    for (int i = 0; i < proc_size; i++) {
+        chunk_displs[i] = (int)(i * chunk);
+        recv_fds[i] = create_run_file();
+    }
+    
+    for (long round = 0; round < rounds; round++) {
+        for (int i = 0; i < proc_size; i++) {
+            long n = bucket_end[i] - bucket_pos[i];
+            send_counts[i] = (int)(n < chunk ? n : chunk);
+            pread_full(local_fd, send_buf + chunk_displs[i], send_counts[i] * sizeof(int),
+                       (off_t)bucket_pos[i] * sizeof(int));
+            bucket_pos[i] += send_counts[i];
+        }
+        MPI_Alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT, MPI_COMM_WORLD);
+        MPI_Alltoallv(send_buf, send_counts, chunk_displs, MPI_INT,
+                     recv_buf, recv_counts, chunk_displs, MPI_INT,
+                     MPI_COMM_WORLD);
+        
+        // Порции от одного процесса приходят по возрастанию - файл источника остается отсортированным
+        for (int i = 0; i < proc_size; i++) {
+            write_full(recv_fds[i], recv_buf + chunk_displs[i], recv_counts[i] * sizeof(int));
+            recv_sizes[i] += recv_counts[i];
+        }
+    }
+    close(local_fd);
+    free(send_buf);
+    free(recv_buf);
+    double exchange_time = MPI_Wtime() - exchange_start;
+    
+    // Фаза 5: слияние принятых участков в общий файл результата.
+    // Процесс 0 создает файл и пишет заголовок, остальные открывают его после барьера
+    double merge_start = MPI_Wtime();
+    long long received = 0, result_offset = 0;
+    for (int i = 0; i < proc_size; i++) {
+        received += recv_sizes[i];
+    }
+    MPI_Exscan(&received, &result_offset, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0) {
+        result_offset = 0;
+    }
+    
+    int out_fd = -1;
+    if (rank == 0) {
+        out_fd = open(EXTERNAL_OUTPUT_FILE, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (out_fd < 0) {
+            perror("Ошибка создания файла результата");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        unsigned char header_block[ARRAY_FILE_ALIGNMENT] = {0};
+        ArrayFileHeader out_header;
+        memcpy(out_header.magic, ARRAY_FILE_MAGIC, sizeof(out_header.magic));
+        out_header.elem_type = ARRAY_FILE_INT32;
+        out_header.alignment = ARRAY_FILE_ALIGNMENT;
+        out_header.count = header.count;
+        out_header.data_offset = ARRAY_FILE_ALIGNMENT;
+        memcpy(header_block, &out_header, sizeof(out_header));
+        write_full(out_fd, header_block, sizeof(header_block));
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (rank != 0) {
+        out_fd = open(EXTERNAL_OUTPUT_FILE, O_RDWR);
+        if (out_fd < 0) {
+            perror("Ошибка открытия файла результата");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    
+    long merge_block = (long)(budget / (2 * sizeof(int) * (size_t)(proc_size + 1)));
+    if (merge_block < EXTERNAL_MIN_MERGE_BLOCK) {
+        merge_block = EXTERNAL_MIN_MERGE_BLOCK;
+    }
+    off_t out_offset = ARRAY_FILE_ALIGNMENT + (off_t)result_offset * sizeof(int);
+    merge_run_files(recv_fds, recv_sizes, proc_size, merge_block, out_fd, out_offset);
+    for (int i = 0; i < proc_size; i++) {
+        close(recv_fds[i]);
+    }
+    double merge_time = MPI_Wtime() - merge_start;
+    double total_time = MPI_Wtime() - start_time;
+    
+    // Проверка: участок каждого процесса отсортирован, и участки упорядочены между собой
+    int info[3] = {received > 0, 0, 0};
+    int ok = is_sorted_file_range(out_fd, out_offset, received, merge_block, &info[1], &info[2]);
+    close(out_fd);
+    int* all_info = (int*)malloc(3 * proc_size * sizeof(int));
+    MPI_Allgather(info, 3, MPI_INT, all_info, 3, MPI_INT, MPI_COMM_WORLD);
+    int has_prev = 0, prev_last = 0;
+    for (int i = 0; i < proc_size; i++) {
+        if (!all_info[3 * i]) {
+            continue;
+        }
+        if (has_prev && prev_last > all_info[3 * i + 1]) {
+            ok = 0;
+        }
+        has_prev = 1;
+        prev_last = all_info[3 * i + 2];
+    }
+    free(all_info);
+    int all_ok;
+    MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+    
+    // Время фаз - по самому медленному процессу
+    double times[5] = {runs_time, local_merge_time, exchange_time, merge_time, total_time};
+    double max_times[5];
+    int max_runs;
+    long long max_received;
+    MPI_Reduce(times, max_times, 5, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&run_count, &max_runs, 1, MPI_INT, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&received, &max_received, 1, MPI_LONG_LONG, MPI_MAX, 0, MPI_COMM_WORLD);
+    if (rank == 0) {
+        printf("Внешняя сортировка (бюджет памяти %ld МБ на процесс)\n", budget_mb);
+        printf("Размер массива: %lld элементов\n", count);
+        printf("Серий на процесс: до %d по %ld элементов, порция обмена: %ld элементов, раундов обмена: %ld\n",
+               max_runs, run_capacity, chunk, rounds);
+        printf("Наибольшая часть результата: %lld элементов\n", max_received);
+        if (counted) {
+            printf("Серии процесса 0 отсортированы подсчетом (малый диапазон значений)\n");
+        }
+        printf("Время формирования серий: %.6f секунд\n", max_times[0]);
+        printf("Время слияния серий процесса: %.6f секунд\n", max_times[1]);
+        printf("Время обмена корзинами: %.6f секунд\n", max_times[2]);
+        printf("Время слияния принятых участков: %.6f секунд\n", max_times[3]);
+        printf("Общее время выполнения: %.6f секунд\n", max_times[4]);
+        printf("Пропускная способность: %.2f ключей/сек\n", count / max_times[4]);
+        printf(all_ok ? "Результат записан в " EXTERNAL_OUTPUT_FILE ", массив отсортирован корректно\n"
+                      : "ОШИБКА: массив в " EXTERNAL_OUTPUT_FILE " не отсортирован корректно!\n");
+    }
+    
+    free(samples);
+    free(sample_counts);
+    free(sample_displs);
+    free(all_samples);
+    free(splitters);
+    free(bucket_pos);
+    free(bucket_end);
+    free(send_counts);
+    free(recv_counts);
+    free(chunk_displs);
+    free(recv_fds);
+    free(recv_sizes);
+    return all_ok ? 0 : 1;
+}
+
 int main(int argc, char* argv[]) {
     int rank, proc_size;
     int* global_array = NULL;
     int global_size = 0;
-    double start_time, end_time, local_sort_time = 0, merge_time = 0;
+    double start_time, end_time, local_sort_time = 0, merge_time = 0, exchange_time = 0;
     int* local_array = NULL;
     int* recvcounts = NULL;
     int* displs = NULL;
+    MappedArray mapped;
     
-    // Инициализация MPI
-    MPI_Init(&argc, &argv);
+    // Инициализация MPI для гибридного режима: локальные вычисления выполняют
+    // OpenMP-потоки процесса, MPI вызывается только из главного потока
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &proc_size);
+    if (provided < MPI_THREAD_FUNNELED) {
+        if (rank == 0) {
+            fprintf(stderr, "Предупреждение: MPI не поддерживает MPI_THREAD_FUNNELED, "
+                            "используется один поток на процесс\n");
+        }
+#ifdef _OPENMP
+        omp_set_num_threads(1);
+#endif
+    }
+    
+    // Аргументы (в любом порядке):
+    //   bubble | radix (по умолчанию) - алгоритм локальной сортировки, radix работает
+    //                                   на всех OpenMP-потоках процесса; если алгоритм
+    //                                   не указан и диапазон значений мал, части
+    //                                   сортируются подсчетом;
+    //   psrs (по умолчанию) | merge | kway | oddeven
+    //                                 - сортировка выборкой с обменом корзинами через
+    //                                   MPI_Alltoallv, слияние частей по дереву процессов,
+    //                                   сбор всех частей на процессе 0 и их k-путевое
+    //                                   слияние (в этих двух случаях результат на процессе 0)
+    //                                   или чет-нечетная сортировка блоков между соседями;
+    //   gather                        - собрать результат psrs или oddeven на процессе 0
+    //                                   (иначе он остается распределенным);
+    //   median | p<процент> ...       - вместо сортировки найти медиану или квантили
+    //                                   (например p99) распределенным выбором;
+    //   external[<МБ>]                - внешняя сортировка array.bin сериями в пределах
+    //                                   бюджета памяти процесса с записью в sorted.bin
+    //                                   (схема и gather в этом режиме не используются)
+    bool use_radix = true;
+    bool sort_chosen = false;
+    SortScheme scheme = SCHEME_PSRS;
+    bool gather_result = false;
+    double quantiles[MAX_QUANTILES];
+    const char* quantile_labels[MAX_QUANTILES];
+    int quantile_count = 0;
+    long external_budget_mb = 0;
+    for (int i = 1; i < argc; i++) {
+        double q = parse_quantile_arg(argv[i]);
+        if (strcmp(argv[i], "bubble") == 0) {
+            use_radix = false;
+            sort_chosen = true;
+        } else if (strcmp(argv[i], "radix") == 0) {
+            use_radix = true;
+            sort_chosen = true;
+        } else if (strcmp(argv[i], "psrs") == 0) {
+            scheme = SCHEME_PSRS;
+        } else if (strcmp(argv[i], "merge") == 0) {
+            scheme = SCHEME_TREE_MERGE;
+        } else if (strcmp(argv[i], "kway") == 0) {
+            scheme = SCHEME_KWAY_MERGE;
+        } else if (strcmp(argv[i], "oddeven") == 0) {
+            scheme = SCHEME_ODD_EVEN;
+        } else if (strcmp(argv[i], "gather") == 0) {
+            gather_result = true;
+        } else if (strncmp(argv[i], "external", 8) == 0) {
+            char* end;
+            external_budget_mb = argv[i][8] ? strtol(argv[i] + 8, &end, 10) : EXTERNAL_DEFAULT_BUDGET_MB;
+            if ((argv[i][8] && *end != '\0') || external_budget_mb < EXTERNAL_MIN_BUDGET_MB) {
+                if (rank == 0) {
+                    printf("Бюджет внешней сортировки должен быть не меньше %d МБ\n", EXTERNAL_MIN_BUDGET_MB);
+                }
+                MPI_Finalize();
+                return 1;
+            }
+        } else if (q >= 0.0 && quantile_count < MAX_QUANTILES) {
+            quantiles[quantile_count] = q;
+            quantile_labels[quantile_count] = argv[i];
+            quantile_count++;
+        } else {
+            if (rank == 0) {
+                printf("Использование: %s [bubble|radix] [psrs|merge|kway|oddeven] [gather] [median|p<процент> ...] [external[<МБ>]]\n", argv[0]);
+            }
+            MPI_Finalize();
+            return 1;
+        }
+    }
+    if (external_budget_mb > 0 && quantile_count > 0) {
+        if (rank == 0) {
+            printf("Внешняя сортировка не совмещается с выбором квантилей\n");
+        }
+        MPI_Finalize();
+        return 1;
+    }
+    // При слиянии на процессе 0 результат собирается всегда
+    if (scheme == SCHEME_TREE_MERGE || scheme == SCHEME_KWAY_MERGE) {
+        gather_result = true;
+    }
+#ifdef _OPENMP
+    int num_threads = omp_get_max_threads();
+#else
+    int num_threads = 1;
+#endif
     
     // Инициализация массивов, чтобы избежать освобождения неинициализированных указателей
     if (rank == 0) {
-        printf("=== ПАРАЛЛЕЛЬНАЯ ПУЗЫРЬКОВАЯ СОРТИРОВКА ===\n");
+        printf("=== ПАРАЛЛЕЛЬНАЯ СОРТИРОВКА ===\n");
         printf("Используется %d процессов\n", proc_size);
-        
+        printf("OpenMP-потоков на процесс: %d\n", num_threads);
+        if (use_radix) {
+            printf("Локальная сортировка: поразрядная (%d потоков)\n", num_threads);
+        } else {
+            printf("Локальная сортировка: пузырьковая\n");
+        }
+        static const char* scheme_names[] = {
+            "сортировка выборкой (PSRS)", "слияние по дереву процессов", "k-путевое слияние на процессе 0",
+            "чет-нечетная сортировка блоков"
+        };
+        if (external_budget_mb > 0) {
+            printf("Схема: внешняя сортировка с обменом корзинами порциями\n");
+        } else {
+            printf("Схема: %s\n", scheme_names[scheme]);
+        }
+    }
+    
+    // Внешняя сортировка читает и пишет файлы сама, массив в память не загружается
+    if (external_budget_mb > 0) {
+        int rc = external_sort(rank, proc_size, use_radix, !sort_chosen, num_threads, external_budget_mb);
+        MPI_Finalize();
+        return rc;
+    }
+    
+    if (rank == 0) {
+        const char* bin_filename = "array.bin";
         const char* filename = "array.txt";
-        printf("Чтение массива из файла %s...\n", filename);
-        global_array = read_array_from_file(filename, &global_size);
+        printf("Чтение массива из файла %s...\n",
+               access(bin_filename, F_OK) == 0 ? bin_filename : filename);
+        global_array = load_array(bin_filename, filename, &global_size, &mapped);
         if (!global_array) {
             fprintf(stderr, "Ошибка при чтении массива\n");
             MPI_Abort(MPI_COMM_WORLD, 1);
@@ -195,7 +2070,7 @@ int main(int argc, char* argv[]) {
     
     // Размер локальной части для текущего процесса
     local_size = recvcounts[rank];
-    local_array = (int*)malloc(local_size * sizeof(int));
+    local_array = (int*)malloc((local_size > 0 ? local_size : 1) * sizeof(int));
     if (!local_array) {
         fprintf(stderr, "Ошибка выделения памяти для local_array\n");
         MPI_Abort(MPI_COMM_WORLD, 1);
@@ -206,74 +2081,166 @@ int main(int argc, char* argv[]) {
                 local_array, local_size, MPI_INT,
                 0, MPI_COMM_WORLD);
     
+    // Выбор квантилей без сортировки: ранг по ближайшему рангу ceil(p * n) - 1
+    if (quantile_count > 0) {
+        if (rank == 0) {
+            printf("Распределенный выбор (взвешенная медиана локальных медиан)\n");
+        }
+        bool select_ok = true;
+        for (int i = 0; i < quantile_count; i++) {
+            double position = quantiles[i] * global_size;
+            long long k = (long long)position;
+            if (k < position) {
+                k++;
+            }
+            k = (k > 0) ? k - 1 : 0;
+            
+            int rounds;
+            double select_start = MPI_Wtime();
+            int value = distributed_select(local_array, local_size, k, rank, proc_size, &rounds);
+            double select_time = MPI_Wtime() - select_start;
+            
+            // Проверка ранга: элементов меньше value не больше k, не больших value - больше k
+            long long local_counts[2] = {0, 0}, global_counts[2];
+            for (int j = 0; j < local_size; j++) {
+                local_counts[0] += local_array[j] < value;
+                local_counts[1] += local_array[j] <= value;
+            }
+            MPI_Reduce(local_counts, global_counts, 2, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+            if (rank == 0) {
+                select_ok &= (global_counts[0] <= k && k < global_counts[1]);
+                printf("Квантиль %s (ранг %lld): %d, раундов: %d, время: %.6f секунд\n",
+                       quantile_labels[i], k, value, rounds, select_time);
+            }
+        }
+        if (rank == 0) {
+            printf(select_ok ? "Проверка рангов: значения выбраны корректно\n"
+                             : "ОШИБКА: ранги выбранных значений не совпадают\n");
+            printf("Общее время выполнения: %.6f секунд\n", MPI_Wtime() - start_time);
+            release_array(global_array, &mapped);
+        }
+        free(local_array);
+        free(recvcounts);
+        free(displs);
+        MPI_Finalize();
+        return 0;
+    }
+    
     // Сортируем локальную часть
     double local_start = MPI_Wtime();
-    bubble_sort(local_array, local_size);
+    int counted = sort_local_part(local_array, local_size, use_radix, !sort_chosen, num_threads);
     local_sort_time = MPI_Wtime() - local_start;
+    int sorted_local_size = local_size;
     
-    // Собираем отсортированные части на процессе 0
-    if (rank == 0) {
-        // Копируем первую часть в результирующий массив
-        int* temp_buffer = (int*)malloc(global_size * sizeof(int));
-        if (!temp_buffer) {
-            fprintf(stderr, "Ошибка выделения памяти для temp_buffer\n");
-            MPI_Abort(MPI_COMM_WORLD, 1);
-        }
-        
-        memcpy(global_array, local_array, local_size * sizeof(int));
-        int merged_size = local_size;
-        
+    if (scheme == SCHEME_PSRS) {
+        // Сортировка выборкой: после нее процесс r хранит r-ю по порядку часть результата
+        int sorted_size;
+        int* sorted_part = sample_sort(local_array, local_size, &sorted_size, rank, proc_size,
+                                       num_threads, &exchange_time, &merge_time);
+        free(local_array);
+        local_array = sorted_part;
+        local_size = sorted_size;
+    } else if (scheme == SCHEME_ODD_EVEN) {
+        // Чет-нечетная сортировка: размеры блоков не меняются, обмен только между соседями
+        local_array = odd_even_sort(local_array, recvcounts, rank, proc_size,
+                                    &exchange_time, &merge_time);
+    } else if (scheme == SCHEME_TREE_MERGE) {
+        // Слияние отсортированных частей по двоичному дереву процессов в global_array
         double merge_start = MPI_Wtime();
-        for (int i = 1; i < proc_size; i++) {
-            int recv_size = recvcounts[i];
-            int* recv_buf = temp_buffer + merged_size;
-            
-            MPI_Recv(recv_buf, recv_size, MPI_INT, i, 0, 
-                    MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            
-            // Объединяем с уже отсортированной частью
-            merge_arrays(global_array, merged_size, 
-                        recv_buf, recv_size,
-                        temp_buffer);
-            
-            // Копируем результат обратно в global_array
-            memcpy(global_array, temp_buffer, 
-                  (merged_size + recv_size) * sizeof(int));
-            
-            merged_size += recv_size;
-        }
+        tree_merge(local_array, local_size, rank, proc_size, global_array);
         merge_time = MPI_Wtime() - merge_start;
-        
-        free(temp_buffer);
     } else {
-        // Отправляем отсортированную часть на процесс 0
-        MPI_Send(local_array, local_size, MPI_INT, 0, 0, MPI_COMM_WORLD);
+        // Сбор всех отсортированных частей на процессе 0 и их слияние за один проход
+        double gather_start = MPI_Wtime();
+        int* runs = NULL;
+        int* run_displs = NULL;
+        if (rank == 0) {
+            runs = (int*)malloc(global_size * sizeof(int));
+            run_displs = (int*)malloc((proc_size + 1) * sizeof(int));
+            if (!runs || !run_displs) {
+                fprintf(stderr, "Ошибка выделения памяти для сбора частей\n");
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            memcpy(run_displs, displs, proc_size * sizeof(int));
+            run_displs[proc_size] = global_size;
+        }
+        MPI_Gatherv(local_array, local_size, MPI_INT,
+                   runs, recvcounts, displs, MPI_INT,
+                   0, MPI_COMM_WORLD);
+        exchange_time = MPI_Wtime() - gather_start;
+        
+        if (rank == 0) {
+            double merge_start = MPI_Wtime();
+            kway_merge_parallel(runs, run_displs, proc_size, global_array, num_threads);
+            merge_time = MPI_Wtime() - merge_start;
+        }
+        free(runs);
+        free(run_displs);
+    }
+    
+    if ((scheme == SCHEME_PSRS || scheme == SCHEME_ODD_EVEN) && gather_result) {
+        // Собираем части результата на процессе 0 (после PSRS их размеры зависят от данных)
+        double gather_start = MPI_Wtime();
+        MPI_Gather(&local_size, 1, MPI_INT, recvcounts, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        if (rank == 0) {
+            for (int i = 0, pos = 0; i < proc_size; i++) {
+                displs[i] = pos;
+                pos += recvcounts[i];
+            }
+        }
+        MPI_Gatherv(local_array, local_size, MPI_INT,
+                   global_array, recvcounts, displs, MPI_INT,
+                   0, MPI_COMM_WORLD);
+        exchange_time += MPI_Wtime() - gather_start;
     }
     
     // Синхронизация после завершения сортировки
     MPI_Barrier(MPI_COMM_WORLD);
     end_time = MPI_Wtime();
     
+    // Проверка отсортированности: собранного массива на процессе 0
+    // или распределенного результата на всех процессах
+    bool sorted_ok = true;
+    if (!gather_result) {
+        sorted_ok = is_sorted_distributed(local_array, local_size, proc_size);
+    } else if (rank == 0) {
+        sorted_ok = is_sorted(global_array, global_size);
+    }
+    
     // Выводим результаты
     if (rank == 0) {
-        // Проверка отсортированности
-        printf("Проверка отсортированности... ");
-        fflush(stdout);
-        
-        if (is_sorted(global_array, global_size)) {
+        printf("Проверка отсортированности%s... ", gather_result ? "" : " (распределенный результат)");
+        if (sorted_ok) {
             printf("массив отсортирован корректно\n");
         } else {
             printf("ОШИБКА: массив не отсортирован!\n");
         }
         
         // Выводим образец отсортированного массива
-        print_array_sample(global_array, global_size, "Отсортированный массив", rank);
+        if (gather_result) {
+            print_array_sample(global_array, global_size, "Отсортированный массив", rank);
+        } else {
+            print_array_sample(local_array, local_size, "Часть результата на процессе 0", rank);
+        }
         
         // Выводим время выполнения
         printf("Общее время выполнения: %.6f секунд\n", end_time - start_time);
+        if (counted) {
+            printf("Локальная часть процесса 0 отсортирована подсчетом (малый диапазон значений)\n");
+        }
         printf("Время сортировки (локальные части): %.6f секунд\n", local_sort_time);
+        if (scheme == SCHEME_PSRS) {
+            printf("Время обмена (выборка, MPI_Alltoallv%s): %.6f секунд\n",
+                   gather_result ? ", сбор" : "", exchange_time);
+        } else if (scheme == SCHEME_KWAY_MERGE) {
+            printf("Время сбора частей: %.6f секунд\n", exchange_time);
+        } else if (scheme == SCHEME_ODD_EVEN) {
+            printf("Время обмена блоками (MPI_Sendrecv%s): %.6f секунд\n",
+                   gather_result ? ", сбор" : "", exchange_time);
+        }
         printf("Время слияния: %.6f секунд\n", merge_time);
-        
+        printf("Пропускная способность локальной сортировки: %.2f ключей/сек\n",
+               sorted_local_size / local_sort_time);
     }
     
     // Освобождаем память
@@ -281,11 +2248,11 @@ int main(int argc, char* argv[]) {
     if (recvcounts) free(recvcounts);
     if (displs) free(displs);
     if (rank == 0 && global_array) {
-        free(global_array);
+        release_array(global_array, &mapped);
     }
     
     // Завершаем MPI
     MPI_Finalize();
     
     return 0;
-}
\ No newline at end of file
+}
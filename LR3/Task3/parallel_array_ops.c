@@ -1,50 +1,1099 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <mpi.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include <time.h>
 #include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
-// Функция для чтения массива из файла
-double* read_array_from_file(const char* filename, int* size) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
+// Функция для проверки, является ли символ разделителем чисел
+static inline int is_separator(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Функция для разбиения текста на диапазоны байтов по числу потоков.
+// Границы сдвигаются вперед до ближайшего разделителя, чтобы не разрезать числа
+void split_text_ranges(const char* text, size_t length, int parts, size_t* bounds) {
+    bounds[0] = 0;
+    for (int i = 1; i < parts; i++) {
+        size_t b = length / parts * i;
+        if (b < bounds[i - 1]) {
+            b = bounds[i - 1];
+        }
+        while (b < length && !is_separator(text[b])) {
+            b++;
+        }
+        bounds[i] = b;
+    }
+    bounds[parts] = length;
+}
+
+// Функция для отображения текстового файла в память только для чтения
+const char* map_text_file(const char* filename, size_t* length) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
         perror("Ошибка при открытии файла");
         exit(EXIT_FAILURE);
     }
 
-    // Подсчет количества чисел в файле
-    int count = 0;
-    double temp;
-    while (fscanf(file, "%lf", &temp) == 1) {
-        count++;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror("Ошибка при получении размера файла");
+        close(fd);
+        exit(EXIT_FAILURE);
     }
-    
-    // Возврат к началу файла
-    rewind(file);
-    
-    // Выделение памяти под массив
-    double* arr = (double*)malloc(count * sizeof(double));
-    if (!arr) {
+
+    *length = (size_t)st.st_size;
+    if (*length == 0) {
+        close(fd);
+        return "";
+    }
+
+    void* text = mmap(NULL, *length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (text == MAP_FAILED) {
+        perror("Ошибка отображения файла в память");
+        exit(EXIT_FAILURE);
+    }
+    madvise(text, *length, MADV_SEQUENTIAL);
+    return (const char*)text;
+}
+
+// Функция для освобождения отображения текстового файла
+void unmap_text_file(const char* text, size_t length) {
+    if (length > 0) {
+        munmap((void*)text, length);
+    }
+}
+
+// Функция для разбора целых чисел из диапазона [p, end) в out.
+// Возвращает количество прочитанных чисел или -1 при ошибке формата
+long parse_int_range(const char* p, const char* end, int* out) {
+    long count = 0;
+    while (1) {
+        while (p < end && is_separator(*p)) {
+            p++;
+        }
+        if (p == end) {
+            break;
+        }
+
+        int negative = (*p == '-');
+        if (*p == '-' || *p == '+') {
+            p++;
+        }
+        if (p == end || *p < '0' || *p > '9') {
+            return -1;
+        }
+
+        long long value = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            value = value * 10 + (*p - '0');
+            if (value > (long long)INT_MAX + 1) {
+                return -1;
+            }
+            p++;
+        }
+        if (p < end && !is_separator(*p)) {
+            return -1;
+        }
+
+        value = negative ? -value : value;
+        if (value > INT_MAX) {
+            return -1;
+        }
+        out[count++] = (int)value;
+    }
+    return count;
+}
+
+// Функция для параллельного разбора текста с целыми числами за один проход:
+// каждый поток разбирает свой диапазон во временный буфер, затем куски
+// склеиваются в общий массив по префиксной сумме количеств.
+// Возвращает NULL при ошибке формата
+int* parse_int_text_parallel(const char* text, size_t length, int* size) {
+#ifdef _OPENMP
+    int num_chunks = omp_get_max_threads();
+#else
+    int num_chunks = 1;
+#endif
+    size_t* bounds = (size_t*)malloc((num_chunks + 1) * sizeof(size_t));
+    long* counts = (long*)malloc(num_chunks * sizeof(long));
+    size_t* offsets = (size_t*)malloc(num_chunks * sizeof(size_t));
+    int** chunks = (int**)calloc(num_chunks, sizeof(int*));
+    if (!bounds || !counts || !offsets || !chunks) {
         perror("Ошибка выделения памяти");
-        fclose(file);
         exit(EXIT_FAILURE);
     }
-    
-    // Чтение чисел в массив
-    for (int i = 0; i < count; i++) {
-        if (fscanf(file, "%lf", &arr[i]) != 1) {
-            fprintf(stderr, "Ошибка при чтении элемента %d\n", i);
-            free(arr);
-            fclose(file);
+
+    split_text_ranges(text, length, num_chunks, bounds);
+
+    // Разбор диапазонов: в диапазоне из L байт не больше L / 2 + 1 чисел
+    int failed = 0;
+    #pragma omp parallel for num_threads(num_chunks) schedule(static, 1) reduction(|:failed)
+    for (int c = 0; c < num_chunks; c++) {
+        size_t chunk_length = bounds[c + 1] - bounds[c];
+        chunks[c] = (int*)malloc((chunk_length / 2 + 1) * sizeof(int));
+        counts[c] = chunks[c] ? parse_int_range(text + bounds[c], text + bounds[c + 1], chunks[c]) : -1;
+        if (counts[c] < 0) {
+            failed = 1;
+        }
+    }
+
+    // Префиксная сумма количеств дает смещение каждого куска в итоговом массиве
+    size_t total = 0;
+    for (int c = 0; c < num_chunks && !failed; c++) {
+        offsets[c] = total;
+        total += (size_t)counts[c];
+    }
+
+    int* arr = NULL;
+    if (!failed && total <= INT_MAX) {
+        arr = (int*)malloc((total > 0 ? total : 1) * sizeof(int));
+        if (!arr) {
+            perror("Ошибка выделения памяти");
             exit(EXIT_FAILURE);
         }
+
+        // Склейка кусков в общий массив
+        #pragma omp parallel for num_threads(num_chunks) schedule(static, 1)
+        for (int c = 0; c < num_chunks; c++) {
+            memcpy(arr + offsets[c], chunks[c], (size_t)counts[c] * sizeof(int));
+        }
+        *size = (int)total;
     }
-    
-    fclose(file);
-    *size = count;
+
+    for (int c = 0; c < num_chunks; c++) {
+        free(chunks[c]);
+    }
+    free(chunks);
+    free(offsets);
+    free(counts);
+    free(bounds);
     return arr;
 }
 
+// Функция для чтения массива из текстового файла (параллельный разбор за один проход)
+int* read_array_from_file(const char* filename, int* size) {
+    size_t length;
+    const char* text = map_text_file(filename, &length);
+
+    int* arr = parse_int_text_parallel(text, length, size);
+    unmap_text_file(text, length);
+    if (!arr) {
+        fprintf(stderr, "Ошибка при чтении чисел из файла %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    return arr;
+}
+
+// Бинарный формат массива: заголовок ArrayFileHeader, затем сырые данные,
+// начинающиеся со смещения data_offset (кратного alignment)
+#define ARRAY_FILE_MAGIC "PCSARR01"
+#define ARRAY_FILE_INT32 1
+#define ARRAY_FILE_FLOAT64 2
+
+typedef struct {
+    char magic[8];          // Сигнатура ARRAY_FILE_MAGIC
+    uint32_t elem_type;     // Тип элементов (ARRAY_FILE_INT32 / ARRAY_FILE_FLOAT64)
+    uint32_t alignment;     // Выравнивание начала данных в байтах
+    uint64_t count;         // Количество элементов
+    uint64_t data_offset;   // Смещение данных от начала файла
+} ArrayFileHeader;
+
+// Отображение бинарного файла в память
+typedef struct {
+    void* base;             // Начало отображения (NULL, если массив прочитан из текста)
+    size_t length;          // Длина отображения в байтах
+} MappedArray;
+
+// Функция для отображения бинарного массива в память (без разбора и копирования).
+// Возвращает указатель на данные или NULL, если файла нет
+void* map_array_file(const char* filename, uint32_t elem_type, int* size, MappedArray* mapped) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ArrayFileHeader)) {
+        fprintf(stderr, "Ошибка: файл %s не является бинарным массивом\n", filename);
+        exit(EXIT_FAILURE);
+    }
+
+    // Закрытое отображение с правом записи: страницы копируются только при изменении
+    void* base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("Ошибка отображения файла в память");
+        exit(EXIT_FAILURE);
+    }
+
+    // Проверка заголовка
+    const ArrayFileHeader* header = (const ArrayFileHeader*)base;
+    size_t elem_size = (elem_type == ARRAY_FILE_INT32) ? sizeof(int32_t) : sizeof(double);
+    if (memcmp(header->magic, ARRAY_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->elem_type != elem_type ||
+        header->alignment == 0 || header->data_offset % header->alignment != 0 ||
+        header->count > INT_MAX ||
+        header->data_offset + header->count * elem_size > (uint64_t)st.st_size) {
+        fprintf(stderr, "Ошибка: некорректный заголовок бинарного массива %s\n", filename);
+        munmap(base, (size_t)st.st_size);
+        exit(EXIT_FAILURE);
+    }
+
+    // Данные читаются последовательно - подсказываем ядру упреждающее чтение
+    madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    mapped->base = base;
+    mapped->length = (size_t)st.st_size;
+    *size = (int)header->count;
+    return (char*)base + header->data_offset;
+}
+
+// Функция для загрузки массива: бинарный файл отображается в память,
+// при его отсутствии читается текстовый
+int* load_array(const char* bin_filename, const char* txt_filename, int* size, MappedArray* mapped) {
+    mapped->base = NULL;
+    mapped->length = 0;
+
+    int* arr = (int*)map_array_file(bin_filename, ARRAY_FILE_INT32, size, mapped);
+    if (!arr) {
+        arr = read_array_from_file(txt_filename, size);
+    }
+    return arr;
+}
+
+// Функция для освобождения массива, полученного через load_array
+void release_array(int* arr, MappedArray* mapped) {
+    if (mapped->base) {
+        munmap(mapped->base, mapped->length);
+    } else {
+        free(arr);
+    }
+}
+
+// Запас байтов, дочитываемый за границей своего диапазона текстового файла,
+// чтобы найти конец последнего числа (длиннее запаса числа быть не могут)
+#define TEXT_SLICE_OVERLAP 64
+
+// Наибольший объем одного вызова MPI_File_read_at_all (счетчик в MPI имеет тип int)
+#define TEXT_READ_CHUNK (1 << 30)
+
+// Функция для вычисления блочного распределения: первые remainder процессов
+// получают на один элемент больше
+void block_range(int global_size, int rank, int size, int* count, int* displ) {
+    int chunk_size = global_size / size;
+    int remainder = global_size % size;
+    *count = chunk_size + (rank < remainder ? 1 : 0);
+    *displ = rank * chunk_size + (rank < remainder ? rank : remainder);
+}
+
+// Функция для коллективного чтения своей части бинарного массива через MPI-IO.
+// Возвращает NULL, если файла нет
+int* read_binary_slice(const char* filename, int* global_size, int* local_size, int rank, int size) {
+    MPI_File fh;
+    if (MPI_File_open(MPI_COMM_WORLD, filename, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+        return NULL;
+    }
+
+    // Все процессы читают заголовок и проверяют его
+    ArrayFileHeader header;
+    MPI_Offset file_size;
+    MPI_File_get_size(fh, &file_size);
+    MPI_File_read_at_all(fh, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE);
+    if ((uint64_t)file_size < sizeof(header) ||
+        memcmp(header.magic, ARRAY_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.elem_type != ARRAY_FILE_INT32 ||
+        header.alignment == 0 || header.data_offset % header.alignment != 0 ||
+        header.count > INT_MAX ||
+        header.data_offset + header.count * sizeof(int32_t) > (uint64_t)file_size) {
+        if (rank == 0) {
+            fprintf(stderr, "Ошибка: некорректный заголовок бинарного массива %s\n", filename);
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // Каждый процесс читает только свой блок
+    int displ;
+    *global_size = (int)header.count;
+    block_range(*global_size, rank, size, local_size, &displ);
+    int* local_array = (int*)malloc((*local_size > 0 ? *local_size : 1) * sizeof(int));
+    if (!local_array) {
+        perror("Ошибка выделения памяти");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_Offset offset = (MPI_Offset)header.data_offset + (MPI_Offset)displ * (MPI_Offset)sizeof(int32_t);
+    MPI_File_read_at_all(fh, offset, local_array, *local_size, MPI_INT, MPI_STATUS_IGNORE);
+
+    MPI_File_close(&fh);
+    return local_array;
+}
+
+// Функция для перераспределения частей массива произвольного размера
+// в блочное распределение (один вызов MPI_Alltoallv; ненулевые части передаются
+// только процессам, чьи блоки пересекаются с частью отправителя)
+int* rebalance_to_blocks(int* parts, int part_size, int* global_size, int* local_size, int rank, int size) {
+    long long my_count = part_size, my_offset = 0, total = 0;
+    MPI_Exscan(&my_count, &my_offset, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0) {
+        my_offset = 0;
+    }
+    MPI_Allreduce(&my_count, &total, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    if (total > INT_MAX) {
+        if (rank == 0) {
+            fprintf(stderr, "Ошибка: слишком большой массив (%lld элементов)\n", total);
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    *global_size = (int)total;
+
+    // Смещения частей всех процессов нужны, чтобы понять, от кого получать данные
+    long long* offsets = (long long*)malloc((size + 1) * sizeof(long long));
+    int* sendcounts = (int*)calloc(size, sizeof(int));
+    int* sdispls = (int*)calloc(size, sizeof(int));
+    int* recvcounts = (int*)calloc(size, sizeof(int));
+    int* rdispls = (int*)calloc(size, sizeof(int));
+    if (!offsets || !sendcounts || !sdispls || !recvcounts || !rdispls) {
+        perror("Ошибка выделения памяти");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_Allgather(&my_offset, 1, MPI_LONG_LONG, offsets, 1, MPI_LONG_LONG, MPI_COMM_WORLD);
+    offsets[size] = total;
+
+    int my_displ;
+    block_range(*global_size, rank, size, local_size, &my_displ);
+    for (int j = 0; j < size; j++) {
+        // Пересечение моей части с блоком процесса j
+        int count, displ;
+        block_range(*global_size, j, size, &count, &displ);
+        long long lo = (my_offset > displ) ? my_offset : displ;
+        long long hi = (my_offset + my_count < displ + count) ? my_offset + my_count : displ + count;
+        if (hi > lo) {
+            sendcounts[j] = (int)(hi - lo);
+            sdispls[j] = (int)(lo - my_offset);
+        }
+
+        // Пересечение части процесса j с моим блоком
+        lo = (offsets[j] > my_displ) ? offsets[j] : my_displ;
+        hi = (offsets[j + 1] < my_displ + *local_size) ? offsets[j + 1] : my_displ + *local_size;
+        if (hi > lo) {
+            recvcounts[j] = (int)(hi - lo);
+            rdispls[j] = (int)(lo - my_displ);
+        }
+    }
+
+    int* local_array = (int*)malloc((*local_size > 0 ? *local_size : 1) * sizeof(int));
+    if (!local_array) {
+        perror("Ошибка выделения памяти");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_Alltoallv(parts, sendcounts, sdispls, MPI_INT,
+                  local_array, recvcounts, rdispls, MPI_INT, MPI_COMM_WORLD);
+
+    free(offsets);
+    free(sendcounts);
+    free(sdispls);
+    free(recvcounts);
+    free(rdispls);
+    return local_array;
+}
+
+// Функция для коллективного чтения своей части текстового файла через MPI-IO.
+// Файл делится на диапазоны байтов по числу процессов; число относится к процессу,
+// в диапазоне которого (после сдвига границ к разделителям) оно начинается
+int* read_text_slice(const char* filename, int* global_size, int* local_size, int rank, int size) {
+    MPI_File fh;
+    if (MPI_File_open(MPI_COMM_WORLD, filename, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+        if (rank == 0) {
+            fprintf(stderr, "Ошибка при открытии файла %s\n", filename);
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    MPI_Offset file_size;
+    MPI_File_get_size(fh, &file_size);
+    MPI_Offset begin = file_size / size * rank;
+    MPI_Offset end = (rank == size - 1) ? file_size : file_size / size * (rank + 1);
+    MPI_Offset read_end = (end + TEXT_SLICE_OVERLAP < file_size) ? end + TEXT_SLICE_OVERLAP : file_size;
+
+    // Читаем свой диапазон вместе с запасом. Диапазон может превышать INT_MAX байт,
+    // поэтому он читается порциями; число коллективных вызовов у всех процессов одинаково
+    size_t read_length = (size_t)(read_end - begin);
+    char* text = (char*)malloc(read_length > 0 ? read_length : 1);
+    if (!text) {
+        perror("Ошибка выделения памяти");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    long long my_rounds = (long long)((read_length + TEXT_READ_CHUNK - 1) / TEXT_READ_CHUNK), rounds = 0;
+    MPI_Allreduce(&my_rounds, &rounds, 1, MPI_LONG_LONG, MPI_MAX, MPI_COMM_WORLD);
+    size_t done = 0;
+    for (long long r = 0; r < rounds; r++) {
+        size_t chunk = read_length - done < TEXT_READ_CHUNK ? read_length - done : TEXT_READ_CHUNK;
+        MPI_File_read_at_all(fh, begin + (MPI_Offset)done, text + done, (int)chunk, MPI_CHAR, MPI_STATUS_IGNORE);
+        done += chunk;
+    }
+    MPI_File_close(&fh);
+
+    // Сдвигаем обе границы вперед до ближайшего разделителя
+    size_t local_begin = 0;
+    if (rank > 0) {
+        while (local_begin < read_length && !is_separator(text[local_begin])) {
+            local_begin++;
+        }
+    }
+    size_t local_end = (size_t)(end - begin);
+    if (rank < size - 1) {
+        while (local_end < read_length && !is_separator(text[local_end])) {
+            local_end++;
+        }
+    }
+    int failed = (local_end == read_length && read_end < file_size);
+    if (local_begin > local_end) {
+        local_begin = local_end;
+    }
+
+    int part_size = 0;
+    int* parts = NULL;
+    if (!failed) {
+        parts = parse_int_text_parallel(text + local_begin, local_end - local_begin, &part_size);
+        failed = (parts == NULL);
+    }
+    free(text);
+
+    int any_failed = 0;
+    MPI_Allreduce(&failed, &any_failed, 1, MPI_INT, MPI_LOR, MPI_COMM_WORLD);
+    if (any_failed) {
+        if (rank == 0) {
+            fprintf(stderr, "Ошибка при чтении чисел из файла %s\n", filename);
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // Части разного размера приводим к тому же блочному распределению, что и у бинарного файла
+    int* local_array = rebalance_to_blocks(parts, part_size, global_size, local_size, rank, size);
+    free(parts);
+    return local_array;
+}
+
+// Функция для распределенного чтения массива: каждый процесс читает только свою часть
+// (бинарный файл, если он есть, иначе текстовый), без рассылки с корневого процесса
+int* read_array_distributed(const char* bin_filename, const char* txt_filename,
+                            int* global_size, int* local_size, int rank, int size) {
+    int* local_array = read_binary_slice(bin_filename, global_size, local_size, rank, size);
+    if (!local_array) {
+        local_array = read_text_slice(txt_filename, global_size, local_size, rank, size);
+    }
+    return local_array;
+}
+
+// Ядро поэлементных операций: за один проход по входам вычисляет сумму, разность,
+// произведение и частное; при нулевом делителе в частное записывается zero_div_value
+typedef void (*elementwise_kernel_fn)(const int* arr1, const int* arr2,
+                                      double* result_add, double* result_sub,
+                                      double* result_mul, double* result_div,
+                                      long count, double zero_div_value);
+
+// Скалярное ядро (используется, если векторные расширения недоступны, и для хвостов)
+void elementwise_kernel_scalar(const int* arr1, const int* arr2,
+                               double* result_add, double* result_sub,
+                               double* result_mul, double* result_div,
+                               long count, double zero_div_value) {
+    for (long i = 0; i < count; i++) {
+        double a = arr1[i];
+        double b = arr2[i];
+        result_add[i] = a + b;
+        result_sub[i] = a - b;
+        result_mul[i] = a * b;
+        result_div[i] = (b != 0.0) ? a / b : zero_div_value;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// AVX2: по 4 элемента, нулевые делители заменяются через маску сравнения и blend
+__attribute__((target("avx2")))
+void elementwise_kernel_avx2(const int* arr1, const int* arr2,
+                             double* result_add, double* result_sub,
+                             double* result_mul, double* result_div,
+                             long count, double zero_div_value) {
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d fill = _mm256_set1_pd(zero_div_value);
+    long i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d a = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(arr1 + i)));
+        __m256d b = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(arr2 + i)));
+        __m256d is_zero = _mm256_cmp_pd(b, zero, _CMP_EQ_OQ);
+        _mm256_storeu_pd(result_add + i, _mm256_add_pd(a, b));
+        _mm256_storeu_pd(result_sub + i, _mm256_sub_pd(a, b));
+        _mm256_storeu_pd(result_mul + i, _mm256_mul_pd(a, b));
+        _mm256_storeu_pd(result_div + i, _mm256_blendv_pd(_mm256_div_pd(a, b), fill, is_zero));
+    }
+    elementwise_kernel_scalar(arr1 + i, arr2 + i, result_add + i, result_sub + i,
+                              result_mul + i, result_div + i, count - i, zero_div_value);
+}
+
+// AVX-512: по 8 элементов, деление выполняется только в линиях с ненулевым делителем
+__attribute__((target("avx512f")))
+void elementwise_kernel_avx512(const int* arr1, const int* arr2,
+                               double* result_add, double* result_sub,
+                               double* result_mul, double* result_div,
+                               long count, double zero_div_value) {
+    const __m512d zero = _mm512_setzero_pd();
+    const __m512d fill = _mm512_set1_pd(zero_div_value);
+    long i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m512d a = _mm512_cvtepi32_pd(_mm256_loadu_si256((const __m256i*)(arr1 + i)));
+        __m512d b = _mm512_cvtepi32_pd(_mm256_loadu_si256((const __m256i*)(arr2 + i)));
+        __mmask8 nonzero = _mm512_cmp_pd_mask(b, zero, _CMP_NEQ_UQ);
+        _mm512_storeu_pd(result_add + i, _mm512_add_pd(a, b));
+        _mm512_storeu_pd(result_sub + i, _mm512_sub_pd(a, b));
+        _mm512_storeu_pd(result_mul + i, _mm512_mul_pd(a, b));
+        _mm512_storeu_pd(result_div + i, _mm512_mask_div_pd(fill, nonzero, a, b));
+    }
+    elementwise_kernel_scalar(arr1 + i, arr2 + i, result_add + i, result_sub + i,
+                              result_mul + i, result_div + i, count - i, zero_div_value);
+}
+#endif
+
+// Функция для выбора лучшего ядра поэлементных операций по данным CPUID
+elementwise_kernel_fn select_elementwise_kernel(const char** name) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        *name = "AVX-512";
+        return elementwise_kernel_avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        *name = "AVX2";
+        return elementwise_kernel_avx2;
+    }
+#endif
+    *name = "скалярное";
+    return elementwise_kernel_scalar;
+}
+
+// Коммуникаторы двухуровневой схемы рассылки и сбора: процессы одного узла
+// (общая память) и лидеры узлов (процессы с номером 0 на своем узле)
+typedef struct {
+    MPI_Comm node;          // Процессы узла
+    MPI_Comm leaders;       // Лидеры узлов (MPI_COMM_NULL у остальных процессов)
+    int node_rank;          // Номер процесса на узле
+    int node_size;          // Число процессов на узле
+    int num_nodes;          // Число узлов
+    int hierarchical;       // 1, если есть несколько узлов и хотя бы на одном несколько процессов
+    int* members;           // Глобальные номера процессов узла
+    // Только на процессе 0: лидеры узлов и глобальные номера процессов каждого узла
+    int* leader_ranks;
+    int* node_offsets;      // Начало списка процессов узла в all_members (num_nodes + 1)
+    int* all_members;
+} NodeComms;
+
+// Функция для построения коммуникаторов узла и лидеров. Процессы упорядочены по
+// глобальному номеру, поэтому процесс 0 - лидер своего узла и лидер с номером 0
+void create_node_comms(NodeComms* nc, int rank, int size) {
+    memset(nc, 0, sizeof(*nc));
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &nc->node);
+    MPI_Comm_rank(nc->node, &nc->node_rank);
+    MPI_Comm_size(nc->node, &nc->node_size);
+    int is_leader = (nc->node_rank == 0);
+    MPI_Comm_split(MPI_COMM_WORLD, is_leader ? 0 : MPI_UNDEFINED, rank, &nc->leaders);
+    MPI_Allreduce(&is_leader, &nc->num_nodes, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    nc->hierarchical = (nc->num_nodes > 1 && nc->num_nodes < size);
+    if (!nc->hierarchical) {
+        return;
+    }
+    
+    nc->members = (int*)malloc(nc->node_size * sizeof(int));
+    if (rank == 0) {
+        nc->leader_ranks = (int*)malloc(nc->num_nodes * sizeof(int));
+        nc->node_offsets = (int*)malloc((nc->num_nodes + 1) * sizeof(int));
+        nc->all_members = (int*)malloc(size * sizeof(int));
+    }
+    if (!nc->members || (rank == 0 && (!nc->leader_ranks || !nc->node_offsets || !nc->all_members))) {
+        fprintf(stderr, "Ошибка выделения памяти для коммуникаторов узлов\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_Allgather(&rank, 1, MPI_INT, nc->members, 1, MPI_INT, nc->node);
+    
+    // Лидеры сообщают процессу 0 свой номер и состав своего узла
+    if (is_leader) {
+        int* node_sizes = NULL;
+        if (rank == 0) {
+            node_sizes = (int*)malloc(nc->num_nodes * sizeof(int));
+            if (!node_sizes) {
+                fprintf(stderr, "Ошибка выделения памяти для коммуникаторов узлов\n");
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+        }
+        MPI_Gather(&rank, 1, MPI_INT, nc->leader_ranks, 1, MPI_INT, 0, nc->leaders);
+        MPI_Gather(&nc->node_size, 1, MPI_INT, node_sizes, 1, MPI_INT, 0, nc->leaders);
+        if (rank == 0) {
+            nc->node_offsets[0] = 0;
+            for (int i = 0; i < nc->num_nodes; i++) {
+                nc->node_offsets[i + 1] = nc->node_offsets[i] + node_sizes[i];
+            }
+        }
+        MPI_Gatherv(nc->members, nc->node_size, MPI_INT,
+                    nc->all_members, node_sizes, nc->node_offsets, MPI_INT, 0, nc->leaders);
+        free(node_sizes);
+    }
+}
+
+// Функция для освобождения коммуникаторов двухуровневой схемы
+void free_node_comms(NodeComms* nc) {
+    if (nc->leaders != MPI_COMM_NULL) {
+        MPI_Comm_free(&nc->leaders);
+    }
+    MPI_Comm_free(&nc->node);
+    free(nc->members);
+    free(nc->leader_ranks);
+    free(nc->node_offsets);
+    free(nc->all_members);
+}
+
+// Тег сообщений между лидерами узлов и процессом 0
+#define NODE_TAG 25
+
+// Функция для вычисления размеров и смещений частей процессов узла в буфере лидера.
+// Возвращает общий размер частей узла
+int node_layout(const NodeComms* nc, const int* counts, int* node_counts, int* node_displs) {
+    int total = 0;
+    for (int i = 0; i < nc->node_size; i++) {
+        node_counts[i] = counts[nc->members[i]];
+        node_displs[i] = total;
+        total += node_counts[i];
+    }
+    return total;
+}
+
+// Функция для создания на процессе 0 типа, описывающего части процессов узла
+// в глобальном массиве: лидер передает их одним непрерывным сообщением
+MPI_Datatype node_indexed_type(const NodeComms* nc, int node, const int* counts, const int* displs,
+                               MPI_Datatype type) {
+    int first = nc->node_offsets[node];
+    int n = nc->node_offsets[node + 1] - first;
+    int* lengths = (int*)malloc(n * sizeof(int));
+    int* offsets = (int*)malloc(n * sizeof(int));
+    if (!lengths || !offsets) {
+        fprintf(stderr, "Ошибка выделения памяти для типа данных узла\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    for (int i = 0; i < n; i++) {
+        lengths[i] = counts[nc->all_members[first + i]];
+        offsets[i] = displs[nc->all_members[first + i]];
+    }
+    MPI_Datatype indexed;
+    MPI_Type_indexed(n, lengths, offsets, type, &indexed);
+    MPI_Type_commit(&indexed);
+    free(lengths);
+    free(offsets);
+    return indexed;
+}
+
+// Функция для выделения буфера лидера узла и таблиц частей процессов узла
+void* alloc_node_staging(const NodeComms* nc, const int* counts, MPI_Datatype type,
+                         int** node_counts, int** node_displs, int* total) {
+    MPI_Aint lb, extent;
+    MPI_Type_get_extent(type, &lb, &extent);
+    *node_counts = (int*)malloc(nc->node_size * sizeof(int));
+    *node_displs = (int*)malloc(nc->node_size * sizeof(int));
+    if (!*node_counts || !*node_displs) {
+        fprintf(stderr, "Ошибка выделения памяти для обмена внутри узла\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    *total = node_layout(nc, counts, *node_counts, *node_displs);
+    void* staging = malloc(*total > 0 ? (size_t)*total * extent : 1);
+    if (!staging) {
+        fprintf(stderr, "Ошибка выделения памяти для обмена внутри узла\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    return staging;
+}
+
+// Функция для двухуровневого сбора на процесс 0 (аналог MPI_Gatherv): процессы
+// узла собирают части у лидера через общую память, и между узлами идет одно
+// сообщение на узел. Процесс 0 принимает его сразу на места частей в recvbuf.
+// counts и displs должны быть известны всем процессам
+void hier_gatherv(const void* sendbuf, int sendcount, void* recvbuf,
+                  const int* counts, const int* displs, MPI_Datatype type, const NodeComms* nc) {
+    if (!nc->hierarchical) {
+        MPI_Gatherv(sendbuf, sendcount, type, recvbuf, counts, displs, type, 0, MPI_COMM_WORLD);
+        return;
+    }
+    
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (rank == 0) {
+        // Прием от лидеров других узлов, затем сбор своего узла прямо в recvbuf
+        MPI_Request* requests = (MPI_Request*)malloc(nc->num_nodes * sizeof(MPI_Request));
+        MPI_Datatype* types = (MPI_Datatype*)malloc(nc->num_nodes * sizeof(MPI_Datatype));
+        int* own_displs = (int*)malloc(nc->node_size * sizeof(int));
+        int* own_counts = (int*)malloc(nc->node_size * sizeof(int));
+        if (!requests || !types || !own_displs || !own_counts) {
+            fprintf(stderr, "Ошибка выделения памяти для сбора\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        for (int i = 1; i < nc->num_nodes; i++) {
+            types[i] = node_indexed_type(nc, i, counts, displs, type);
+            MPI_Irecv(recvbuf, 1, types[i], nc->leader_ranks[i], NODE_TAG, MPI_COMM_WORLD, &requests[i - 1]);
+        }
+        for (int i = 0; i < nc->node_size; i++) {
+            own_counts[i] = counts[nc->members[i]];
+            own_displs[i] = displs[nc->members[i]];
+        }
+        MPI_Gatherv(sendbuf, sendcount, type, recvbuf, own_counts, own_displs, type, 0, nc->node);
+        MPI_Waitall(nc->num_nodes - 1, requests, MPI_STATUSES_IGNORE);
+        for (int i = 1; i < nc->num_nodes; i++) {
+            MPI_Type_free(&types[i]);
+        }
+        free(requests);
+        free(types);
+        free(own_displs);
+        free(own_counts);
+    } else if (nc->node_rank == 0) {
+        // Лидер собирает части узла подряд и пересылает их одним сообщением
+        int *node_counts, *node_displs, total;
+        void* staging = alloc_node_staging(nc, counts, type, &node_counts, &node_displs, &total);
+        MPI_Gatherv(sendbuf, sendcount, type, staging, node_counts, node_displs, type, 0, nc->node);
+        MPI_Send(staging, total, type, 0, NODE_TAG, MPI_COMM_WORLD);
+        free(staging);
+        free(node_counts);
+        free(node_displs);
+    } else {
+        MPI_Gatherv(sendbuf, sendcount, type, NULL, NULL, NULL, type, 0, nc->node);
+    }
+}
+
+// Функция для двухуровневой рассылки с процесса 0 (аналог MPI_Scatterv): зеркальна
+// hier_gatherv - одно сообщение на узел, затем рассылка внутри узла
+void hier_scatterv(const void* sendbuf, const int* counts, const int* displs,
+                   void* recvbuf, int recvcount, MPI_Datatype type, const NodeComms* nc) {
+    if (!nc->hierarchical) {
+        MPI_Scatterv(sendbuf, counts, displs, type, recvbuf, recvcount, type, 0, MPI_COMM_WORLD);
+        return;
+    }
+    
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (rank == 0) {
+        MPI_Request* requests = (MPI_Request*)malloc(nc->num_nodes * sizeof(MPI_Request));
+        MPI_Datatype* types = (MPI_Datatype*)malloc(nc->num_nodes * sizeof(MPI_Datatype));
+        int* own_displs = (int*)malloc(nc->node_size * sizeof(int));
+        int* own_counts = (int*)malloc(nc->node_size * sizeof(int));
+        if (!requests || !types || !own_displs || !own_counts) {
+            fprintf(stderr, "Ошибка выделения памяти для рассылки\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        for (int i = 1; i < nc->num_nodes; i++) {
+            types[i] = node_indexed_type(nc, i, counts, displs, type);
+            MPI_Isend(sendbuf, 1, types[i], nc->leader_ranks[i], NODE_TAG, MPI_COMM_WORLD, &requests[i - 1]);
+        }
+        for (int i = 0; i < nc->node_size; i++) {
+            own_counts[i] = counts[nc->members[i]];
+            own_displs[i] = displs[nc->members[i]];
+        }
+        MPI_Scatterv(sendbuf, own_counts, own_displs, type, recvbuf, recvcount, type, 0, nc->node);
+        MPI_Waitall(nc->num_nodes - 1, requests, MPI_STATUSES_IGNORE);
+        for (int i = 1; i < nc->num_nodes; i++) {
+            MPI_Type_free(&types[i]);
+        }
+        free(requests);
+        free(types);
+        free(own_displs);
+        free(own_counts);
+    } else if (nc->node_rank == 0) {
+        // Лидер принимает части своего узла одним сообщением и раздает их
+        int *node_counts, *node_displs, total;
+        void* staging = alloc_node_staging(nc, counts, type, &node_counts, &node_displs, &total);
+        MPI_Recv(staging, total, type, 0, NODE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        MPI_Scatterv(staging, node_counts, node_displs, type, recvbuf, recvcount, type, 0, nc->node);
+        free(staging);
+        free(node_counts);
+        free(node_displs);
+    } else {
+        MPI_Scatterv(NULL, NULL, NULL, type, recvbuf, recvcount, type, 0, nc->node);
+    }
+}
+
+// Максимальное число запрашиваемых выходов
+#define MAX_OUTPUTS 8
+
+// Ограничения на программу одного выражения: число операций и глубина стека
+#define EXPR_MAX_OPS 64
+#define EXPR_MAX_DEPTH 16
+
+// Размер блока элементов при вычислении выражений (стек блока помещается в кэш L1/L2)
+#define EXPR_BLOCK 256
+
+// Операции программы выражения (обратная польская запись)
+typedef enum {
+    EXPR_LOAD_A,
+    EXPR_LOAD_B,
+    EXPR_CONST,
+    EXPR_ADD,
+    EXPR_SUB,
+    EXPR_MUL,
+    EXPR_DIV,
+    EXPR_NEG
+} ExprOpCode;
+
+typedef struct {
+    ExprOpCode code;
+    double value;
+} ExprOp;
+
+// Скомпилированное выражение над элементами a и b: исходный текст и программа
+typedef struct {
+    const char* text;
+    ExprOp ops[EXPR_MAX_OPS];
+    int count;
+} Expression;
+
+// Состояние разбора выражения
+typedef struct {
+    const char* p;
+    Expression* expr;
+    int depth;
+    int ok;
+} ExprParser;
+
+// Функция для добавления операции в программу с учетом глубины стека
+void expr_emit(ExprParser* parser, ExprOpCode code, double value) {
+    if (parser->expr->count >= EXPR_MAX_OPS) {
+        parser->ok = 0;
+        return;
+    }
+    parser->expr->ops[parser->expr->count].code = code;
+    parser->expr->ops[parser->expr->count].value = value;
+    parser->expr->count++;
+    
+    if (code == EXPR_LOAD_A || code == EXPR_LOAD_B || code == EXPR_CONST) {
+        if (++parser->depth > EXPR_MAX_DEPTH) {
+            parser->ok = 0;
+        }
+    } else if (code != EXPR_NEG) {
+        parser->depth--;
+    }
+}
+
+// Функция для пропуска пробелов в выражении
+void expr_skip_spaces(ExprParser* parser) {
+    while (*parser->p == ' ' || *parser->p == '\t') {
+        parser->p++;
+    }
+}
+
+void parse_expr_sum(ExprParser* parser);
+
+// Функция для разбора множителя: число, a, b, унарный минус или выражение в скобках
+void parse_expr_factor(ExprParser* parser) {
+    expr_skip_spaces(parser);
+    char c = *parser->p;
+    
+    if (c == '-') {
+        parser->p++;
+        parse_expr_factor(parser);
+        expr_emit(parser, EXPR_NEG, 0.0);
+    } else if (c == '(') {
+        parser->p++;
+        parse_expr_sum(parser);
+        expr_skip_spaces(parser);
+        if (*parser->p != ')') {
+            parser->ok = 0;
+            return;
+        }
+        parser->p++;
+    } else if ((c == 'a' || c == 'b') && !isalnum((unsigned char)parser->p[1])) {
+        parser->p++;
+        expr_emit(parser, c == 'a' ? EXPR_LOAD_A : EXPR_LOAD_B, 0.0);
+    } else if (isdigit((unsigned char)c) || c == '.') {
+        char* end;
+        double value = strtod(parser->p, &end);
+        if (end == parser->p) {
+            parser->ok = 0;
+            return;
+        }
+        parser->p = end;
+        expr_emit(parser, EXPR_CONST, value);
+    } else {
+        parser->ok = 0;
+    }
+}
+
+// Функция для разбора произведения множителей (операции * и /)
+void parse_expr_product(ExprParser* parser) {
+    parse_expr_factor(parser);
+    while (parser->ok) {
+        expr_skip_spaces(parser);
+        char op = *parser->p;
+        if (op != '*' && op != '/') {
+            break;
+        }
+        parser->p++;
+        parse_expr_factor(parser);
+        expr_emit(parser, op == '*' ? EXPR_MUL : EXPR_DIV, 0.0);
+    }
+}
+
+// Функция для разбора суммы слагаемых (операции + и -)
+void parse_expr_sum(ExprParser* parser) {
+    parse_expr_product(parser);
+    while (parser->ok) {
+        expr_skip_spaces(parser);
+        char op = *parser->p;
+        if (op != '+' && op != '-') {
+            break;
+        }
+        parser->p++;
+        parse_expr_product(parser);
+        expr_emit(parser, op == '+' ? EXPR_ADD : EXPR_SUB, 0.0);
+    }
+}
+
+// Функция для компиляции выражения в программу. Помимо формул над a и b
+// понимает имена add, sub, mul и div. Возвращает 0 при ошибке в выражении
+int compile_expression(const char* text, Expression* expr) {
+    static const char* aliases[][2] = {
+        {"add", "a + b"}, {"sub", "a - b"}, {"mul", "a * b"}, {"div", "a / b"}
+    };
+    const char* source = text;
+    for (size_t i = 0; i < sizeof(aliases) / sizeof(aliases[0]); i++) {
+        if (strcmp(text, aliases[i][0]) == 0) {
+            source = aliases[i][1];
+        }
+    }
+    
+    expr->text = text;
+    expr->count = 0;
+    ExprParser parser = {source, expr, 0, 1};
+    parse_expr_sum(&parser);
+    expr_skip_spaces(&parser);
+    return parser.ok && *parser.p == '\0' && parser.depth == 1;
+}
+
+// Функция для вычисления выражения над блоком из count <= EXPR_BLOCK элементов.
+// Каждая операция выполняется векторизуемым циклом по всему блоку, промежуточные
+// значения хранятся в стеке блоков, последняя операция пишет сразу в out.
+// При нулевом делителе результатом деления становится zero_div_value
+void eval_expression_block(const Expression* expr, const double* a, const double* b,
+                           double* out, int count, double zero_div_value) {
+    double stack[EXPR_MAX_DEPTH][EXPR_BLOCK];
+    const double* operand[EXPR_MAX_DEPTH];
+    int sp = 0;
+    
+    // Слот стека i хранит указатель на a, b или на блок stack[i]
+    for (int k = 0; k < expr->count; k++) {
+        const ExprOp* op = &expr->ops[k];
+        int last = (k == expr->count - 1);
+        
+        if (op->code == EXPR_LOAD_A || op->code == EXPR_LOAD_B) {
+            operand[sp++] = (op->code == EXPR_LOAD_A) ? a : b;
+        } else if (op->code == EXPR_CONST) {
+            double* dst = last ? out : stack[sp];
+            for (int j = 0; j < count; j++) {
+                dst[j] = op->value;
+            }
+            operand[sp++] = dst;
+        } else if (op->code == EXPR_NEG) {
+            double* dst = last ? out : stack[sp - 1];
+            const double* x = operand[sp - 1];
+            for (int j = 0; j < count; j++) {
+                dst[j] = -x[j];
+            }
+            operand[sp - 1] = dst;
+        } else {
+            double* dst = last ? out : stack[sp - 2];
+            const double* x = operand[sp - 2];
+            const double* y = operand[sp - 1];
+            switch (op->code) {
+                case EXPR_ADD:
+                    for (int j = 0; j < count; j++) {
+                        dst[j] = x[j] + y[j];
+                    }
+                    break;
+                case EXPR_SUB:
+                    for (int j = 0; j < count; j++) {
+                        dst[j] = x[j] - y[j];
+                    }
+                    break;
+                case EXPR_MUL:
+                    for (int j = 0; j < count; j++) {
+                        dst[j] = x[j] * y[j];
+                    }
+                    break;
+                default:
+                    // Частное считается всегда и заменяется выбором без ветвления
+                    for (int j = 0; j < count; j++) {
+                        double quotient = x[j] / y[j];
+                        dst[j] = (y[j] != 0.0) ? quotient : zero_div_value;
+                    }
+                    break;
+            }
+            operand[sp - 2] = dst;
+            sp--;
+        }
+    }
+    
+    // Выражение из одной переменной: результат еще не записан в out
+    if (operand[0] != out) {
+        memcpy(out, operand[0], count * sizeof(double));
+    }
+}
+
+// Функция для вычисления четырех операций над локальными частями всеми OpenMP-потоками
+// процесса: каждый поток обрабатывает выбранным ядром свой непрерывный диапазон
+void elementwise_parallel(elementwise_kernel_fn kernel, const int* arr1, const int* arr2,
+                          double* result_add, double* result_sub,
+                          double* result_mul, double* result_div,
+                          long count, double zero_div_value) {
+    #pragma omp parallel
+    {
+#ifdef _OPENMP
+        int thread = omp_get_thread_num();
+        int threads = omp_get_num_threads();
+#else
+        int thread = 0;
+        int threads = 1;
+#endif
+        long begin = count * thread / threads;
+        long end = count * (thread + 1) / threads;
+        kernel(arr1 + begin, arr2 + begin, result_add + begin, result_sub + begin,
+               result_mul + begin, result_div + begin, end - begin, zero_div_value);
+    }
+}
+
+// Функция для вычисления запрошенных выражений над локальными частями массивов.
+// Входы читаются один раз: каждый блок преобразуется в double
+// и по нему сразу вычисляются все выражения
+void evaluate_expressions(const int* arr1, const int* arr2, int size,
+                          const Expression* exprs, int num_exprs, double** outputs) {
+    // Блоки независимы и распределяются между OpenMP-потоками процесса
+    #pragma omp parallel for schedule(static)
+    for (int begin = 0; begin < size; begin += EXPR_BLOCK) {
+        double a[EXPR_BLOCK], b[EXPR_BLOCK];
+        int count = (size - begin < EXPR_BLOCK) ? size - begin : EXPR_BLOCK;
+        for (int j = 0; j < count; j++) {
+            a[j] = arr1[begin + j];
+            b[j] = arr2[begin + j];
+        }
+        for (int k = 0; k < num_exprs; k++) {
+            // Деление на ноль дает 0, как и в основном ядре
+            eval_expression_block(&exprs[k], a, b, outputs[k] + begin, count, 0.0);
+        }
+    }
+}
+
 // Функция для вывода первых N элементов массива
 void print_array_sample(const double* arr, int total_size, int sample_size, const char* label, int rank) {
     if (rank != 0) return; // Выводим только на процессе 0
@@ -63,122 +1112,178 @@ void print_array_sample(const double* arr, int total_size, int sample_size, cons
 
 int main(int argc, char* argv[]) {
     int rank, size;
-    double *array1 = NULL, *array2 = NULL;
-    double *local_array1 = NULL, *local_array2 = NULL;
-    double *local_result_add = NULL, *local_result_sub = NULL;
-    double *local_result_mul = NULL, *local_result_div = NULL;
-    double *result_add = NULL, *result_sub = NULL, *result_mul = NULL, *result_div = NULL;
+    int *array1 = NULL, *array2 = NULL;
+    int *local_array1 = NULL, *local_array2 = NULL;
+    MappedArray mapped1, mapped2;
+    double *local_outputs[MAX_OUTPUTS] = {NULL}, *outputs[MAX_OUTPUTS] = {NULL};
     int global_size = 0, local_size = 0;
     double start_time, end_time, compute_time = 0, comm_time = 0;
+    double read_start, read_time;
     
-    // Инициализация MPI
-    MPI_Init(&argc, &argv);
+    // Инициализация MPI для гибридного режима: локальные вычисления выполняют
+    // OpenMP-потоки процесса, MPI вызывается только из главного потока
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
+    if (provided < MPI_THREAD_FUNNELED) {
+        if (rank == 0) {
+            fprintf(stderr, "Предупреждение: MPI не поддерживает MPI_THREAD_FUNNELED, "
+                            "используется один поток на процесс\n");
+        }
+#ifdef _OPENMP
+        omp_set_num_threads(1);
+#endif
+    }
+    
+    // Режим чтения: distributed (по умолчанию) - каждый процесс читает только свою часть файлов,
+    // root - процесс 0 читает массивы целиком и рассылает части через MPI_Scatterv.
+    // Остальные аргументы - запрошенные выражения; без них вычисляются add, sub, mul и div
+    int root_read = 0;
+    Expression exprs[MAX_OUTPUTS];
+    int num_exprs = 0;
+    int args_ok = 1;
+    for (int i = 1; i < argc && args_ok; i++) {
+        if (strcmp(argv[i], "root") == 0) {
+            root_read = 1;
+        } else if (strcmp(argv[i], "distributed") == 0) {
+            root_read = 0;
+        } else if (num_exprs == MAX_OUTPUTS || !compile_expression(argv[i], &exprs[num_exprs++])) {
+            args_ok = 0;
+            if (rank == 0) {
+                printf("Некорректное выражение или больше %d выражений: %s\n", MAX_OUTPUTS, argv[i]);
+            }
+        }
+    }
+    if (!args_ok) {
+        if (rank == 0) {
+            printf("Использование: %s [root|distributed] [выражение ...]\n", argv[0]);
+            printf("Выражения над элементами a и b: add, sub, mul, div или формулы вида \"a*b + a\"\n");
+        }
+        MPI_Finalize();
+        return 1;
+    }
+    int num_outputs = num_exprs > 0 ? num_exprs : 4;
+    
+    // Выбираем ядро поэлементных операций по возможностям процессора
+    const char* kernel_name;
+    elementwise_kernel_fn elementwise_kernel = select_elementwise_kernel(&kernel_name);
     
     if (rank == 0) {
         printf("=== ПАРАЛЛЕЛЬНАЯ ВЕРСИЯ ===\n");
-        
-        // Чтение массивов из файлов (только процесс 0)
-        array1 = read_array_from_file("array1.txt", &global_size);
-        array2 = read_array_from_file("array2.txt", &local_size); // Используем local_size как временную переменную
-        
+    }
+    
+    // Коммуникаторы узлов для двухуровневой рассылки и сбора
+    NodeComms node_comms;
+    create_node_comms(&node_comms, rank, size);
+    
+    MPI_Barrier(MPI_COMM_WORLD);
+    read_start = MPI_Wtime();
+    
+    int size2 = 0;
+    if (root_read) {
+        if (rank == 0) {
+            // Загрузка массивов (только процесс 0): *.bin отображаются в память, иначе читаются *.txt
+            array1 = load_array("array1.bin", "array1.txt", &global_size, &mapped1);
+            array2 = load_array("array2.bin", "array2.txt", &size2, &mapped2);
+        }
+    } else {
+        // Каждый процесс читает свой блок обоих массивов
+        local_array1 = read_array_distributed("array1.bin", "array1.txt",
+                                              &global_size, &local_size, rank, size);
+        local_array2 = read_array_distributed("array2.bin", "array2.txt",
+                                              &size2, &local_size, rank, size);
+    }
+    
+    if (rank == 0) {
         // Проверка размеров массивов
-        if (global_size != local_size) {
+        if (global_size != size2) {
             fprintf(stderr, "Ошибка: массивы имеют разный размер (%d и %d)\n", 
-                    global_size, local_size);
+                    global_size, size2);
             MPI_Abort(MPI_COMM_WORLD, 1);
         }
         
+        printf("Режим чтения: %s\n", root_read ? "процесс 0 + MPI_Scatterv" : "распределенный (MPI-IO)");
         printf("Размер массивов: %d элементов\n", global_size);
         printf("Используется %d процессов\n", size);
+        if (node_comms.hierarchical) {
+            printf("Рассылка и сбор: двухуровневые (%d узлов)\n", node_comms.num_nodes);
+        }
+#ifdef _OPENMP
+        printf("OpenMP-потоков на процесс: %d\n", omp_get_max_threads());
+#endif
+        if (num_exprs > 0) {
+            printf("Выражений: %d (вычисляются за один проход)\n", num_exprs);
+        } else {
+            printf("Ядро операций: %s\n", kernel_name);
+        }
     }
     
     // Синхронизация перед началом работы
     MPI_Barrier(MPI_COMM_WORLD);
+    read_time = MPI_Wtime() - read_start;
     start_time = MPI_Wtime();
     
     // Рассылаем размер массивов всем процессам
     MPI_Bcast(&global_size, 1, MPI_INT, 0, MPI_COMM_WORLD);
     
-    // Вычисляем размер локальной части для каждого процесса
-    local_size = global_size / size;
-    int remainder = global_size % size;
-    
     // Массивы для хранения размеров и смещений
     int* recvcounts = (int*)malloc(size * sizeof(int));
     int* displs = (int*)malloc(size * sizeof(int));
     
-    // Вычисляем размеры частей и смещения
-    int offset = 0;
+    // Вычисляем размеры частей и смещения (то же блочное распределение, что и при чтении)
     for (int i = 0; i < size; i++) {
-        recvcounts[i] = global_size / size + (i < remainder ? 1 : 0);
-        displs[i] = offset;
-        offset += recvcounts[i];
+        block_range(global_size, i, size, &recvcounts[i], &displs[i]);
     }
     
     // Обновляем локальный размер для текущего процесса
     local_size = recvcounts[rank];
     
-    // Выделяем память под локальные части массивов
-    local_array1 = (double*)malloc(local_size * sizeof(double));
-    local_array2 = (double*)malloc(local_size * sizeof(double));
-    
-    // Распределяем данные между процессами
-    MPI_Scatterv(array1, recvcounts, displs, MPI_DOUBLE,
-                local_array1, local_size, MPI_DOUBLE,
-                0, MPI_COMM_WORLD);
-    
-    MPI_Scatterv(array2, recvcounts, displs, MPI_DOUBLE,
-                local_array2, local_size, MPI_DOUBLE,
-                0, MPI_COMM_WORLD);
+    if (root_read) {
+        // Выделяем память под локальные части массивов
+        local_array1 = (int*)malloc(local_size * sizeof(int));
+        local_array2 = (int*)malloc(local_size * sizeof(int));
+        
+        // Распределяем данные между процессами (на многоузловом запуске - одно сообщение на узел)
+        hier_scatterv(array1, recvcounts, displs, local_array1, local_size, MPI_INT, &node_comms);
+        hier_scatterv(array2, recvcounts, displs, local_array2, local_size, MPI_INT, &node_comms);
+    }
     
-    // Выделяем память под результаты
-    local_result_add = (double*)malloc(local_size * sizeof(double));
-    local_result_sub = (double*)malloc(local_size * sizeof(double));
-    local_result_mul = (double*)malloc(local_size * sizeof(double));
-    local_result_div = (double*)malloc(local_size * sizeof(double));
+    // Выделяем память только под запрошенные результаты
+    for (int k = 0; k < num_outputs; k++) {
+        local_outputs[k] = (double*)malloc(local_size * sizeof(double));
+    }
     
     // Выполняем вычисления над локальными частями
     double compute_start = MPI_Wtime();
     
-    for (int i = 0; i < local_size; i++) {
-        local_result_add[i] = local_array1[i] + local_array2[i];
-        local_result_sub[i] = local_array1[i] - local_array2[i];
-        local_result_mul[i] = local_array1[i] * local_array2[i];
-        // Проверка деления на ноль
-        local_result_div[i] = (local_array2[i] != 0) ? 
-                             (local_array1[i] / local_array2[i]) : 0;
+    if (num_exprs > 0) {
+        // Запрошенные выражения вычисляются за один проход по локальным частям
+        evaluate_expressions(local_array1, local_array2, local_size, exprs, num_exprs, local_outputs);
+    } else {
+        // Деление на ноль дает 0
+        elementwise_parallel(elementwise_kernel, local_array1, local_array2,
+                             local_outputs[0], local_outputs[1],
+                             local_outputs[2], local_outputs[3],
+                             local_size, 0.0);
     }
     
     compute_time = MPI_Wtime() - compute_start;
     
     // Собираем результаты на процессе 0
     if (rank == 0) {
-        result_add = (double*)malloc(global_size * sizeof(double));
-        result_sub = (double*)malloc(global_size * sizeof(double));
-        result_mul = (double*)malloc(global_size * sizeof(double));
-        result_div = (double*)malloc(global_size * sizeof(double));
+        for (int k = 0; k < num_outputs; k++) {
+            outputs[k] = (double*)malloc(global_size * sizeof(double));
+        }
     }
     
     double comm_start = MPI_Wtime();
     
     // Собираем результаты на процессе 0
-    MPI_Gatherv(local_result_add, local_size, MPI_DOUBLE,
-               result_add, recvcounts, displs, MPI_DOUBLE,
-               0, MPI_COMM_WORLD);
-    
-    MPI_Gatherv(local_result_sub, local_size, MPI_DOUBLE,
-               result_sub, recvcounts, displs, MPI_DOUBLE,
-               0, MPI_COMM_WORLD);
-    
-    MPI_Gatherv(local_result_mul, local_size, MPI_DOUBLE,
-               result_mul, recvcounts, displs, MPI_DOUBLE,
-               0, MPI_COMM_WORLD);
-    
-    MPI_Gatherv(local_result_div, local_size, MPI_DOUBLE,
-               result_div, recvcounts, displs, MPI_DOUBLE,
-               0, MPI_COMM_WORLD);
+    for (int k = 0; k < num_outputs; k++) {
+        hier_gatherv(local_outputs[k], local_size, outputs[k], recvcounts, displs,
+                     MPI_DOUBLE, &node_comms);
+    }
     
     comm_time = MPI_Wtime() - comm_start;
     
@@ -188,36 +1293,39 @@ int main(int argc, char* argv[]) {
     
     // Вывод результатов на процессе 0
     if (rank == 0) {
+        printf("Время чтения входных данных: %.6f секунд\n", read_time);
         printf("Время выполнения: %.6f секунд\n", end_time - start_time);
         printf("  - Время вычислений: %.6f секунд\n", compute_time);
         printf("  - Время обмена данными: %.6f секунд\n", comm_time);
         
         // Выводим образцы результатов
+        static const char* default_labels[] = {"Сумма", "Разность", "Произведение", "Частное"};
         int sample_size = 20;
-        print_array_sample(result_add, global_size, sample_size, "Сумма", rank);
-        print_array_sample(result_sub, global_size, sample_size, "Разность", rank);
-        print_array_sample(result_mul, global_size, sample_size, "Произведение", rank);
-        print_array_sample(result_div, global_size, sample_size, "Частное", rank);
+        for (int k = 0; k < num_outputs; k++) {
+            print_array_sample(outputs[k], global_size, sample_size,
+                               num_exprs > 0 ? exprs[k].text : default_labels[k], rank);
+        }
     }
     
     // Освобождаем память
     if (rank == 0) {
-        free(array1);
-        free(array2);
-        free(result_add);
-        free(result_sub);
-        free(result_mul);
-        free(result_div);
+        if (root_read) {
+            release_array(array1, &mapped1);
+            release_array(array2, &mapped2);
+        }
+        for (int k = 0; k < num_outputs; k++) {
+            free(outputs[k]);
+        }
     }
     
     free(local_array1);
     free(local_array2);
-    free(local_result_add);
-    free(local_result_sub);
-    free(local_result_mul);
-    free(local_result_div);
+    for (int k = 0; k < num_outputs; k++) {
+        free(local_outputs[k]);
+    }
     free(recvcounts);
     free(displs);
+    free_node_comms(&node_comms);
     
     // Завершаем MPI
     MPI_Finalize();
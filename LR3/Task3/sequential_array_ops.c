@@ -2,6 +2,13 @@
 #include <stdlib.h>
 #include <time.h>
 #include <math.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 // Функция для чтения массива из файла
 int* read_array_from_file(const char* filename, int* size) {
@@ -44,6 +51,92 @@ int* read_array_from_file(const char* filename, int* size) {
     return arr;
 }
 
+// Бинарный формат массива: заголовок ArrayFileHeader, затем сырые данные,
+// начинающиеся со смещения data_offset (кратного alignment)
+#define ARRAY_FILE_MAGIC "PCSARR01"
+#define ARRAY_FILE_INT32 1
+#define ARRAY_FILE_FLOAT64 2
+
+typedef struct {
+    char magic[8];          // Сигнатура ARRAY_FILE_MAGIC
+    uint32_t elem_type;     // Тип элементов (ARRAY_FILE_INT32 / ARRAY_FILE_FLOAT64)
+    uint32_t alignment;     // Выравнивание начала данных в байтах
+    uint64_t count;         // Количество элементов
+    uint64_t data_offset;   // Смещение данных от начала файла
+} ArrayFileHeader;
+
+// Отображение бинарного файла в память
+typedef struct {
+    void* base;             // Начало отображения (NULL, если массив прочитан из текста)
+    size_t length;          // Длина отображения в байтах
+} MappedArray;
+
+// Функция для отображения бинарного массива в память (без разбора и копирования).
+// Возвращает указатель на данные или NULL, если файла нет
+void* map_array_file(const char* filename, uint32_t elem_type, int* size, MappedArray* mapped) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ArrayFileHeader)) {
+        fprintf(stderr, "Ошибка: файл %s не является бинарным массивом\n", filename);
+        exit(EXIT_FAILURE);
+    }
+
+    // Закрытое отображение с правом записи: страницы копируются только при изменении
+    void* base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("Ошибка отображения файла в память");
+        exit(EXIT_FAILURE);
+    }
+
+    // Проверка заголовка
+    const ArrayFileHeader* header = (const ArrayFileHeader*)base;
+    size_t elem_size = (elem_type == ARRAY_FILE_INT32) ? sizeof(int32_t) : sizeof(double);
+    if (memcmp(header->magic, ARRAY_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->elem_type != elem_type ||
+        header->alignment == 0 || header->data_offset % header->alignment != 0 ||
+        header->count > INT_MAX ||
+        header->data_offset + header->count * elem_size > (uint64_t)st.st_size) {
+        fprintf(stderr, "Ошибка: некорректный заголовок бинарного массива %s\n", filename);
+        munmap(base, (size_t)st.st_size);
+        exit(EXIT_FAILURE);
+    }
+
+    // Данные читаются последовательно - подсказываем ядру упреждающее чтение
+    madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    mapped->base = base;
+    mapped->length = (size_t)st.st_size;
+    *size = (int)header->count;
+    return (char*)base + header->data_offset;
+}
+
+// Функция для загрузки массива: бинарный файл отображается в память,
+// при его отсутствии читается текстовый
+int* load_array(const char* bin_filename, const char* txt_filename, int* size, MappedArray* mapped) {
+    mapped->base = NULL;
+    mapped->length = 0;
+
+    int* arr = (int*)map_array_file(bin_filename, ARRAY_FILE_INT32, size, mapped);
+    if (!arr) {
+        arr = read_array_from_file(txt_filename, size);
+    }
+    return arr;
+}
+
+// Функция для освобождения массива, полученного через load_array
+void release_array(int* arr, MappedArray* mapped) {
+    if (mapped->base) {
+        munmap(mapped->base, mapped->length);
+    } else {
+        free(arr);
+    }
+}
+
 // Функция для выполнения операций над массивами
 void perform_operations(const int* arr1, const int* arr2, 
                        double* result_add, double* result_sub, 
@@ -90,16 +183,17 @@ int main() {
     
     // Чтение первого массива из файла
     start = clock();
-    int* array1 = read_array_from_file("array1.txt", &size1);
+    MappedArray mapped1, mapped2;
+    int* array1 = load_array("array1.bin", "array1.txt", &size1, &mapped1);
     
     // Чтение второго массива из файла
-    int* array2 = read_array_from_file("array2.txt", &size2);
+    int* array2 = load_array("array2.bin", "array2.txt", &size2, &mapped2);
     
     // Проверка, что массивы одного размера
     if (size1 != size2) {
         fprintf(stderr, "Ошибка: массивы имеют разный размер (%d и %d)\n", size1, size2);
-        free(array1);
-        free(array2);
+        release_array(array1, &mapped1);
+        release_array(array2, &mapped2);
         return 1;
     }
     
@@ -113,8 +207,8 @@ int main() {
     
     if (!result_add || !result_sub || !result_mul || !result_div) {
         perror("Ошибка выделения памяти для результатов");
-        free(array1);
-        free(array2);
+        release_array(array1, &mapped1);
+        release_array(array2, &mapped2);
         free(result_add);
         free(result_sub);
         free(result_mul);
@@ -143,8 +237,8 @@ int main() {
     printf("\n");
     
     // Освобождение памяти
-    free(array1);
-    free(array2);
+    release_array(array1, &mapped1);
+    release_array(array2, &mapped2);
     free(result_add);
     free(result_sub);
     free(result_mul);
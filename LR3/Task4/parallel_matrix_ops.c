@@ -1,114 +1,704 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <mpi.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include <time.h>
 #include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-// Структура для хранения информации о матрице
+// Выравнивание начала матрицы и каждой ее строки в байтах
+#define MATRIX_ALIGNMENT 64
+
+// Структура для хранения информации о матрице: один непрерывный выровненный блок,
+// строка i начинается с элемента data[i * stride]
 typedef struct {
-    double** data;
+    double* data;
     int rows;
     int cols;
+    int stride;     // Шаг между строками в элементах (cols, дополненный до MATRIX_ALIGNMENT)
 } Matrix;
 
 // Функция для создания матрицы
-double** create_matrix(int rows, int cols) {
-    double** matrix = (double**)malloc(rows * sizeof(double*));
-    for (int i = 0; i < rows; i++) {
-        matrix[i] = (double*)malloc(cols * sizeof(double));
+Matrix create_matrix(int rows, int cols) {
+    Matrix matrix;
+    int per_line = MATRIX_ALIGNMENT / sizeof(double);
+    matrix.rows = rows;
+    matrix.cols = cols;
+    matrix.stride = (cols + per_line - 1) / per_line * per_line;
+    
+    size_t bytes = (size_t)rows * matrix.stride * sizeof(double);
+    if (posix_memalign((void**)&matrix.data, MATRIX_ALIGNMENT, bytes > 0 ? bytes : MATRIX_ALIGNMENT) != 0) {
+        perror("Ошибка выделения памяти для матрицы");
+        MPI_Abort(MPI_COMM_WORLD, 1);
     }
     return matrix;
 }
 
 // Функция для освобождения памяти матрицы
-void free_matrix(double** matrix, int rows) {
-    for (int i = 0; i < rows; i++) {
-        free(matrix[i]);
+void free_matrix(Matrix* matrix) {
+    free(matrix->data);
+    matrix->data = NULL;
+}
+
+// Функция для получения указателя на строку матрицы
+static inline double* matrix_row(Matrix matrix, int i) {
+    return matrix.data + (size_t)i * matrix.stride;
+}
+
+// Функция для проверки, является ли символ разделителем чисел
+static inline int is_separator(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Функция для разбиения текста на диапазоны байтов по числу потоков.
+// Границы сдвигаются вперед до ближайшего разделителя, чтобы не разрезать числа
+void split_text_ranges(const char* text, size_t length, int parts, size_t* bounds) {
+    bounds[0] = 0;
+    for (int i = 1; i < parts; i++) {
+        size_t b = length / parts * i;
+        if (b < bounds[i - 1]) {
+            b = bounds[i - 1];
+        }
+        while (b < length && !is_separator(text[b])) {
+            b++;
+        }
+        bounds[i] = b;
     }
-    free(matrix);
+    bounds[parts] = length;
 }
 
-// Функция для чтения матрицы из файла
-Matrix read_matrix_from_file(const char* filename) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
+// Функция для отображения текстового файла в память только для чтения
+const char* map_text_file(const char* filename, size_t* length) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
         perror("Ошибка при открытии файла");
         exit(EXIT_FAILURE);
     }
 
-    // Читаем размеры матрицы
-    int rows, cols;
-    if (fscanf(file, "%d %d", &rows, &cols) != 2) {
-        fprintf(stderr, "Ошибка при чтении размеров матрицы из файла\n");
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror("Ошибка при получении размера файла");
+        close(fd);
         exit(EXIT_FAILURE);
     }
 
-    // Создаем матрицу
-    Matrix matrix;
-    matrix.rows = rows;
-    matrix.cols = cols;
-    matrix.data = create_matrix(rows, cols);
+    *length = (size_t)st.st_size;
+    if (*length == 0) {
+        close(fd);
+        return "";
+    }
 
-    // Читаем данные
-    for (int i = 0; i < rows; i++) {
-        for (int j = 0; j < cols; j++) {
-            if (fscanf(file, "%lf", &matrix.data[i][j]) != 1) {
-                fprintf(stderr, "Ошибка при чтении элемента [%d][%d]\n", i, j);
-                exit(EXIT_FAILURE);
+    void* text = mmap(NULL, *length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (text == MAP_FAILED) {
+        perror("Ошибка отображения файла в память");
+        exit(EXIT_FAILURE);
+    }
+    madvise(text, *length, MADV_SEQUENTIAL);
+    return (const char*)text;
+}
+
+// Функция для освобождения отображения текстового файла
+void unmap_text_file(const char* text, size_t length) {
+    if (length > 0) {
+        munmap((void*)text, length);
+    }
+}
+
+// Наибольшая длина числа, разбираемого через strtod без выделения памяти
+#define DOUBLE_TOKEN_BUFFER 128
+
+// Функция для разбора числа [begin, end) через strtod (корректное округление
+// для любых мантисс и порядков)
+double parse_double_slow(const char* begin, const char* end) {
+    size_t length = (size_t)(end - begin);
+    char buffer[DOUBLE_TOKEN_BUFFER];
+    char* token = (length < sizeof(buffer)) ? buffer : (char*)malloc(length + 1);
+    if (!token) {
+        perror("Ошибка выделения памяти");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(token, begin, length);
+    token[length] = '\0';
+    double value = strtod(token, NULL);
+    if (token != buffer) {
+        free(token);
+    }
+    return value;
+}
+
+// Функция для разбора вещественных чисел из диапазона [p, end) в out.
+// Быстрый путь используется только в точном случае Клингера: мантисса не больше 2^53
+// и порядок не больше 22 по модулю, тогда оба множителя представимы точно и результат
+// округляется один раз. Остальные числа разбираются через strtod, поэтому результат
+// совпадает с fscanf бит в бит. Возвращает количество прочитанных чисел или -1 при ошибке формата
+long parse_double_range(const char* p, const char* end, double* out) {
+    static const double powers_of_10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    long count = 0;
+    while (1) {
+        while (p < end && is_separator(*p)) {
+            p++;
+        }
+        if (p == end) {
+            break;
+        }
+
+        const char* token = p;
+        int negative = (*p == '-');
+        if (*p == '-' || *p == '+') {
+            p++;
+        }
+
+        // Мантисса накапливается в целом числе, лишние цифры уходят в порядок;
+        // отброшенная ненулевая цифра означает, что мантисса неточна
+        uint64_t mantissa = 0;
+        int exponent = 0;
+        int digits = 0;
+        int truncated = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (mantissa < 100000000000000000ULL) {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            } else {
+                exponent++;
+                truncated |= (*p != '0');
+            }
+            digits++;
+            p++;
+        }
+        if (p < end && *p == '.') {
+            p++;
+            while (p < end && *p >= '0' && *p <= '9') {
+                if (mantissa < 100000000000000000ULL) {
+                    mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                    exponent--;
+                } else {
+                    truncated |= (*p != '0');
+                }
+                digits++;
+                p++;
+            }
+        }
+        if (digits == 0) {
+            return -1;
+        }
+
+        if (p < end && (*p == 'e' || *p == 'E')) {
+            p++;
+            int exp_negative = (p < end && *p == '-');
+            if (p < end && (*p == '-' || *p == '+')) {
+                p++;
+            }
+            if (p == end || *p < '0' || *p > '9') {
+                return -1;
+            }
+            int exp_value = 0;
+            while (p < end && *p >= '0' && *p <= '9') {
+                if (exp_value < 10000) {
+                    exp_value = exp_value * 10 + (*p - '0');
+                }
+                p++;
+            }
+            exponent += exp_negative ? -exp_value : exp_value;
+        }
+        if (p < end && !is_separator(*p)) {
+            return -1;
+        }
+
+        double value;
+        if (mantissa == 0) {
+            value = negative ? -0.0 : 0.0;
+        } else if (!truncated && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+            value = (double)mantissa;
+            value = (exponent >= 0) ? value * powers_of_10[exponent] : value / powers_of_10[-exponent];
+            if (negative) {
+                value = -value;
             }
+        } else {
+            value = parse_double_slow(token, p);
+        }
+        out[count++] = value;
+    }
+    return count;
+}
+
+// Функция для параллельного разбора текста с вещественными числами за один проход
+// (устроена так же, как разбор целых: временные буферы потоков + префиксная сумма).
+// Возвращает NULL при ошибке формата
+double* parse_double_text_parallel(const char* text, size_t length, long* size) {
+#ifdef _OPENMP
+    int num_chunks = omp_get_max_threads();
+#else
+    int num_chunks = 1;
+#endif
+    size_t* bounds = (size_t*)malloc((num_chunks + 1) * sizeof(size_t));
+    long* counts = (long*)malloc(num_chunks * sizeof(long));
+    size_t* offsets = (size_t*)malloc(num_chunks * sizeof(size_t));
+    double** chunks = (double**)calloc(num_chunks, sizeof(double*));
+    if (!bounds || !counts || !offsets || !chunks) {
+        perror("Ошибка выделения памяти");
+        exit(EXIT_FAILURE);
+    }
+
+    split_text_ranges(text, length, num_chunks, bounds);
+
+    int failed = 0;
+    #pragma omp parallel for num_threads(num_chunks) schedule(static, 1) reduction(|:failed)
+    for (int c = 0; c < num_chunks; c++) {
+        size_t chunk_length = bounds[c + 1] - bounds[c];
+        chunks[c] = (double*)malloc((chunk_length / 2 + 1) * sizeof(double));
+        counts[c] = chunks[c] ? parse_double_range(text + bounds[c], text + bounds[c + 1], chunks[c]) : -1;
+        if (counts[c] < 0) {
+            failed = 1;
         }
     }
 
-    fclose(file);
+    size_t total = 0;
+    for (int c = 0; c < num_chunks && !failed; c++) {
+        offsets[c] = total;
+        total += (size_t)counts[c];
+    }
+
+    double* values = NULL;
+    if (!failed) {
+        values = (double*)malloc((total > 0 ? total : 1) * sizeof(double));
+        if (!values) {
+            perror("Ошибка выделения памяти");
+            exit(EXIT_FAILURE);
+        }
+
+        #pragma omp parallel for num_threads(num_chunks) schedule(static, 1)
+        for (int c = 0; c < num_chunks; c++) {
+            memcpy(values + offsets[c], chunks[c], (size_t)counts[c] * sizeof(double));
+        }
+        *size = (long)total;
+    }
+
+    for (int c = 0; c < num_chunks; c++) {
+        free(chunks[c]);
+    }
+    free(chunks);
+    free(offsets);
+    free(counts);
+    free(bounds);
+    return values;
+}
+
+// Функция для чтения размера матрицы (целого неотрицательного числа) из начала текста.
+// Возвращает указатель на символ после числа или NULL при ошибке
+const char* parse_dimension(const char* p, const char* end, int* value) {
+    while (p < end && is_separator(*p)) {
+        p++;
+    }
+    if (p == end || *p < '0' || *p > '9') {
+        return NULL;
+    }
+    long long result = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        result = result * 10 + (*p - '0');
+        if (result > INT_MAX) {
+            return NULL;
+        }
+        p++;
+    }
+    *value = (int)result;
+    return p;
+}
+
+// Функция для чтения элементов матрицы из файла в один непрерывный буфер
+// (размеры читаются из первой строки, элементы разбираются параллельно)
+double* read_matrix_values(const char* filename, int* rows, int* cols) {
+    size_t length;
+    const char* text = map_text_file(filename, &length);
+    const char* end = text + length;
+
+    // Читаем размеры матрицы
+    const char* p = parse_dimension(text, end, rows);
+    if (p) {
+        p = parse_dimension(p, end, cols);
+    }
+    if (!p) {
+        fprintf(stderr, "Ошибка при чтении размеров матрицы\n");
+        unmap_text_file(text, length);
+        exit(EXIT_FAILURE);
+    }
+
+    // Разбираем элементы матрицы
+    long count = 0;
+    double* values = parse_double_text_parallel(p, (size_t)(end - p), &count);
+    unmap_text_file(text, length);
+    if (!values || count != (long)*rows * *cols) {
+        fprintf(stderr, "Ошибка при чтении элементов матрицы из файла %s\n", filename);
+        free(values);
+        exit(EXIT_FAILURE);
+    }
+    return values;
+}
+
+// Функция для чтения матрицы из файла
+Matrix read_matrix_from_file(const char* filename) {
+    int rows, cols;
+    double* values = read_matrix_values(filename, &rows, &cols);
+
+    // Создаем матрицу и копируем разобранные элементы по строкам
+    Matrix matrix = create_matrix(rows, cols);
+    for (int i = 0; i < rows; i++) {
+        memcpy(matrix_row(matrix, i), values + (size_t)i * cols, cols * sizeof(double));
+    }
+
+    free(values);
     return matrix;
 }
 
 // Функция для выполнения операций над матрицами
 void perform_operations(Matrix mat1, Matrix mat2, Matrix* add, Matrix* sub, 
                        Matrix* mul, Matrix* div) {
+    // Строки распределяются между OpenMP-потоками процесса
+    #pragma omp parallel for schedule(static)
     for (int i = 0; i < mat1.rows; i++) {
+        const double* a = matrix_row(mat1, i);
+        const double* b = matrix_row(mat2, i);
+        double* add_row = matrix_row(*add, i);
+        double* sub_row = matrix_row(*sub, i);
+        double* mul_row = matrix_row(*mul, i);
+        double* div_row = matrix_row(*div, i);
         for (int j = 0; j < mat1.cols; j++) {
-            add->data[i][j] = mat1.data[i][j] + mat2.data[i][j];
-            sub->data[i][j] = mat1.data[i][j] - mat2.data[i][j];
-            mul->data[i][j] = mat1.data[i][j] * mat2.data[i][j];
-            div->data[i][j] = (mat2.data[i][j] != 0) ? 
-                             (mat1.data[i][j] / mat2.data[i][j]) : 0.0;
+            add_row[j] = a[j] + b[j];
+            sub_row[j] = a[j] - b[j];
+            mul_row[j] = a[j] * b[j];
+            div_row[j] = (b[j] != 0) ? (a[j] / b[j]) : 0.0;
+        }
+    }
+}
+
+// Максимальное число запрашиваемых выходов
+#define MAX_OUTPUTS 8
+
+// Ограничения на программу одного выражения: число операций и глубина стека
+#define EXPR_MAX_OPS 64
+#define EXPR_MAX_DEPTH 16
+
+// Размер блока элементов при вычислении выражений (стек блока помещается в кэш L1/L2)
+#define EXPR_BLOCK 256
+
+// Операции программы выражения (обратная польская запись)
+typedef enum {
+    EXPR_LOAD_A,
+    EXPR_LOAD_B,
+    EXPR_CONST,
+    EXPR_ADD,
+    EXPR_SUB,
+    EXPR_MUL,
+    EXPR_DIV,
+    EXPR_NEG
+} ExprOpCode;
+
+typedef struct {
+    ExprOpCode code;
+    double value;
+} ExprOp;
+
+// Скомпилированное выражение над элементами a и b: исходный текст и программа
+typedef struct {
+    const char* text;
+    ExprOp ops[EXPR_MAX_OPS];
+    int count;
+} Expression;
+
+// Состояние разбора выражения
+typedef struct {
+    const char* p;
+    Expression* expr;
+    int depth;
+    int ok;
+} ExprParser;
+
+// Функция для добавления операции в программу с учетом глубины стека
+void expr_emit(ExprParser* parser, ExprOpCode code, double value) {
+    if (parser->expr->count >= EXPR_MAX_OPS) {
+        parser->ok = 0;
+        return;
+    }
+    parser->expr->ops[parser->expr->count].code = code;
+    parser->expr->ops[parser->expr->count].value = value;
+    parser->expr->count++;
+    
+    if (code == EXPR_LOAD_A || code == EXPR_LOAD_B || code == EXPR_CONST) {
+        if (++parser->depth > EXPR_MAX_DEPTH) {
+            parser->ok = 0;
         }
+    } else if (code != EXPR_NEG) {
+        parser->depth--;
+    }
+}
+
+// Функция для пропуска пробелов в выражении
+void expr_skip_spaces(ExprParser* parser) {
+    while (*parser->p == ' ' || *parser->p == '\t') {
+        parser->p++;
     }
 }
 
+void parse_expr_sum(ExprParser* parser);
+
+// Функция для разбора множителя: число, a, b, унарный минус или выражение в скобках
+void parse_expr_factor(ExprParser* parser) {
+    expr_skip_spaces(parser);
+    char c = *parser->p;
+    
+    if (c == '-') {
+        parser->p++;
+        parse_expr_factor(parser);
+        expr_emit(parser, EXPR_NEG, 0.0);
+    } else if (c == '(') {
+        parser->p++;
+        parse_expr_sum(parser);
+        expr_skip_spaces(parser);
+        if (*parser->p != ')') {
+            parser->ok = 0;
+            return;
+        }
+        parser->p++;
+    } else if ((c == 'a' || c == 'b') && !isalnum((unsigned char)parser->p[1])) {
+        parser->p++;
+        expr_emit(parser, c == 'a' ? EXPR_LOAD_A : EXPR_LOAD_B, 0.0);
+    } else if (isdigit((unsigned char)c) || c == '.') {
+        char* end;
+        double value = strtod(parser->p, &end);
+        if (end == parser->p) {
+            parser->ok = 0;
+            return;
+        }
+        parser->p = end;
+        expr_emit(parser, EXPR_CONST, value);
+    } else {
+        parser->ok = 0;
+    }
+}
+
+// Функция для разбора произведения множителей (операции * и /)
+void parse_expr_product(ExprParser* parser) {
+    parse_expr_factor(parser);
+    while (parser->ok) {
+        expr_skip_spaces(parser);
+        char op = *parser->p;
+        if (op != '*' && op != '/') {
+            break;
+        }
+        parser->p++;
+        parse_expr_factor(parser);
+        expr_emit(parser, op == '*' ? EXPR_MUL : EXPR_DIV, 0.0);
+    }
+}
+
+// Функция для разбора суммы слагаемых (операции + и -)
+void parse_expr_sum(ExprParser* parser) {
+    parse_expr_product(parser);
+    while (parser->ok) {
+        expr_skip_spaces(parser);
+        char op = *parser->p;
+        if (op != '+' && op != '-') {
+            break;
+        }
+        parser->p++;
+        parse_expr_product(parser);
+        expr_emit(parser, op == '+' ? EXPR_ADD : EXPR_SUB, 0.0);
+    }
+}
+
+// Функция для компиляции выражения в программу. Помимо формул над a и b
+// понимает имена add, sub, mul и div. Возвращает 0 при ошибке в выражении
+int compile_expression(const char* text, Expression* expr) {
+    static const char* aliases[][2] = {
+        {"add", "a + b"}, {"sub", "a - b"}, {"mul", "a * b"}, {"div", "a / b"}
+    };
+    const char* source = text;
+    for (size_t i = 0; i < sizeof(aliases) / sizeof(aliases[0]); i++) {
+        if (strcmp(text, aliases[i][0]) == 0) {
+            source = aliases[i][1];
+        }
+    }
+    
+    expr->text = text;
+    expr->count = 0;
+    ExprParser parser = {source, expr, 0, 1};
+    parse_expr_sum(&parser);
+    expr_skip_spaces(&parser);
+    return parser.ok && *parser.p == '\0' && parser.depth == 1;
+}
+
+// Функция для вычисления выражения над блоком из count <= EXPR_BLOCK элементов.
+// Каждая операция выполняется векторизуемым циклом по всему блоку, промежуточные
+// значения хранятся в стеке блоков, последняя операция пишет сразу в out.
+// При нулевом делителе результатом деления становится zero_div_value
+void eval_expression_block(const Expression* expr, const double* a, const double* b,
+                           double* out, int count, double zero_div_value) {
+    double stack[EXPR_MAX_DEPTH][EXPR_BLOCK];
+    const double* operand[EXPR_MAX_DEPTH];
+    int sp = 0;
+    
+    // Слот стека i хранит указатель на a, b или на блок stack[i]
+    for (int k = 0; k < expr->count; k++) {
+        const ExprOp* op = &expr->ops[k];
+        int last = (k == expr->count - 1);
+        
+        if (op->code == EXPR_LOAD_A || op->code == EXPR_LOAD_B) {
+            operand[sp++] = (op->code == EXPR_LOAD_A) ? a : b;
+        } else if (op->code == EXPR_CONST) {
+            double* dst = last ? out : stack[sp];
+            for (int j = 0; j < count; j++) {
+                dst[j] = op->value;
+            }
+            operand[sp++] = dst;
+        } else if (op->code == EXPR_NEG) {
+            double* dst = last ? out : stack[sp - 1];
+            const double* x = operand[sp - 1];
+            for (int j = 0; j < count; j++) {
+                dst[j] = -x[j];
+            }
+            operand[sp - 1] = dst;
+        } else {
+            double* dst = last ? out : stack[sp - 2];
+            const double* x = operand[sp - 2];
+            const double* y = operand[sp - 1];
+            switch (op->code) {
+                case EXPR_ADD:
+                    for (int j = 0; j < count; j++) {
+                        dst[j] = x[j] + y[j];
+                    }
+                    break;
+                case EXPR_SUB:
+                    for (int j = 0; j < count; j++) {
+                        dst[j] = x[j] - y[j];
+                    }
+                    break;
+                case EXPR_MUL:
+                    for (int j = 0; j < count; j++) {
+                        dst[j] = x[j] * y[j];
+                    }
+                    break;
+                default:
+                    // Частное считается всегда и заменяется выбором без ветвления
+                    for (int j = 0; j < count; j++) {
+                        double quotient = x[j] / y[j];
+                        dst[j] = (y[j] != 0.0) ? quotient : zero_div_value;
+                    }
+                    break;
+            }
+            operand[sp - 2] = dst;
+            sp--;
+        }
+    }
+    
+    // Выражение из одной переменной: результат еще не записан в out
+    if (operand[0] != out) {
+        memcpy(out, operand[0], count * sizeof(double));
+    }
+}
+
+// Функция для вычисления запрошенных выражений над локальными строками матриц.
+// Строки обходятся блоками по EXPR_BLOCK столбцов, по каждому блоку входов
+// сразу вычисляются все выражения
+void evaluate_expressions(Matrix mat1, Matrix mat2, const Expression* exprs, int num_exprs,
+                          Matrix* outputs) {
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < mat1.rows; i++) {
+        const double* a = matrix_row(mat1, i);
+        const double* b = matrix_row(mat2, i);
+        for (int j = 0; j < mat1.cols; j += EXPR_BLOCK) {
+            int count = (mat1.cols - j < EXPR_BLOCK) ? mat1.cols - j : EXPR_BLOCK;
+            for (int k = 0; k < num_exprs; k++) {
+                // Деление на ноль дает 0, как и в perform_operations
+                eval_expression_block(&exprs[k], a + j, b + j, matrix_row(outputs[k], i) + j,
+                                      count, 0.0);
+            }
+        }
+    }
+}
+
+// Функция для вывода текста, выровненного по правому краю поля ширины width
+// (ширина считается в символах UTF-8, а не в байтах)
+void print_padded(const char* text, int width) {
+    int chars = 0;
+    for (const char* p = text; *p; p++) {
+        chars += ((*p & 0xC0) != 0x80);
+    }
+    printf("%*s%s", chars < width ? width - chars : 0, "", text);
+}
+
 // Функция для вывода результатов
-void print_results(Matrix add, Matrix sub, Matrix mul, Matrix div, int count) {
+void print_results(const Matrix* outputs, const char** labels, int num_outputs, int count) {
     printf("Первые %d результатов операций:\n", count);
-    printf("Индекс |   Сложение  |  Вычитание  | Умножение  |  Деление   \n");
-    printf("-------+-------------+-------------+------------+-------------\n");
+    printf("Индекс");
+    for (int k = 0; k < num_outputs; k++) {
+        printf(" | ");
+        print_padded(labels[k], 12);
+    }
+    printf("\n");
     
     int elements_printed = 0;
-    for (int i = 0; i < add.rows && elements_printed < count; i++) {
-        for (int j = 0; j < add.cols && elements_printed < count; j++) {
-            printf("%6d | %11.2f | %11.2f | %10.2f | %10.2f\n",
-                   elements_printed + 1,
-                   add.data[i][j], sub.data[i][j], 
-                   mul.data[i][j], div.data[i][j]);
+    for (int i = 0; i < outputs[0].rows && elements_printed < count; i++) {
+        for (int j = 0; j < outputs[0].cols && elements_printed < count; j++) {
+            printf("%6d", elements_printed + 1);
+            for (int k = 0; k < num_outputs; k++) {
+                printf(" | %12.2f", matrix_row(outputs[k], i)[j]);
+            }
+            printf("\n");
             elements_printed++;
         }
     }
-    printf("\nВсего обработано элементов: %d\n", add.rows * add.cols);
+    printf("\nВсего обработано элементов: %d\n", outputs[0].rows * outputs[0].cols);
 }
 
 int main(int argc, char* argv[]) {
     int rank, size;
     double start_time, end_time, compute_time = 0, comm_time = 0;
-    Matrix matrix1, matrix2;
+    Matrix matrix1 = {0}, matrix2 = {0};
     Matrix local_matrix1, local_matrix2;
-    Matrix local_add, local_sub, local_mul, local_div;
-    Matrix *result_add = NULL, *result_sub = NULL, *result_mul = NULL, *result_div = NULL;
+    Matrix local_outputs[MAX_OUTPUTS], outputs[MAX_OUTPUTS] = {{0}};
     int *sendcounts = NULL, *displs = NULL;
     
-    // Инициализация MPI
-    MPI_Init(&argc, &argv);
+    // Инициализация MPI для гибридного режима: локальные вычисления выполняют
+    // OpenMP-потоки процесса, MPI вызывается только из главного потока
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
+    if (provided < MPI_THREAD_FUNNELED) {
+        if (rank == 0) {
+            fprintf(stderr, "Предупреждение: MPI не поддерживает MPI_THREAD_FUNNELED, "
+                            "используется один поток на процесс\n");
+        }
+#ifdef _OPENMP
+        omp_set_num_threads(1);
+#endif
+    }
+    
+    // Аргументы - запрошенные выражения; без них вычисляются add, sub, mul и div
+    Expression exprs[MAX_OUTPUTS];
+    int num_exprs = 0;
+    for (int i = 1; i < argc; i++) {
+        if (num_exprs == MAX_OUTPUTS || !compile_expression(argv[i], &exprs[num_exprs++])) {
+            if (rank == 0) {
+                printf("Некорректное выражение или больше %d выражений: %s\n", MAX_OUTPUTS, argv[i]);
+                printf("Использование: %s [выражение ...]\n", argv[0]);
+                printf("Выражения над элементами a и b: add, sub, mul, div или формулы вида \"a*b + a\"\n");
+            }
+            MPI_Finalize();
+            return 1;
+        }
+    }
+    int num_outputs = num_exprs > 0 ? num_exprs : 4;
     
     if (rank == 0) {
         printf("=== ПАРАЛЛЕЛЬНАЯ ВЕРСИЯ ===\n");
@@ -126,6 +716,9 @@ int main(int argc, char* argv[]) {
         printf("Размер матриц: %dx%d (всего %d элементов)\n", 
                matrix1.rows, matrix1.cols, matrix1.rows * matrix1.cols);
         printf("Используется %d процессов\n", size);
+#ifdef _OPENMP
+        printf("OpenMP-потоков на процесс: %d\n", omp_get_max_threads());
+#endif
     }
     
     // Синхронизация перед началом работы
@@ -133,181 +726,84 @@ int main(int argc, char* argv[]) {
     start_time = MPI_Wtime();
     
     // Рассылаем размеры матриц всем процессам
-    int rows, cols;
+    int dims[2];
     if (rank == 0) {
-        rows = matrix1.rows;
-        cols = matrix1.cols;
+        dims[0] = matrix1.rows;
+        dims[1] = matrix1.cols;
     }
-    MPI_Bcast(&rows, 1, MPI_INT, 0, MPI_COMM_WORLD);
-    MPI_Bcast(&cols, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(dims, 2, MPI_INT, 0, MPI_COMM_WORLD);
+    int rows = dims[0];
+    int cols = dims[1];
     
     // Вычисляем количество строк на процесс
     int rows_per_proc = rows / size;
     int remainder = rows % size;
     
-    // Массивы для хранения размеров и смещений
+    // Массивы для хранения размеров и смещений (в строках)
     sendcounts = (int*)malloc(size * sizeof(int));
     displs = (int*)malloc(size * sizeof(int));
     
     // Вычисляем размеры частей и смещения
     int offset = 0;
     for (int i = 0; i < size; i++) {
-        sendcounts[i] = (i < remainder) ? (rows_per_proc + 1) * cols : rows_per_proc * cols;
+        sendcounts[i] = (i < remainder) ? (rows_per_proc + 1) : rows_per_proc;
         displs[i] = offset;
         offset += sendcounts[i];
     }
     
     // Вычисляем локальный размер для текущего процесса
-    int local_rows = (rank < remainder) ? (rows_per_proc + 1) : rows_per_proc;
+    int local_rows = sendcounts[rank];
     
     // Выделяем память под локальные части матриц
-    local_matrix1.rows = local_rows;
-    local_matrix1.cols = cols;
-    local_matrix1.data = create_matrix(local_rows, cols);
-    
-    local_matrix2.rows = local_rows;
-    local_matrix2.cols = cols;
-    local_matrix2.data = create_matrix(local_rows, cols);
-    
-    // Создаем дескриптор типа для строки матрицы
-    MPI_Datatype row_type;
-    MPI_Type_contiguous(cols, MPI_DOUBLE, &row_type);
+    local_matrix1 = create_matrix(local_rows, cols);
+    local_matrix2 = create_matrix(local_rows, cols);
+    
+    // Создаем дескриптор типа для строки матрицы: cols элементов с шагом stride,
+    // чтобы выравнивающие элементы в конце строк не пересылались
+    MPI_Datatype row_contiguous, row_type;
+    MPI_Type_contiguous(cols, MPI_DOUBLE, &row_contiguous);
+    MPI_Type_create_resized(row_contiguous, 0, (MPI_Aint)local_matrix1.stride * sizeof(double), &row_type);
     MPI_Type_commit(&row_type);
-    
-    // Распределяем данные между процессами
-    if (rank == 0) {
-        // Процесс 0 копирует свою часть
-        for (int i = 0; i < local_rows; i++) {
-            memcpy(local_matrix1.data[i], matrix1.data[i], cols * sizeof(double));
-            memcpy(local_matrix2.data[i], matrix2.data[i], cols * sizeof(double));
-        }
-        
-        // Отправляем остальным процессам их части
-        for (int dest = 1; dest < size; dest++) {
-            int dest_rows = (dest < remainder) ? (rows_per_proc + 1) : rows_per_proc;
-            for (int i = 0; i < dest_rows; i++) {
-                MPI_Send(&matrix1.data[displs[dest]/cols + i][0], 1, row_type, 
-                        dest, 0, MPI_COMM_WORLD);
-                MPI_Send(&matrix2.data[displs[dest]/cols + i][0], 1, row_type, 
-                        dest, 1, MPI_COMM_WORLD);
-            }
-        }
-    } else {
-        // Получаем данные от процесса 0
-        for (int i = 0; i < local_rows; i++) {
-            MPI_Recv(local_matrix1.data[i], cols, MPI_DOUBLE, 0, 0, 
-                    MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            MPI_Recv(local_matrix2.data[i], cols, MPI_DOUBLE, 0, 1, 
-                    MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-        }
+    MPI_Type_free(&row_contiguous);
+    
+    // Распределяем данные между процессами (одна коллективная операция на матрицу)
+    MPI_Scatterv(matrix1.data, sendcounts, displs, row_type,
+                local_matrix1.data, local_rows, row_type,
+                0, MPI_COMM_WORLD);
+    MPI_Scatterv(matrix2.data, sendcounts, displs, row_type,
+                local_matrix2.data, local_rows, row_type,
+                0, MPI_COMM_WORLD);
+    
+    // Выделяем память только под запрошенные результаты
+    for (int k = 0; k < num_outputs; k++) {
+        local_outputs[k] = create_matrix(local_rows, cols);
     }
     
-    // Выделяем память под результаты
-    local_add.rows = local_rows;
-    local_add.cols = cols;
-    local_add.data = create_matrix(local_rows, cols);
-    
-    local_sub.rows = local_rows;
-    local_sub.cols = cols;
-    local_sub.data = create_matrix(local_rows, cols);
-    
-    local_mul.rows = local_rows;
-    local_mul.cols = cols;
-    local_mul.data = create_matrix(local_rows, cols);
-    
-    local_div.rows = local_rows;
-    local_div.cols = cols;
-    local_div.data = create_matrix(local_rows, cols);
-    
     // Выполняем вычисления над локальными частями
     double compute_start = MPI_Wtime();
-    perform_operations(local_matrix1, local_matrix2, 
-                      &local_add, &local_sub, &local_mul, &local_div);
+    if (num_exprs > 0) {
+        // Запрошенные выражения вычисляются за один проход по локальным строкам
+        evaluate_expressions(local_matrix1, local_matrix2, exprs, num_exprs, local_outputs);
+    } else {
+        perform_operations(local_matrix1, local_matrix2, 
+                          &local_outputs[0], &local_outputs[1], &local_outputs[2], &local_outputs[3]);
+    }
     compute_time = MPI_Wtime() - compute_start;
     
     // Если процесс 0, выделяем память для полных результатов
     if (rank == 0) {
-        result_add = (Matrix*)malloc(sizeof(Matrix));
-        result_sub = (Matrix*)malloc(sizeof(Matrix));
-        result_mul = (Matrix*)malloc(sizeof(Matrix));
-        result_div = (Matrix*)malloc(sizeof(Matrix));
-        
-        result_add->rows = rows;
-        result_add->cols = cols;
-        result_add->data = create_matrix(rows, cols);
-        
-        result_sub->rows = rows;
-        result_sub->cols = cols;
-        result_sub->data = create_matrix(rows, cols);
-        
-        result_mul->rows = rows;
-        result_mul->cols = cols;
-        result_mul->data = create_matrix(rows, cols);
-        
-        result_div->rows = rows;
-        result_div->cols = cols;
-        result_div->data = create_matrix(rows, cols);
-    }
-    
-    // Собираем результаты на процессе 0
-    double comm_start = MPI_Wtime();
-    
-    // Создаем временные буферы для сбора данных
-    double* recv_buf = NULL;
-    if (rank == 0) {
-        recv_buf = (double*)malloc(rows * cols * sizeof(double));
-    }
-    
-    // Собираем результаты сложения
-    MPI_Gatherv(&(local_add.data[0][0]), local_rows * cols, MPI_DOUBLE,
-               recv_buf, sendcounts, displs, MPI_DOUBLE,
-               0, MPI_COMM_WORLD);
-    
-    if (rank == 0) {
-        for (int i = 0; i < rows; i++) {
-            for (int j = 0; j < cols; j++) {
-                result_add->data[i][j] = recv_buf[i * cols + j];
-            }
-        }
-    }
-    
-    // Собираем результаты вычитания
-    MPI_Gatherv(&(local_sub.data[0][0]), local_rows * cols, MPI_DOUBLE,
-               recv_buf, sendcounts, displs, MPI_DOUBLE,
-               0, MPI_COMM_WORLD);
-    
-    if (rank == 0) {
-        for (int i = 0; i < rows; i++) {
-            for (int j = 0; j < cols; j++) {
-                result_sub->data[i][j] = recv_buf[i * cols + j];
-            }
-        }
-    }
-    
-    // Собираем результаты умножения
-    MPI_Gatherv(&(local_mul.data[0][0]), local_rows * cols, MPI_DOUBLE,
-               recv_buf, sendcounts, displs, MPI_DOUBLE,
-               0, MPI_COMM_WORLD);
-    
-    if (rank == 0) {
-        for (int i = 0; i < rows; i++) {
-            for (int j = 0; j < cols; j++) {
-                result_mul->data[i][j] = recv_buf[i * cols + j];
-            }
+        for (int k = 0; k < num_outputs; k++) {
+            outputs[k] = create_matrix(rows, cols);
         }
     }
     
-    // Собираем результаты деления
-    MPI_Gatherv(&(local_div.data[0][0]), local_rows * cols, MPI_DOUBLE,
-               recv_buf, sendcounts, displs, MPI_DOUBLE,
-               0, MPI_COMM_WORLD);
+    // Собираем результаты на процессе 0 сразу в итоговые матрицы
+    double comm_start = MPI_Wtime();
     
-    if (rank == 0) {
-        for (int i = 0; i < rows; i++) {
-            for (int j = 0; j < cols; j++) {
-                result_div->data[i][j] = recv_buf[i * cols + j];
-            }
-        }
+    for (int k = 0; k < num_outputs; k++) {
+        MPI_Gatherv(local_outputs[k].data, local_rows, row_type,
+                   outputs[k].data, sendcounts, displs, row_type,
+                   0, MPI_COMM_WORLD);
     }
     
     comm_time = MPI_Wtime() - comm_start;
@@ -323,34 +819,32 @@ int main(int argc, char* argv[]) {
         printf("  - Время обмена данными: %.6f секунд\n", comm_time);
         
         // Вычисляем и выводим скорость обработки (операций в секунду)
-        double total_operations = (double)(rows * cols) * 4.0;
+        double total_operations = (double)(rows * cols) * num_outputs;
         printf("Скорость: %.2f операций/сек\n", 
                total_operations / (end_time - start_time));
         
         // Выводим результаты
-        print_results(*result_add, *result_sub, *result_mul, *result_div, 5);
+        static const char* default_labels[] = {"Сложение", "Вычитание", "Умножение", "Деление"};
+        const char* labels[MAX_OUTPUTS];
+        for (int k = 0; k < num_outputs; k++) {
+            labels[k] = num_exprs > 0 ? exprs[k].text : default_labels[k];
+        }
+        print_results(outputs, labels, num_outputs, 5);
     }
     
     // Освобождаем память
-    free_matrix(local_matrix1.data, local_rows);
-    free_matrix(local_matrix2.data, local_rows);
-    free_matrix(local_add.data, local_rows);
-    free_matrix(local_sub.data, local_rows);
-    free_matrix(local_mul.data, local_rows);
-    free_matrix(local_div.data, local_rows);
+    free_matrix(&local_matrix1);
+    free_matrix(&local_matrix2);
+    for (int k = 0; k < num_outputs; k++) {
+        free_matrix(&local_outputs[k]);
+    }
     
     if (rank == 0) {
-        free_matrix(matrix1.data, matrix1.rows);
-        free_matrix(matrix2.data, matrix2.rows);
-        free_matrix(result_add->data, result_add->rows);
-        free_matrix(result_sub->data, result_sub->rows);
-        free_matrix(result_mul->data, result_mul->rows);
-        free_matrix(result_div->data, result_div->rows);
-        free(result_add);
-        free(result_sub);
-        free(result_mul);
-        free(result_div);
-        free(recv_buf);
+        free_matrix(&matrix1);
+        free_matrix(&matrix2);
+        for (int k = 0; k < num_outputs; k++) {
+            free_matrix(&outputs[k]);
+        }
     }
     
     free(sendcounts);
@@ -361,4 +855,4 @@ int main(int argc, char* argv[]) {
     MPI_Finalize();
     
     return 0;
-}
\ No newline at end of file
+}